@@ -0,0 +1,5 @@
+-- Coarse grains in dry air
+local snow = dofile("lib/snow.lua")
+snow.run({ seed = 102, grains = {1e-3, 2e-3}, spacing = 1.5e-3,
+		   depth = 2e-2, n = 8000 })
+return true
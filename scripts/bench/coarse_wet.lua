@@ -0,0 +1,5 @@
+-- Coarse grains, with melt water filling a third of the space between them
+local snow = dofile("lib/snow.lua")
+snow.run({ seed = 104, grains = {1e-3, 2e-3}, spacing = 1.5e-3,
+		   depth = 2e-2, water = 1 / 3, n = 8000 })
+return true
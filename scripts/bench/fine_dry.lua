@@ -0,0 +1,5 @@
+-- Fine grains in dry air
+local snow = dofile("lib/snow.lua")
+snow.run({ seed = 101, grains = {100e-6, 200e-6}, spacing = 150e-6,
+		   depth = 2e-3, n = 8000 })
+return true
@@ -0,0 +1,84 @@
+--[[
+	Shared set up of the benchmark scenes, which are run with
+	nix_demo --bench. Each scene is a layer of snow: ice grains of a given
+	size in air, or in a mixture of air and melt water. The scenes only differ
+	in the parameters passed to snow.run(), and each pins its own seed so that
+	its output can be compared with its stored reference.
+--]]
+
+local snow = {}
+
+-- Flat prolate and oblate warps
+local function flat(v)
+	local rows = {}
+	for i = 1, 101 do
+		local row = {}
+		for j = 1, 101 do row[j] = v end
+		rows[i] = row
+	end
+	return rows
+end
+
+local ice_n = nix.piecewise_linear_spectrum("ice_n",
+	{{350, 1.32}, {1000, 1.30}, {1500, 1.29}, {2500, 1.25}})
+local ice_k = nix.piecewise_linear_spectrum("ice_k",
+	{{350, 1e-9}, {1000, 2e-6}, {1500, 5e-4}, {2000, 1e-3}, {2500, 5e-4}})
+local air_n = nix.piecewise_linear_spectrum("air_n", 350, 2500, {1.0, 1.0})
+local air_k = nix.piecewise_linear_spectrum("air_k", 350, 2500, {0.0, 0.0})
+local water_n = nix.piecewise_linear_spectrum("water_n",
+	{{350, 1.34}, {1000, 1.33}, {1500, 1.32}, {2500, 1.30}})
+local water_k = nix.piecewise_linear_spectrum("water_k",
+	{{350, 1e-9}, {1000, 3e-6}, {1500, 2e-4}, {2000, 1e-3}, {2500, 5e-4}})
+
+-- Run a scene. The parameters are:
+--   seed        the seed of the random streams
+--   grains      the smallest and largest grain size, in metres
+--   spacing     the mean distance between grains, in metres
+--   depth       the depth of the layer, in metres
+--   water       the fraction of the space between grains that is water
+--   mirror      whether the top of the layer is a Fresnel interface
+--   reflector   whether there is a reflector below the layer
+--   n           the rays per cell
+function snow.run(p)
+	local size = nix.piecewise_linear_spectrum("size", 0, 1, p.grains)
+	local sphericity = nix.piecewise_linear_spectrum("sphericity", 0, 1,
+		{0.8, 1.25})
+	local warp = flat(0.5)
+	local generator = nix.random_spheroid_particle_generator(warp, warp, size,
+		sphericity, p.spacing)
+
+	local media = { { name = "air", weight = 1 - (p.water or 0),
+					  n = air_n, k = air_k } }
+	if p.water and p.water > 0 then
+		table.insert(media, { name = "water", weight = p.water,
+							  n = water_n, k = water_k })
+	end
+
+	local material = nix.test1material()
+	material:set_depth(p.depth)
+	material:set_media(media)
+	material:set_particles({ {
+		name = "ice", roundness_mean = 0.5, roundness_stdev = 0.1,
+		roundness_range = {0.1, 0.9}, generator = generator,
+		n = ice_n, k = ice_k, concentration = 1.0 } })
+	material:set_mirror(p.mirror or false)
+	if p.reflector then
+		material:set_lower_reflector()
+	end
+
+	local photometer = nix.collimated_beam_photometer()
+	photometer:set_collector_sphere(
+		nix.equal_solid_angles_collector_sphere(3, 4, true, true))
+
+	local job = nix.photometer_job()
+	job:set_seed(p.seed)
+	job:set_n(p.n)
+	job:set_wavelengths({ 500, 1000, 1500, 2000 })
+	job:set_incident_angles({ { polar = 0.0, azimuth = 0.0 },
+							  { polar = 0.8, azimuth = 0.0 } })
+	job:set_device(photometer)
+	job:set_material(material)
+	job:run()
+end
+
+return snow
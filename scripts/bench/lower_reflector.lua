@@ -0,0 +1,5 @@
+-- A thin layer of fine grains over a reflector
+local snow = dofile("lib/snow.lua")
+snow.run({ seed = 106, grains = {100e-6, 200e-6}, spacing = 150e-6,
+		   depth = 5e-4, reflector = true, n = 8000 })
+return true
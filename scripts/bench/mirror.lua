@@ -0,0 +1,5 @@
+-- Fine grains under a Fresnel interface at the top of the layer
+local snow = dofile("lib/snow.lua")
+snow.run({ seed = 105, grains = {100e-6, 200e-6}, spacing = 150e-6,
+		   depth = 2e-3, mirror = true, n = 8000 })
+return true
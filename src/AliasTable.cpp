@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "AliasTable.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace nix {
+
+AliasTable::AliasTable(const std::vector<Scalar> & weights)
+  : _probability(weights.size(), 1), _alias(weights.size())
+{
+	if (weights.empty()) {
+		return;
+	}
+
+	Scalar total = 0;
+	for (Scalar w : weights) {
+		if (!(w >= 0) or !std::isfinite(w)) {
+			throw std::runtime_error("The weights of a discrete distribution "
+				"must be finite and non-negative.");
+		}
+		total += w;
+	}
+	if (!(total > 0)) {
+		throw std::runtime_error("The weights of a discrete distribution sum "
+			"to zero.");
+	}
+
+	// Scale the weights so that they average one, and pair each column that
+	// is short of one with a column that has more than enough to fill it.
+	const int n = weights.size();
+	std::vector<Scalar> scaled(n);
+	std::vector<int> small, large;
+	for (int i=0; i<n; ++i) {
+		_alias[i] = i;
+		scaled[i] = weights[i] * n / total;
+		(scaled[i] < 1 ? small : large).push_back(i);
+	}
+	while (!small.empty() and !large.empty()) {
+		const int s = small.back();
+		const int l = large.back();
+		small.pop_back();
+		_probability[s] = scaled[s];
+		_alias[s] = l;
+		scaled[l] -= 1 - scaled[s];
+		if (scaled[l] < 1) {
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+
+	// Whatever is left is only short of one by rounding
+	for (int i : small) {
+		_probability[i] = 1;
+	}
+	for (int i : large) {
+		_probability[i] = 1;
+	}
+}
+
+} // namespace nix
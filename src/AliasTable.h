@@ -0,0 +1,65 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include "Scalar.h"
+
+#include <vector>
+
+namespace nix {
+
+/// Walker's alias table, for sampling a discrete distribution in constant
+/// time.
+///
+/// The table has a column per outcome, each of which holds the probability of
+/// keeping its own outcome and an alias to return otherwise. Sampling picks a
+/// column with the integer part of a scaled uniform random number, and makes
+/// the choice within the column with its fractional part, so a single random
+/// number is drawn however many outcomes there are. The table is built with
+/// Vose's algorithm in linear time.
+class AliasTable
+{
+  public:
+	/// Construct an empty table.
+	AliasTable() = default;
+
+	/// Build a table.
+	/// \param weights The relative weight of each outcome. They needn't sum
+	///        to one.
+	/// \throws Throws std::runtime_error if a weight is negative or not
+	///         finite, or if the weights sum to zero.
+	explicit AliasTable(const std::vector<Scalar> & weights);
+
+	/// Get the number of outcomes.
+	/// \return Returns the number of weights the table was built from.
+	int size() const noexcept { return _probability.size(); }
+
+	/// Test whether there are any outcomes.
+	/// \return Returns true if the table was built from no weights.
+	bool empty() const noexcept { return _probability.empty(); }
+
+	/// Sample an outcome.
+	/// \param u A uniform random number in \f$[0, 1)\f$.
+	/// \return Returns the index of a weight, or -1 if the table is empty.
+	int sample(Scalar u) const noexcept
+	{
+		const int n = size();
+		if (n == 0) {
+			return -1;
+		}
+		const Scalar s = u * n;
+		int i = static_cast<int>(s);
+		if (i >= n) {
+			i = n - 1;
+		}
+		return s - i < _probability[i] ? i : _alias[i];
+	}
+
+  private:
+	std::vector<Scalar> _probability;	///< Chance of keeping the column
+	std::vector<int> _alias;			///< Outcome of the column otherwise
+};
+
+} // namespace nix
@@ -4,6 +4,9 @@
  ***************************************************************************/
 #pragma once
 
+#include "Scalar.h"
+
+#include <array>
 #include <cassert>
 #include <vector>
 
@@ -0,0 +1,141 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+
+namespace nix {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Where keep() stores values. Being volatile, the stores can't be elided.
+volatile double sink;
+
+/// Time one call of a kernel.
+/// \return Returns the time in seconds.
+double time(const Benchmark::Kernel & kernel, long long operations)
+{
+	const Clock::time_point start = Clock::now();
+	kernel(operations);
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+} // namespace
+
+double Benchmark::Result::percentile(double p) const
+{
+	if (nanoseconds.empty()) {
+		return 0;
+	}
+	const double rank = p / 100 * (nanoseconds.size() - 1);
+	const std::size_t below = std::min<std::size_t>(rank, nanoseconds.size() - 1);
+	const std::size_t above = std::min(below + 1, nanoseconds.size() - 1);
+	const double f = rank - below;
+	return nanoseconds[below] * (1 - f) + nanoseconds[above] * f;
+}
+
+Benchmark::Benchmark(const std::string & name, Kernel kernel)
+  : _name(name), _kernel(std::move(kernel))
+{
+}
+
+Benchmark::Result Benchmark::run(const Options & options) const
+{
+	if (options.warmup < 0 or options.repetitions < 1 or
+		!(options.minSeconds > 0)) {
+		throw std::runtime_error("Invalid options for benchmark " + _name +
+			".");
+	}
+
+	Result result;
+	result.name = _name;
+	result.operations = 1;
+	while (time(_kernel, result.operations) < options.minSeconds and
+		   result.operations < (1LL << 40)) {
+		result.operations *= 2;
+	}
+
+	for (int w=0; w<options.warmup; ++w) {
+		_kernel(result.operations);
+	}
+	for (int r=0; r<options.repetitions; ++r) {
+		result.nanoseconds.push_back(time(_kernel, result.operations) * 1e9 /
+									 result.operations);
+	}
+	std::sort(result.nanoseconds.begin(), result.nanoseconds.end());
+	return result;
+}
+
+void Benchmark::keep(double value) noexcept
+{
+	sink = value;
+}
+
+void Benchmark::writeTable(std::ostream & os,
+						   const std::vector<Result> & results)
+{
+	std::size_t width = 9;
+	for (const Result & r : results) {
+		width = std::max(width, r.name.size());
+	}
+	const std::ios::fmtflags flags = os.flags();
+	os << std::left << std::setw(width) << "benchmark" << std::right
+	   << std::setw(12) << "ops" << std::setw(12) << "min ns"
+	   << std::setw(12) << "p10 ns" << std::setw(12) << "median ns"
+	   << std::setw(12) << "p90 ns" << std::setw(12) << "max ns" << "\n";
+	os << std::fixed << std::setprecision(2);
+	for (const Result & r : results) {
+		os << std::left << std::setw(width) << r.name << std::right
+		   << std::setw(12) << r.operations
+		   << std::setw(12) << r.percentile(0)
+		   << std::setw(12) << r.percentile(10)
+		   << std::setw(12) << r.median()
+		   << std::setw(12) << r.percentile(90)
+		   << std::setw(12) << r.percentile(100) << "\n";
+	}
+	os.flags(flags);
+	os.flush();
+}
+
+void Benchmark::writeJson(std::ostream & os, const Options & options,
+						  const std::vector<Result> & results)
+{
+	const std::ios::fmtflags flags = os.flags();
+	const std::streamsize precision = os.precision(6);
+	os << "{\n"
+	   << "  \"warmup\": " << options.warmup << ",\n"
+	   << "  \"repetitions\": " << options.repetitions << ",\n"
+	   << "  \"min_seconds\": " << options.minSeconds << ",\n"
+	   << "  \"benchmarks\": [";
+	for (std::size_t b=0; b<results.size(); ++b) {
+		const Result & r = results[b];
+		os << (b > 0 ? ",\n" : "\n")
+		   << "    {\n"
+		   << "      \"name\": \"" << r.name << "\",\n"
+		   << "      \"operations\": " << r.operations << ",\n"
+		   << "      \"min_ns\": " << r.percentile(0) << ",\n"
+		   << "      \"p10_ns\": " << r.percentile(10) << ",\n"
+		   << "      \"median_ns\": " << r.median() << ",\n"
+		   << "      \"p90_ns\": " << r.percentile(90) << ",\n"
+		   << "      \"max_ns\": " << r.percentile(100) << ",\n"
+		   << "      \"samples_ns\": [";
+		for (std::size_t s=0; s<r.nanoseconds.size(); ++s) {
+			os << (s > 0 ? ", " : "") << r.nanoseconds[s];
+		}
+		os << "]\n    }";
+	}
+	os << "\n  ]\n}\n";
+	os.precision(precision);
+	os.flags(flags);
+	os.flush();
+}
+
+} // namespace nix
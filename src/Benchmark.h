@@ -0,0 +1,91 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace nix {
+
+/// A repeatable micro-benchmark of one kernel, as run by nix_bench.
+///
+/// The kernel is called with a number of operations to perform. That number
+/// is first calibrated, by doubling it until one call takes long enough to
+/// time reliably. The kernel is then run a few times to warm the caches and
+/// branch predictors, and the time per operation is measured over several
+/// repetitions. The median and the percentiles of the repetitions are
+/// reported rather than the mean, so that the odd interrupted repetition
+/// doesn't skew the result.
+class Benchmark
+{
+  public:
+	/// A kernel. It must perform the given number of operations, and should
+	/// pass what it computes to keep() so that it isn't optimized away.
+	using Kernel = std::function<void(long long operations)>;
+
+	/// How a benchmark is run.
+	struct Options {
+		int warmup = 3;				///< Untimed runs before the repetitions.
+		int repetitions = 15;		///< Timed runs.
+		double minSeconds = 0.02;	///< Shortest time of one run.
+	};
+
+	/// The times of a benchmark.
+	struct Result {
+		std::string name;				///< Name of the benchmark.
+		long long operations = 0;		///< Operations per repetition.
+		std::vector<double> nanoseconds;	///< Per operation, sorted.
+
+		/// Get a percentile of the time per operation.
+		/// \param p The percentile, in [0, 100].
+		/// \return Returns the time in nanoseconds, interpolated between
+		///         the repetitions.
+		double percentile(double p) const;
+
+		/// Get the median time per operation.
+		/// \return Returns the time in nanoseconds.
+		double median() const { return percentile(50); }
+	};
+
+	/// Construct a benchmark.
+	/// \param name The name of the benchmark, e.g. "spectrum_evaluate".
+	/// \param kernel The kernel to time.
+	Benchmark(const std::string & name, Kernel kernel);
+
+	/// Get the name of the benchmark.
+	/// \return Returns the name given to the constructor.
+	const std::string & name() const noexcept { return _name; }
+
+	/// Calibrate, warm up and time the kernel.
+	/// \param options How to run the benchmark.
+	/// \throws Throws std::runtime_error if the options are invalid.
+	/// \return Returns the times of the repetitions.
+	Result run(const Options & options) const;
+
+	/// Keep a value that a kernel computed from being optimized away.
+	/// \param value Any value.
+	static void keep(double value) noexcept;
+
+	/// Write results as an aligned table, one benchmark per line.
+	/// \param os The stream to write to.
+	/// \param results The results to write.
+	static void writeTable(std::ostream & os,
+						   const std::vector<Result> & results);
+
+	/// Write results as JSON, for tracking them between releases.
+	/// \param os The stream to write to.
+	/// \param options The options the benchmarks were run with.
+	/// \param results The results to write.
+	static void writeJson(std::ostream & os, const Options & options,
+						  const std::vector<Result> & results);
+
+  private:
+	std::string _name;		///< Name of the benchmark
+	Kernel _kernel;			///< Kernel to time
+};
+
+} // namespace nix
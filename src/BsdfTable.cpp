@@ -0,0 +1,214 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "BsdfTable.h"
+
+#include "ICollectorSphere.h"
+#include "ResultFile.h"
+#include "SphericalCoordinates.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace nix {
+
+namespace {
+
+/// The first bytes of a table. The version follows separately.
+const char magic[8] = { 'N', 'I', 'X', 'B', 'S', 'D', 'F', '\0' };
+
+/// Round a byte offset up to the alignment of every section.
+std::uint64_t align(std::uint64_t offset)
+{
+	return (offset + 7) & ~std::uint64_t(7);
+}
+
+/// Write a section, padded to the alignment.
+template<typename T>
+void writeSection(std::ostream & os, const std::vector<T> & values)
+{
+	const std::size_t size = values.size() * sizeof(T);
+	os.write(reinterpret_cast<const char *>(values.data()), size);
+	static const char padding[8] = {};
+	os.write(padding, align(size) - size);
+}
+
+} // namespace
+
+constexpr std::uint32_t BsdfTable::version;
+
+void BsdfTable::write(const std::string & fname, const ResultFile & results,
+					  const ICollectorSphere & sphere)
+{
+	const std::size_t numIncident = results.polar.size();
+	const std::size_t numLambdas = results.lambdas.size();
+	const std::size_t numSensors = results.numSensors();
+	const std::size_t numCells = numIncident * numLambdas;
+	if (sphere.numSensors() != int(numSensors) or
+		results.cells.size() != numCells) {
+		throw std::runtime_error("The collector sphere doesn't match the "
+			"results of the job.");
+	}
+
+	std::vector<Incident> incident(numIncident);
+	for (std::size_t i=0; i<numIncident; ++i) {
+		incident[i].polar = results.polar[i];
+		incident[i].azimuth = results.azimuth[i];
+	}
+	const std::vector<double> lambdas(results.lambdas.begin(),
+									  results.lambdas.end());
+	std::vector<Sensor> sensors(numSensors);
+	for (std::size_t id=0; id<numSensors; ++id) {
+		const SphericalCoordinates c = sphere.center(id);
+		sensors[id].polar = c.polar();
+		sensors[id].azimuth = c.azimuthal();
+		sensors[id].solidAngle = sphere.getSolidAngle(id);
+		sensors[id].projectedSolidAngle = results.projectedSolidAngles[id];
+	}
+
+	// Estimates are computed as in ResultFile::writeCell(), in Scalars.
+	std::vector<std::int32_t> rays(numCells, 0);
+	std::vector<std::int32_t> hits(numCells * numSensors, 0);
+	std::vector<double> bsdf(numCells * numSensors, 0);
+	for (std::size_t c=0; c<numCells; ++c) {
+		const ResultFile::Cell & cell = results.cells[c];
+		if (not cell.complete or cell.rays <= 0) {
+			continue;
+		}
+		rays[c] = cell.rays;
+		for (std::size_t id=0; id<numSensors; ++id) {
+			const Scalar fraction = static_cast<Scalar>(cell.hits[id]) /
+				cell.rays;
+			const Scalar psa = results.projectedSolidAngles[id];
+			hits[c * numSensors + id] = cell.hits[id];
+			bsdf[c * numSensors + id] = psa > 0 ? fraction / psa : 0;
+		}
+	}
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.headerSize = sizeof(Header);
+	header.numIncident = numIncident;
+	header.numLambdas = numLambdas;
+	header.numSensors = numSensors;
+	header.seed = results.seed;
+	header.incidentOffset = align(sizeof(Header));
+	header.lambdaOffset = header.incidentOffset +
+		align(incident.size() * sizeof(Incident));
+	header.sensorOffset = header.lambdaOffset +
+		align(lambdas.size() * sizeof(double));
+	header.raysOffset = header.sensorOffset +
+		align(sensors.size() * sizeof(Sensor));
+	header.hitsOffset = header.raysOffset +
+		align(rays.size() * sizeof(std::int32_t));
+	header.bsdfOffset = header.hitsOffset +
+		align(hits.size() * sizeof(std::int32_t));
+	header.fileSize = header.bsdfOffset + align(bsdf.size() * sizeof(double));
+
+	const std::string temp = fname + ".tmp";
+	{
+		std::ofstream os(temp, std::ios::binary | std::ios::trunc);
+		os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		writeSection(os, incident);
+		writeSection(os, lambdas);
+		writeSection(os, sensors);
+		writeSection(os, rays);
+		writeSection(os, hits);
+		writeSection(os, bsdf);
+		if (!os.flush()) {
+			throw std::runtime_error("Unable to write the BSDF table " +
+				temp + ".");
+		}
+	}
+	ResultFile::replace(temp, fname);
+}
+
+BsdfTable::BsdfTable(const std::string & fname)
+  : _data(nullptr), _size(0), _header(nullptr)
+{
+	const int fd = ::open(fname.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Unable to open the BSDF table " + fname +
+			": " + std::strerror(errno) + ".");
+	}
+	struct stat st;
+	if (::fstat(fd, &st) != 0 or st.st_size < off_t(sizeof(Header))) {
+		::close(fd);
+		throw std::runtime_error(fname + " is not a BSDF table.");
+	}
+	_size = st.st_size;
+	void * data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) {
+		throw std::runtime_error("Unable to map the BSDF table " + fname +
+			": " + std::strerror(errno) + ".");
+	}
+	_data = static_cast<const char *>(data);
+	_header = reinterpret_cast<const Header *>(_data);
+
+	// Check that every section lies within the file, where the header says
+	const Header & h = *_header;
+	const std::uint64_t cells = std::uint64_t(h.numIncident) * h.numLambdas;
+	const std::uint64_t values = cells * h.numSensors;
+	std::string error;
+	if (std::memcmp(h.magic, magic, sizeof(magic)) != 0) {
+		error = fname + " is not a BSDF table.";
+	} else if (h.version != version or h.headerSize != sizeof(Header)) {
+		error = fname + " is a BSDF table of an unsupported version.";
+	} else if (h.fileSize != _size or
+		h.incidentOffset != align(sizeof(Header)) or
+		h.lambdaOffset != h.incidentOffset +
+			align(h.numIncident * sizeof(Incident)) or
+		h.sensorOffset != h.lambdaOffset +
+			align(h.numLambdas * sizeof(double)) or
+		h.raysOffset != h.sensorOffset +
+			align(h.numSensors * sizeof(Sensor)) or
+		h.hitsOffset != h.raysOffset + align(cells * sizeof(std::int32_t)) or
+		h.bsdfOffset != h.hitsOffset + align(values * sizeof(std::int32_t)) or
+		h.fileSize != h.bsdfOffset + align(values * sizeof(double))) {
+		error = fname + " is corrupt.";
+	}
+	if (not error.empty()) {
+		::munmap(data, _size);
+		throw std::runtime_error(error);
+	}
+}
+
+BsdfTable::~BsdfTable()
+{
+	::munmap(const_cast<char *>(_data), _size);
+}
+
+void BsdfTable::writeText(std::ostream & os) const
+{
+	std::vector<Scalar> psa(numSensors());
+	for (int id=0; id<numSensors(); ++id) {
+		psa[id] = sensor(id).projectedSolidAngle;
+	}
+	std::vector<int> counts(numSensors());
+	os << ResultFile::textHeader << "\n";
+	for (int i=0; i<numIncident(); ++i) {
+		for (int l=0; l<numLambdas(); ++l) {
+			if (rays(i, l) <= 0) {
+				continue;
+			}
+			counts.assign(hits(i, l), hits(i, l) + numSensors());
+			ResultFile::writeCell(os, incident(i).polar, incident(i).azimuth,
+								  lambda(l), rays(i, l), counts, psa);
+		}
+	}
+	os.flush();
+}
+
+} // namespace nix
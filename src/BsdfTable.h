@@ -0,0 +1,188 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace nix {
+
+class ICollectorSphere;
+class ResultFile;
+
+/// The BRDF/BTDF measured by a PhotometerJob, as a binary table that can be
+/// memory mapped and sliced without parsing.
+///
+/// The file starts with a Header, which gives the dimensions of the table
+/// and the byte offset of each of its sections. Every section is an array of
+/// fixed-size, naturally aligned values, starting on an 8 byte boundary:
+///
+/// | Section   | Type                  | Shape                              |
+/// |-----------|-----------------------|------------------------------------|
+/// | incident  | Incident              | [incident]                         |
+/// | lambdas   | double                | [lambda], in nanometres            |
+/// | sensors   | Sensor                | [sensor]                           |
+/// | rays      | std::int32_t          | [incident][lambda]                 |
+/// | hits      | std::int32_t          | [incident][lambda][sensor]         |
+/// | bsdf      | double                | [incident][lambda][sensor]         |
+///
+/// The BSDF estimate of a sensor is the fraction of the rays that hit it,
+/// divided by its projected solid angle. Cells that weren't measured, e.g.
+/// those of other shards, have no rays and zero estimates.
+///
+/// Numbers are stored in the native byte order, so the files are only portable
+/// between machines that share it. A file is opened read only and mapped in
+/// whole; the accessors point into the mapping.
+class BsdfTable
+{
+  public:
+	/// The version of the format that is written.
+	static constexpr std::uint32_t version = 1;
+
+	/// The start of the file.
+	struct Header {
+		char magic[8];					///< "NIXBSDF" and a zero.
+		std::uint32_t version;			///< Format version.
+		std::uint32_t headerSize;		///< sizeof(Header).
+		std::uint32_t numIncident;		///< Incident angles.
+		std::uint32_t numLambdas;		///< Wavelengths.
+		std::uint32_t numSensors;		///< Sensors of the collector sphere.
+		std::uint32_t reserved;			///< Zero.
+		std::uint64_t seed;				///< Seed of the random streams.
+		std::uint64_t incidentOffset;	///< Byte offset of the incident angles.
+		std::uint64_t lambdaOffset;		///< Byte offset of the wavelengths.
+		std::uint64_t sensorOffset;		///< Byte offset of the sensors.
+		std::uint64_t raysOffset;		///< Byte offset of the rays.
+		std::uint64_t hitsOffset;		///< Byte offset of the hits.
+		std::uint64_t bsdfOffset;		///< Byte offset of the estimates.
+		std::uint64_t fileSize;			///< Size of the whole file.
+	};
+
+	/// An incident direction, in radians.
+	struct Incident {
+		double polar;					///< Polar angle.
+		double azimuth;					///< Azimuth.
+	};
+
+	/// The geometry of a sensor of the collector sphere.
+	struct Sensor {
+		double polar;					///< Polar angle of the centre.
+		double azimuth;					///< Azimuth of the centre.
+		double solidAngle;				///< Solid angle.
+		double projectedSolidAngle;		///< Projected solid angle.
+	};
+
+	/// Write the table of a job. It is written to a temporary file which then
+	/// replaces \p fname with ResultFile::replace(), so that an interrupted
+	/// write, or a crash of the machine, leaves either the new table or any
+	/// previous one intact.
+	/// \param fname The name of the file.
+	/// \param results The results of the job, whose complete cells are
+	///        written.
+	/// \param sphere The collector sphere of the job.
+	/// \throws Throws std::runtime_error if the file can't be written, or if
+	///         the sphere has a different number of sensors than the results.
+	static void write(const std::string & fname, const ResultFile & results,
+					  const ICollectorSphere & sphere);
+
+	/// Map a table.
+	/// \param fname The name of the file.
+	/// \throws Throws std::runtime_error if the file can't be mapped, or is
+	///         not a valid table.
+	explicit BsdfTable(const std::string & fname);
+
+	/// Unmap the table.
+	~BsdfTable();
+
+	/// The table is not copyable.
+	BsdfTable(const BsdfTable &) = delete;
+
+	/// The table is not assignable.
+	/// \return Never returns.
+	BsdfTable & operator=(const BsdfTable &) = delete;
+
+	/// Get the header of the table.
+	/// \return Returns a reference into the mapping.
+	const Header & header() const noexcept { return *_header; }
+
+	/// Get the number of incident angles.
+	/// \return Returns the size of the first dimension.
+	int numIncident() const noexcept { return _header->numIncident; }
+
+	/// Get the number of wavelengths.
+	/// \return Returns the size of the second dimension.
+	int numLambdas() const noexcept { return _header->numLambdas; }
+
+	/// Get the number of sensors.
+	/// \return Returns the size of the third dimension.
+	int numSensors() const noexcept { return _header->numSensors; }
+
+	/// Get an incident angle.
+	/// \param i The index of the angle, in [0, numIncident()).
+	/// \return Returns a reference into the mapping.
+	const Incident & incident(int i) const noexcept
+	{ return at<Incident>(_header->incidentOffset)[i]; }
+
+	/// Get a wavelength.
+	/// \param l The index of the wavelength, in [0, numLambdas()).
+	/// \return Returns the wavelength in nanometres.
+	double lambda(int l) const noexcept
+	{ return at<double>(_header->lambdaOffset)[l]; }
+
+	/// Get the geometry of a sensor.
+	/// \param id The ID of the sensor, in [0, numSensors()).
+	/// \return Returns a reference into the mapping.
+	const Sensor & sensor(int id) const noexcept
+	{ return at<Sensor>(_header->sensorOffset)[id]; }
+
+	/// Get the rays cast into a cell.
+	/// \param i The index of the incident angle.
+	/// \param l The index of the wavelength.
+	/// \return Returns zero if the cell wasn't measured.
+	int rays(int i, int l) const noexcept
+	{ return at<std::int32_t>(_header->raysOffset)[cell(i, l)]; }
+
+	/// Get the hits on every sensor of a cell.
+	/// \param i The index of the incident angle.
+	/// \param l The index of the wavelength.
+	/// \return Returns numSensors() counts in the mapping.
+	const std::int32_t * hits(int i, int l) const noexcept
+	{ return at<std::int32_t>(_header->hitsOffset) + cell(i, l) * numSensors(); }
+
+	/// Get the BSDF estimate of every sensor of a cell.
+	/// \param i The index of the incident angle.
+	/// \param l The index of the wavelength.
+	/// \return Returns numSensors() estimates in the mapping.
+	const double * bsdf(int i, int l) const noexcept
+	{ return at<double>(_header->bsdfOffset) + cell(i, l) * numSensors(); }
+
+	/// Write the measured cells as text, in the format of the output of a
+	/// job, for humans.
+	/// \param os The stream to write to.
+	void writeText(std::ostream & os) const;
+
+  private:
+	/// Get the index of a cell.
+	/// \param i The index of the incident angle.
+	/// \param l The index of the wavelength.
+	/// \return Returns i * numLambdas() + l.
+	std::size_t cell(int i, int l) const noexcept
+	{ return std::size_t(i) * numLambdas() + l; }
+
+	/// Get a section of the mapping.
+	/// \param offset The byte offset of the section.
+	/// \return Returns a pointer to the start of the section.
+	template<typename T>
+	const T * at(std::uint64_t offset) const noexcept
+	{ return reinterpret_cast<const T *>(_data + offset); }
+
+	const char * _data;				///< Mapping of the whole file
+	std::size_t _size;				///< Size of the mapping
+	const Header * _header;			///< Start of the mapping
+};
+
+} // namespace nix
@@ -5,31 +5,123 @@
 
 #include "CollectorSphere.h"
 
+#include <Ray3.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 
 namespace nix {
 
-CollectorSphere::CollectorSphere(int /*numSensors*/)
- : ICollectorSphere()/*, _sensors(numSensors, Sensor())*/
+CollectorSphere::CollectorSphere(int numSensors)
+ : ICollectorSphere(), _sensors(numSensors, Sensor())
 {
 }
 
-void CollectorSphere::initSensors(int /*numSensors*/)
+void CollectorSphere::initSensors(int numSensors)
 {
+	_sensors.assign(numSensors, Sensor());
 }
 
 void CollectorSphere::Clear()
 {
+	for (auto & sensor : _sensors) {
+		sensor._count = 0;
+	}
 }
 
-void CollectorSphere::Record(const Ray3& /*photon*/)
+void CollectorSphere::Record(const Ray3& photon)
 {
+	int id = getSensorId(photon);
+	if (id >= 0) {
+		++_sensors[id]._count;
+	}
 }
 
-int CollectorSphere::hits(int /*sensorId*/) const
+int CollectorSphere::hits(int sensorId) const
 {
-	return 0;
+	return _sensors.at(sensorId)._count;
 }
 
-} // namespace nix
+CollectorSphere::Histogram::Histogram(int numSensors)
+{
+	// One cache line of slack to align the start, and one of padding after.
+	constexpr std::size_t line = 64 / sizeof(int);
+	_storage.reset(new int[numSensors + 2 * line]());
+	auto address = reinterpret_cast<std::uintptr_t>(_storage.get());
+	auto offset = (64 - address % 64) % 64 / sizeof(int);
+	_counts = _storage.get() + offset;
+}
+
+void CollectorSphere::initCells(int /*numCells*/, int numShards)
+{
+	_shards.clear();
+	for (int i=0; i<numShards; ++i) {
+		_shards.emplace_back(new Shard);
+	}
+}
+
+int * CollectorSphere::shard(int cell, int shard)
+{
+	Shard & s = *_shards[shard];
+	std::lock_guard<std::mutex> guard(s.lock);
+	auto it = s.cells.find(cell);
+	if (it == s.cells.end()) {
+		it = s.cells.emplace(cell, Histogram(numSensors())).first;
+	}
+	return it->second.counts();
+}
 
+void CollectorSphere::Record(const Ray3& photon, int * counts) const
+{
+	int id = getSensorId(photon);
+	if (id >= 0) {
+		++counts[id];
+	}
+}
+
+void CollectorSphere::Record(const Scalar * x, const Scalar * y,
+	const Scalar * z, int count, int * counts) const
+{
+	// Sensor IDs are computed a block at a time, then binned.
+	constexpr int blockSize = 256;
+	int ids[blockSize];
+	for (int first=0; first<count; first+=blockSize) {
+		const int n = std::min(blockSize, count - first);
+		getSensorIds(x + first, y + first, z + first, n, ids);
+		for (int i=0; i<n; ++i) {
+			if (ids[i] >= 0) {
+				++counts[ids[i]];
+			}
+		}
+	}
+}
+
+void CollectorSphere::getSensorIds(const Scalar * x, const Scalar * y,
+	const Scalar * z, int count, int * ids) const
+{
+	for (int i=0; i<count; ++i) {
+		ids[i] = getSensorId(Ray3(Point3::Origin, Vector3(x[i], y[i], z[i])));
+	}
+}
+
+std::vector<int> CollectorSphere::endCell(int cell)
+{
+	// Merge in shard order. Any fixed order would do for integer counts, but
+	// this keeps the result independent of the thread count by construction.
+	std::vector<int> counts(numSensors(), 0);
+	for (auto & pShard : _shards) {
+		std::lock_guard<std::mutex> guard(pShard->lock);
+		auto it = pShard->cells.find(cell);
+		if (it != pShard->cells.end()) {
+			const int * shardCounts = it->second.counts();
+			for (unsigned i=0; i<counts.size(); ++i) {
+				counts[i] += shardCounts[i];
+			}
+			pShard->cells.erase(it);
+		}
+	}
+	return counts;
+}
+
+} // namespace nix
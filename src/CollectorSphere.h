@@ -8,6 +8,9 @@
 #include <Scalar.h>
 #include <SphericalCoordinates.h>
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace nix {
@@ -35,10 +38,29 @@ class CollectorSphere : virtual public ICollectorSphere
 	/// \copydoc ICollectorSphere::hits(int)
 	int hits(int sensorId) const override;
 
+	/// \copydoc ICollectorSphere::initCells(int, int)
+	void initCells(int numCells, int numShards) final;
+	/// \copydoc ICollectorSphere::shard(int, int)
+	int * shard(int cell, int shard) final;
+	/// \copydoc ICollectorSphere::Record(const Ray3&, int*) const
+	void Record(const Ray3& photon, int * counts) const final;
+	/// \copydoc ICollectorSphere::Record(const Scalar*, const Scalar*, const Scalar*, int, int*) const
+	void Record(const Scalar * x, const Scalar * y, const Scalar * z,
+				int count, int * counts) const final;
+	/// \copydoc ICollectorSphere::endCell(int)
+	std::vector<int> endCell(int cell) final;
+
+	/// Fall back on one getSensorId(const Ray3&) call per direction. Derived
+	/// classes should override this with a loop that the compiler can inline
+	/// and vectorize.
+	/// \copydetails ICollectorSphere::getSensorIds()
+	void getSensorIds(const Scalar * x, const Scalar * y, const Scalar * z,
+					  int count, int * ids) const override;
+
   protected:
 	/// Derived classes can use this method to set the number of sensors
 	void initSensors(int numSensors);
-	
+
   private:
 	/// Helper class to store sensor hit counts.
 	struct Sensor {
@@ -51,7 +73,35 @@ class CollectorSphere : virtual public ICollectorSphere
 	/// Each sensor has its own hit counts.  The sensor ID is used as
 	/// an index to this array.
 	std::vector<Sensor>	_sensors;
+
+	/// The hit counts of one cell recorded by one worker. The counts start on
+	/// a cache line boundary and are followed by a cache line of padding, so
+	/// that no two workers ever write to the same cache line.
+	class Histogram {
+	  public:
+		/// Allocate zeroed counts.
+		/// \param numSensors The number of counts.
+		explicit Histogram(int numSensors);
+
+		/// Get the aligned counts.
+		/// \return Returns an array of numSensors counts.
+		int * counts() const noexcept { return _counts; }
+
+	  private:
+		std::unique_ptr<int[]> _storage;	///< Over-allocated storage.
+		int * _counts;						///< Aligned start of the counts.
+	};
+
+	/// The histograms of one worker, keyed by cell. The lock is only ever
+	/// contended when a completed cell is merged.
+	struct Shard {
+		std::mutex lock;					///< Guards the map, not the counts.
+		std::map<int, Histogram> cells;		///< Histograms of open cells.
+		char padding[64];					///< Keeps neighbours off this line.
+	};
+
+	/// One shard per worker thread.
+	std::vector<std::unique_ptr<Shard>> _shards;
 };
 
 } // namespace nix
-
@@ -6,6 +6,17 @@
 #include "LuaGlobal.h"
 
 #include <ICollectorSphere.h>
+#include <Intersection.h>
+#include <ISpecimen.h>
+#include <RandomScatterRecord.h>
+#include <RandomStream.h>
+#include <RayResult.h>
+#include <SpectralSample.h>
+#include <VacuumMedium.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 #include <iostream>
 #include <memory>
@@ -36,18 +47,162 @@ void CollimatedBeamPhotometer::SetCollectorSphere(std::unique_ptr<ICollectorSphe
 	_cs = std::move(cs);
 }
 
+ICollectorSphere & CollimatedBeamPhotometer::collectorSphere() const
+{
+	if (!_cs) {
+		throw std::runtime_error("No collector sphere set on the photometer.");
+	}
+	return *_cs;
+}
+
+constexpr Scalar CollimatedBeamPhotometer::maxWeight;
+constexpr int CollimatedBeamPhotometer::waveSize;
+
+void CollimatedBeamPhotometer::Cast(const ISpecimen & specimen,
+	const SphericalCoordinates & incident, const SpectralSample & packet,
+	int firstCell, std::uint64_t seed, std::uint32_t incidentIndex,
+	std::uint32_t lambdaIndex, int firstRay, int numRays, unsigned worker)
+{
+	static const VacuumMedium ambient;
+
+	// Every ray of a collimated beam strikes the specimen at the origin,
+	// arriving from the incident direction.
+	const Vector3 toSource = incident.toVector();
+	const Ray3 ray(Point3::Origin + toSource,
+				   Vector3(-toSource.x, -toSource.y, -toSource.z));
+	const Intersection x(ray, incident.radius());
+
+	// Exit directions are gathered in structure-of-arrays form and binned a
+	// block at a time. The sensor IDs are shared by every wavelength of the
+	// packet; only the number of hits differs.
+	constexpr int blockSize = 256;
+	const int numLambdas = packet.size();
+	Scalar dx[blockSize], dy[blockSize], dz[blockSize];
+	int ids[blockSize];
+	std::vector<int> hits(blockSize * numLambdas);
+	int numExits = 0;
+
+	ICollectorSphere & cs = collectorSphere();
+	std::vector<int *> counts(numLambdas);
+	for (int j=0; j<numLambdas; ++j) {
+		counts[j] = cs.shard(firstCell + j, worker);
+	}
+
+	// Tracing and binning alternate a block at a time, so each is timed by
+	// reading the clock at the block boundaries.
+	using Clock = JobStatistics::Clock;
+	const bool timing = _stats.timing();
+	Clock::time_point start;
+	Clock::duration traceTime(0), binTime(0);
+	if (timing) {
+		start = Clock::now();
+	}
+	long long collected = 0;
+	auto flush = [&]() {
+		Clock::time_point binStart;
+		if (timing) {
+			binStart = Clock::now();
+			traceTime += binStart - start;
+		}
+		cs.getSensorIds(dx, dy, dz, numExits, ids);
+		for (int j=0; j<numLambdas; ++j) {
+			const int * h = &hits[j * blockSize];
+			for (int i=0; i<numExits; ++i) {
+				if (ids[i] >= 0) {
+					counts[j][ids[i]] += h[i];
+					collected += h[i];
+				}
+			}
+		}
+		numExits = 0;
+		if (timing) {
+			start = Clock::now();
+			binTime += start - binStart;
+		}
+	};
+
+	// The rays are handed to the specimen a wave at a time, so that it can
+	// trace them together.
+	const int numRecords = std::min(numRays, waveSize);
+	std::vector<RandomScatterRecord> records(numRecords,
+		RandomScatterRecord(RandomStream(seed, incidentIndex, lambdaIndex,
+										 firstRay)));
+	std::vector<Interaction> results(numRecords);
+	for (int first=0; first<numRays; first+=waveSize) {
+		const int count = std::min(waveSize, numRays - first);
+		for (int i=0; i<count; ++i) {
+			// Rotate the hero through the packet from ray to ray
+			const int rayIndex = firstRay + first + i;
+			records[i].reset(
+				RandomStream(seed, incidentIndex, lambdaIndex, rayIndex),
+				numLambdas, rayIndex % numLambdas);
+		}
+		specimen.ScatterBatch(x, packet, ambient, records.data(),
+							  results.data(), count);
+
+		for (int i=0; i<count; ++i) {
+			if (results[i] == Interaction::absorbed) {
+				continue;
+			}
+
+			// Turn each weight into whole hits without bias: its integer
+			// part, plus one more with a probability of its fractional part.
+			// All the wavelengths share one random number, which is only
+			// drawn if needed.
+			RandomScatterRecord & sr = records[i];
+			Scalar u = -1;
+			for (int j=0; j<numLambdas; ++j) {
+				const Scalar w = std::min(sr.weights[j], maxWeight);
+				Scalar whole = 0;
+				if (w > 0) {
+					whole = std::floor(w);
+					if (w > whole) {
+						if (u < 0) {
+							u = sr.random.uniform();
+						}
+						whole += u < w - whole ? 1 : 0;
+					}
+				}
+				hits[j * blockSize + numExits] = static_cast<int>(whole);
+			}
+			dx[numExits] = sr.exit.d.x;
+			dy[numExits] = sr.exit.d.y;
+			dz[numExits] = sr.exit.d.z;
+			if (++numExits == blockSize) {
+				flush();
+			}
+		}
+	}
+	flush();
+
+	long long events = 0, particles = 0;
+	for (const RandomScatterRecord & sr : records) {
+		events += sr.events;
+		particles += sr.particles;
+	}
+	_stats.add(worker, JobStatistics::Counter::raysCast, numRays);
+	_stats.add(worker, JobStatistics::Counter::scatteringEvents, events);
+	_stats.add(worker, JobStatistics::Counter::particlesGenerated, particles);
+	_stats.add(worker, JobStatistics::Counter::collectorHits, collected);
+	if (timing) {
+		_stats.add(worker, JobStatistics::Stage::trace, traceTime);
+		_stats.add(worker, JobStatistics::Stage::bin, binTime);
+	}
+}
+
 std::string CollimatedBeamPhotometer::type() const noexcept
 {
 	return _type;
 }
 
-void CollimatedBeamPhotometer::setCollectStatistics(bool /*collectStats*/)
+void CollimatedBeamPhotometer::setCollectStatistics(bool collectStats)
 {
+	_stats.setTiming(collectStats);
 }
 
 bool CollimatedBeamPhotometer::isCollectingStats() const
 {
-	return false;
+	return _stats.timing();
 }
 
 void CollimatedBeamPhotometer::print(std::ostream & /*os*/) const
@@ -4,10 +4,12 @@
  ***************************************************************************/
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <iosfwd>
 #include <memory>
 
+#include <JobStatistics.h>
 #include <Scalar.h>
 #include <SphericalCoordinates.h>
 
@@ -17,6 +19,7 @@ class ICollectorSphere;
 class Intersection;
 class ISpecimen;
 class ScatteringData;
+class SpectralSample;
 
 /**
  * Concrete representation of a Collimated Beam Photometer.
@@ -35,8 +38,8 @@ class CollimatedBeamPhotometer
 	/// Default construct a CollimatedBeamPhotometer.
 	/// Constructed with an intersection point at the origin illuminated from
 	/// the zenith toward nadir, no collector sphere, no specimen, an
-	/// unrealistic wavelength of zero, zero rays to cast, and no statistics
-	/// being collected.
+	/// unrealistic wavelength of zero, zero rays to cast, and the stages of
+	/// Cast() being timed.
 	CollimatedBeamPhotometer();
 
 	/// Non-trivial destructor.
@@ -46,9 +49,20 @@ class CollimatedBeamPhotometer
 	/// Return some std::string useful for printing debug output.
 	std::string type() const noexcept;
 
-	/// Query the number of rays cast so far.
+	/// Query the number of rays cast since the statistics were last reset.
 	/// \return The return value is \f$ \ge 0 \f$.
-	unsigned numPhotonsCast() const { return 0; }
+	long long numPhotonsCast() const noexcept
+		{ return _stats.total(JobStatistics::Counter::raysCast); }
+
+	/// Provide access to the throughput counters. Cast() counts into the
+	/// slot of its worker, so the statistics must be reset() with at least
+	/// as many slots as there are workers.
+	/// \return Returns a reference to the statistics.
+	JobStatistics & statistics() noexcept { return _stats; }
+
+	/// Provide const access to the throughput counters.
+	/// \return Returns a const reference to the statistics.
+	const JobStatistics & statistics() const noexcept { return _stats; }
 
 	/// Query the wavelength currently being tested.
 	/// \return Returns the wavelength in nanometres.
@@ -63,16 +77,63 @@ class CollimatedBeamPhotometer
 	/// \param cs A unique pointer to an ICollectorSphere.
 	void SetCollectorSphere(std::unique_ptr<ICollectorSphere> cs);
 
-	/// Set whether or not statistics will be colleced with this execution.
-	/// Collecting statistics has a performance impact by introducing an extra
-	/// point of thread contention, since the statistics object needs to be
-	/// written to with mutual exclusion.
+	/// Provide access to the collector sphere.
+	/// \throws Throws std::runtime_error if no collector sphere has been set.
+	/// \return Returns a reference to the collector sphere.
+	ICollectorSphere & collectorSphere() const;
+
+	/// Cast a run of rays at a specimen and record the exiting rays against
+	/// measurement cells of the collector sphere. This is safe to call
+	/// concurrently from many threads, as long as ICollectorSphere::initCells()
+	/// has been called on the collector sphere beforehand and each thread
+	/// passes its own worker index. The hits are recorded in the worker's
+	/// private shard, so no memory is shared between workers per photon.
+	///
+	/// The rays are scattered a wave of waveSize rays at a time, with
+	/// ISpecimen::ScatterBatch().
+	///
+	/// Each ray is traced once for a whole packet of wavelengths, with the
+	/// hero wavelength rotating through the packet from ray to ray. The
+	/// weight the specimen leaves for each wavelength is turned into a whole
+	/// number of hits, without bias, so the histograms remain counts. A
+	/// packet of a single wavelength is a conventional, one wavelength, trace.
 	///
-	/// \param collectStats If true, statistics will be collected.
+	/// Each ray draws its random numbers from its own RandomStream, keyed by
+	/// the seed, the incident and wavelength indices and the ray index, so the
+	/// rays cast are the same no matter how a cell is split between calls.
+	///
+	/// \param specimen The material being measured.
+	/// \param incident The direction the collimated beam comes from.
+	/// \param packet The wavelengths, in nanometres, to trace together.
+	/// \param firstCell The measurement cell of the first wavelength of the
+	///        packet. The other wavelengths use the cells that follow it.
+	/// \param seed The seed of the job.
+	/// \param incidentIndex The index of the incident angle in the job.
+	/// \param lambdaIndex The index of the first wavelength in the job.
+	/// \param firstRay The index of the first ray to cast within the cell.
+	/// \param numRays The number of rays to cast.
+	/// \param worker The index of the calling worker thread.
+	void Cast(const ISpecimen & specimen, const SphericalCoordinates & incident,
+			  const SpectralSample & packet, int firstCell, std::uint64_t seed,
+			  std::uint32_t incidentIndex, std::uint32_t lambdaIndex,
+			  int firstRay, int numRays, unsigned worker);
+
+	/// The most hits a single ray may count for at one wavelength. This guards
+	/// against overflow from the weights of very unlikely paths.
+	static constexpr Scalar maxWeight = 1 << 16;
+
+	/// The number of rays handed to ISpecimen::ScatterBatch() at once.
+	static constexpr int waveSize = 1024;
+
+	/// Set whether or not the stages of the pipeline are timed. The counters
+	/// are always kept, since each worker counts into its own slot, once per
+	/// block of rays. Timing adds a few reads of the clock per block.
+	///
+	/// \param collectStats If true, the stages will be timed.
 	void setCollectStatistics(bool collectStats);
 
-	/// Check if the flag is set to collect statistics during program execution.
-	/// \return Returns \c true if statistics are being collected.
+	/// Check if the stages of the pipeline are timed.
+	/// \return Returns \c true if the stages are timed.
 	bool isCollectingStats() const;
 
 	/// Output the instance to the specified stream in a human readable format.
@@ -84,6 +145,9 @@ class CollimatedBeamPhotometer
 
 	/// The collector sphere used to collect results.
 	std::unique_ptr<ICollectorSphere> _cs;
+
+	/// Throughput counters of the workers calling Cast().
+	JobStatistics _stats;
 };
 
 /// Output a CollimatedBeamPhotometer to the specified output stream in a
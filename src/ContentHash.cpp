@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "ContentHash.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace nix {
+
+namespace {
+
+/// The finalizer of SplitMix64, a bijection whose every output bit depends
+/// on every input bit.
+std::uint64_t mix(std::uint64_t x) noexcept
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+/// Get the bits of a double, to hash it.
+std::uint64_t bits(double value) noexcept
+{
+	std::uint64_t word;
+	std::memcpy(&word, &value, sizeof(word));
+	return word;
+}
+
+} // namespace
+
+ContentHash::ContentHash()
+  : _a(0x243f6a8885a308d3ull), _b(0x13198a2e03707344ull), _words(0)
+{
+}
+
+void ContentHash::addWord(std::uint64_t word) noexcept
+{
+	_a = mix(_a ^ word);
+	_b = mix(((_b << 23) | (_b >> 41)) + word * 0x9e3779b97f4a7c15ull);
+	++_words;
+}
+
+ContentHash & ContentHash::addInteger(std::int64_t value) noexcept
+{
+	addWord(static_cast<std::uint64_t>(value));
+	return *this;
+}
+
+ContentHash & ContentHash::addScalar(Scalar value) noexcept
+{
+	const double high = static_cast<double>(value);
+	addWord(bits(high));
+	addWord(bits(static_cast<double>(value - high)));
+	return *this;
+}
+
+ContentHash & ContentHash::addScalars(const std::vector<Scalar> & values)
+	noexcept
+{
+	addWord(values.size());
+	for (Scalar value : values) {
+		addScalar(value);
+	}
+	return *this;
+}
+
+ContentHash & ContentHash::addDoubles(const std::vector<double> & values)
+	noexcept
+{
+	addWord(values.size());
+	for (double value : values) {
+		addWord(bits(value));
+	}
+	return *this;
+}
+
+ContentHash & ContentHash::addString(const std::string & value) noexcept
+{
+	addWord(value.size());
+	for (std::size_t i=0; i<value.size(); i+=8) {
+		std::uint64_t word = 0;
+		std::memcpy(&word, value.data() + i, std::min<std::size_t>(8,
+			value.size() - i));
+		addWord(word);
+	}
+	return *this;
+}
+
+std::string ContentHash::hex() const
+{
+	const std::uint64_t words[2] = { mix(_a ^ mix(_words)), mix(_b ^ _a) };
+	static const char digits[] = "0123456789abcdef";
+	std::string text;
+	for (std::uint64_t word : words) {
+		for (int shift=60; shift>=0; shift-=4) {
+			text += digits[(word >> shift) & 0xf];
+		}
+	}
+	return text;
+}
+
+} // namespace nix
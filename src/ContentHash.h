@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include <Scalar.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nix {
+
+/// A 128 bit hash of the content of a configuration, e.g. to key cached
+/// results.
+///
+/// Values are added one at a time, and the hash depends on their order, on
+/// their types' encodings and on their values, but not on how they are laid
+/// out in memory. Vectors and strings are prefixed by their sizes, so that
+/// adjacent ones can't run into each other. Scalars are added as the sum of
+/// two doubles, as in ResultFile, so the padding of long doubles is never
+/// hashed.
+///
+/// The hash is not cryptographic. It mixes every 64 bit word into two lanes
+/// of different structure, which makes accidental collisions negligible, but
+/// it must not be relied upon against deliberate ones.
+class ContentHash
+{
+  public:
+	/// Start an empty hash.
+	ContentHash();
+
+	/// Add an integer, or a flag.
+	/// \param value The value.
+	/// \return Returns this hash, for chaining.
+	ContentHash & addInteger(std::int64_t value) noexcept;
+
+	/// Add a Scalar.
+	/// \param value The value, which is added exactly for Scalars of up to
+	///        106 bits of precision.
+	/// \return Returns this hash, for chaining.
+	ContentHash & addScalar(Scalar value) noexcept;
+
+	/// Add a vector of Scalars, and its size.
+	/// \param values The values.
+	/// \return Returns this hash, for chaining.
+	ContentHash & addScalars(const std::vector<Scalar> & values) noexcept;
+
+	/// Add a vector of doubles, and its size.
+	/// \param values The values.
+	/// \return Returns this hash, for chaining.
+	ContentHash & addDoubles(const std::vector<double> & values) noexcept;
+
+	/// Add a string, and its size.
+	/// \param value The string.
+	/// \return Returns this hash, for chaining.
+	ContentHash & addString(const std::string & value) noexcept;
+
+	/// Get the hash of everything added so far. More may be added afterwards.
+	/// \return Returns 32 lower case hexadecimal digits.
+	std::string hex() const;
+
+  private:
+	/// Mix a word into both lanes.
+	/// \param word The word.
+	void addWord(std::uint64_t word) noexcept;
+
+	std::uint64_t _a;				///< First lane
+	std::uint64_t _b;				///< Second lane
+	std::uint64_t _words;			///< Number of words added
+};
+
+} // namespace nix
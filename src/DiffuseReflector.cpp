@@ -5,16 +5,29 @@
 
 #include "DiffuseReflector.h"
 
+#include "ContentHash.h"
+#include "Intersection.h"
+#include "RandomScatterRecord.h"
 #include "RayResult.h"
 
+#include <cmath>
+
 namespace nix {
 
 const RayResult
-DiffuseReflector::Scatter(const Intersection & /*x*/,
+DiffuseReflector::Scatter(const Intersection & x,
 						  const SpectralSample & /*ss*/,
 						  const IMedium &,
-						  RandomScatterRecord & /*sr*/) const
+						  RandomScatterRecord & sr) const
 {
+	// Cosine weighted direction about the surface normal, the z axis
+	++sr.events;
+	const Scalar u1 = sr.random.uniform();
+	const Scalar u2 = sr.random.uniform();
+	const Scalar r = std::sqrt(u1);
+	const Scalar phi = 2 * M_PI * u2;
+	sr.exit = Ray3(x.p, Vector3(r * std::cos(phi), r * std::sin(phi),
+								std::sqrt(1 - u1)));
 	return RayResult(Interaction::reflected);
 }
 
@@ -24,5 +37,10 @@ std::string & DiffuseReflector::name() const
 	return name;
 }
 
+void DiffuseReflector::fingerprint(ContentHash & hash) const
+{
+	hash.addString("DiffuseReflector");
+}
+
 } // namespace nix
 
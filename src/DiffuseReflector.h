@@ -23,7 +23,9 @@ class DiffuseReflector : virtual public ISpecimen
 	/// Default virtual destructor.
 	virtual ~DiffuseReflector() = default;
 
-	/// Return a random direction, since this is diffuse.
+	/// Return a random direction, since this is diffuse. The direction is
+	/// cosine weighted about the z axis and drawn from the record's
+	/// RandomStream.
 	/// @param x The intersection point is stored as part of the resulting
 	///        RandomScatterRecord.
 	/// @param ss Stored as part of the resulting RandomScatterRecord.
@@ -39,6 +41,10 @@ class DiffuseReflector : virtual public ISpecimen
 	/// Return the name of the string.
 	/// @return Returns "diffuse".
 	std::string & name() const override;
+
+	/// The reflector has no parameters, so only its type is added.
+	/// \copydetails ISpecimen::fingerprint()
+	void fingerprint(ContentHash & hash) const override;
 };
 
 } // namespace nix
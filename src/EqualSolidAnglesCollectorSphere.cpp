@@ -4,42 +4,103 @@
  ***************************************************************************/
 #include "EqualSolidAnglesCollectorSphere.h"
 
+#include <ContentHash.h>
+#include <Ray3.h>
+
 #include <cassert>
 #include <cmath>
+#include <stdexcept>
 
 #include <iostream>
 
 namespace nix {
 
+constexpr Scalar EqualSolidAnglesCollectorSphere::_twoPi;
+
 EqualSolidAnglesCollectorSphere::EqualSolidAnglesCollectorSphere(
-		int /*stacks*/, int /*slices*/, bool /*upper*/, bool /*lower*/)
-  : CollectorSphere(0)
+		int stacks, int slices, bool upper, bool lower)
+  : CollectorSphere(0), _stacks(std::max(stacks, 1)),
+	_slices(std::max(slices, 1)), _upper(upper), _lower(lower)
 {
+	const int perHemisphere = _stacks * _slices;
+	_upperOffset = _upper ? 0 : -1;
+	_lowerOffset = _lower ? (_upper ? perHemisphere : 0) : -1;
+	_slicesPerRadian = _slices / _twoPi;
+
+	// Tabulate the sensor geometry, one hemisphere at a time
+	const Scalar dPhi = _twoPi / _slices;
+	for (int hemisphere=0; hemisphere<2; ++hemisphere) {
+		if ((hemisphere == 0 and !_upper) or (hemisphere == 1 and !_lower)) {
+			continue;
+		}
+		for (int stack=0; stack<_stacks; ++stack) {
+			const Scalar cosHigh = 1 - static_cast<Scalar>(stack) / _stacks;
+			const Scalar cosLow = 1 - static_cast<Scalar>(stack + 1) / _stacks;
+			Scalar polar = std::acos((cosHigh + cosLow) / 2);
+			if (hemisphere == 1) {
+				polar = M_PI - polar;
+			}
+			const Scalar solidAngle = dPhi * (cosHigh - cosLow);
+			const Scalar projected =
+				dPhi * (cosHigh * cosHigh - cosLow * cosLow) / 2;
+			for (int slice=0; slice<_slices; ++slice) {
+				_centers.emplace_back(polar, (slice + 0.5) * dPhi);
+				_solidAngles.push_back(solidAngle);
+				_projectedSolidAngles.push_back(projected);
+			}
+		}
+	}
+	initSensors(_centers.size());
 }
 
 EqualSolidAnglesCollectorSphere::~EqualSolidAnglesCollectorSphere()
 {
 }
 
-SphericalCoordinates EqualSolidAnglesCollectorSphere::center(int /*sensorId*/) const
+void EqualSolidAnglesCollectorSphere::checkSensorId(int sensorId) const
 {
-	return SphericalCoordinates(0, 0);
+	if (sensorId < 0 or sensorId >= numSensors()) {
+		throw std::out_of_range("Sensor ID out of range.");
+	}
 }
 
-Scalar EqualSolidAnglesCollectorSphere::getSolidAngle(int /*sensorId*/) const
+SphericalCoordinates EqualSolidAnglesCollectorSphere::center(int sensorId) const
 {
-	return 0.0;
+	checkSensorId(sensorId);
+	return _centers[sensorId];
 }
 
-Scalar EqualSolidAnglesCollectorSphere::getProjectedSolidAngle(int /*sensorId*/) const
+Scalar EqualSolidAnglesCollectorSphere::getSolidAngle(int sensorId) const
 {
-	return 0;
+	checkSensorId(sensorId);
+	return _solidAngles[sensorId];
 }
 
-int EqualSolidAnglesCollectorSphere::getSensorId(const Ray3& /*photon*/) const
+Scalar EqualSolidAnglesCollectorSphere::getProjectedSolidAngle(int sensorId) const
 {
-	return 0;
+	checkSensorId(sensorId);
+	return _projectedSolidAngles[sensorId];
 }
 
-} // namespace nix
+int EqualSolidAnglesCollectorSphere::getSensorId(const Ray3& photon) const
+{
+	return sensorId(photon.d.x, photon.d.y, photon.d.z);
+}
 
+void EqualSolidAnglesCollectorSphere::getSensorIds(const Scalar * x,
+	const Scalar * y, const Scalar * z, int count, int * ids) const
+{
+	for (int i=0; i<count; ++i) {
+		ids[i] = sensorId(x[i], y[i], z[i]);
+	}
+}
+
+void EqualSolidAnglesCollectorSphere::fingerprint(ContentHash & hash) const
+{
+	// The stacks and slices determine the whole geometry.
+	hash.addString("EqualSolidAnglesCollectorSphere");
+	hash.addInteger(_stacks).addInteger(_slices);
+	hash.addInteger(_upper).addInteger(_lower);
+}
+
+} // namespace nix
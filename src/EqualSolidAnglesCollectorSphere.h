@@ -8,11 +8,26 @@
 #include <Scalar.h>
 #include <SphericalCoordinates.h>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 namespace nix {
 
 /**
  * This ICollectorSphere class sub-divides the unit sphere into equal area
  * sensors.
+ *
+ * Each enabled hemisphere is cut into \c stacks rings of equal solid angle,
+ * which is the same as cutting \f$\cos\theta\f$ into equal intervals, and each
+ * ring is cut into \c slices equal azimuthal sectors. Sensor IDs run over the
+ * slices of a stack, then over the stacks from the pole to the horizon. The
+ * upper hemisphere, when enabled, comes first.
+ *
+ * Because the stacks are uniform in \f$\cos\theta\f$ and the slices are
+ * uniform in \f$\phi\f$, a sensor lookup is a handful of arithmetic operations
+ * and one \c atan2, with no searching. The sensor geometry is tabulated at
+ * construction.
  */
 class EqualSolidAnglesCollectorSphere : public CollectorSphere
 {
@@ -32,25 +47,71 @@ public:
 	Scalar getProjectedSolidAngle(int sensorId) const override;
 	/// \copydoc ICollectorSphere::getSensorId(int)
 	int getSensorId(const Ray3& photon) const override;
+	/// \copydoc ICollectorSphere::getSensorIds()
+	void getSensorIds(const Scalar * x, const Scalar * y, const Scalar * z,
+					  int count, int * ids) const override;
+	/// \copydoc ICollectorSphere::fingerprint()
+	void fingerprint(ContentHash & hash) const override;
 
 	/// Get the number of stacks.
 	/// \return Returns a positive integer if it is in a good state.
-	int stacks() const { return 0; }
+	int stacks() const { return _stacks; }
 
 	/// Get the number of slices.
 	/// \return Returns a positive integer if it is in a good state.
-	int slices() const { return 0; }
+	int slices() const { return _slices; }
 
 	/// Test if the upper hemisphere is enabled.
 	/// \return Returns true if the upper hemisphere is enabled.
-	bool upper() const { return true; }
+	bool upper() const { return _upper; }
 
 	/// Test if the lower hemisphere is enabled.
 	/// \return Returns true if the lower hemisphere is enabled.
-	bool lower() const { return false; }
+	bool lower() const { return _lower; }
 
 	virtual ~EqualSolidAnglesCollectorSphere();
+
+private:
+	/// Check that a sensor ID is in range.
+	/// \throws Throws std::out_of_range if sensorId is out of range.
+	/// \param sensorId The sensor ID to check.
+	void checkSensorId(int sensorId) const;
+
+	/// The lookup shared by the single and block versions.
+	/// \param x The x component of a unit direction.
+	/// \param y The y component of a unit direction.
+	/// \param z The z component of a unit direction.
+	/// \return Returns the struck sensor, or -1 if the hemisphere is disabled
+	///         or the direction is parallel to the horizon.
+	int sensorId(Scalar x, Scalar y, Scalar z) const noexcept
+	{
+		const Scalar cosTheta = std::abs(z);
+		const int offset = z > 0 ? _upperOffset : (z < 0 ? _lowerOffset : -1);
+
+		// cos(theta) maps linearly onto the stacks; phi onto the slices
+		int stack = static_cast<int>((1 - cosTheta) * _stacks);
+		stack = std::min(stack, _stacks - 1);
+		Scalar phi = std::atan2(y, x);
+		phi += phi < 0 ? _twoPi : 0;
+		int slice = static_cast<int>(phi * _slicesPerRadian);
+		slice = std::min(slice, _slices - 1);
+
+		return offset < 0 ? -1 : offset + stack * _slices + slice;
+	}
+
+	int _stacks;			///< Number of stacks per hemisphere.
+	int _slices;			///< Number of slices per stack.
+	bool _upper;			///< The upper hemisphere is enabled.
+	bool _lower;			///< The lower hemisphere is enabled.
+	int _upperOffset;		///< First sensor ID of the upper hemisphere, or -1.
+	int _lowerOffset;		///< First sensor ID of the lower hemisphere, or -1.
+	Scalar _slicesPerRadian;	///< Converts \f$\phi\f$ to a slice.
+
+	std::vector<SphericalCoordinates> _centers;	///< Sensor centers.
+	std::vector<Scalar> _solidAngles;			///< Sensor solid angles.
+	std::vector<Scalar> _projectedSolidAngles;	///< Projected solid angles.
+
+	static constexpr Scalar _twoPi = 2 * M_PI;	///< A full turn.
 };
 
 } // namespace nix
-
@@ -6,9 +6,11 @@
 
 #include <Scalar.h>
 #include <stdexcept>
+#include <vector>
 
 namespace nix {
 
+class ContentHash;
 class Ray3;
 class SphericalCoordinates;
 
@@ -28,6 +30,47 @@ class ICollectorSphere
 	///         collector sphere, but it's possible.
 	virtual int numSensors() const = 0;
 
+	/// Prepare to record the results of several measurement cells at once. A
+	/// measurement cell is one (incident angle, wavelength) pair of a
+	/// PhotometerJob. Hits are recorded in shards, each of which is private to
+	/// one worker thread. Any cells that are still open are discarded.
+	/// \param numCells The number of cells, which are numbered from zero.
+	/// \param numShards The number of worker threads that will record hits.
+	virtual void initCells(int numCells, int numShards) = 0;
+
+	/// Get the hit counts of a cell that are private to a worker thread. The
+	/// counts are allocated, zeroed, on first use. Only the worker that owns
+	/// the shard may call this, or record into the returned counts.
+	/// \param cell Valid values are \f$ 0 \le \f$ cell < numCells.
+	/// \param shard Valid values are \f$ 0 \le \f$ shard < numShards.
+	/// \return Returns an array of numSensors() counts, which remains valid
+	///         until endCell() is called for the cell.
+	virtual int * shard(int cell, int shard) = 0;
+
+	/// Record a datum into a shard obtained from shard(int, int).
+	/// \param photon The ray used to determine which patch was struck.
+	/// \param counts The shard's hit counts for the cell.
+	virtual void Record(const Ray3& photon, int * counts) const = 0;
+
+	/// Record a block of data into a shard obtained from shard(int, int). The
+	/// exit directions are given in structure-of-arrays form, and are binned
+	/// with a single virtual call for the whole block.
+	/// \param x The x components of the exit directions.
+	/// \param y The y components of the exit directions.
+	/// \param z The z components of the exit directions.
+	/// \param count The number of directions in each array.
+	/// \param counts The shard's hit counts for the cell.
+	virtual void Record(const Scalar * x, const Scalar * y, const Scalar * z,
+						int count, int * counts) const = 0;
+
+	/// Merge the shards of a cell and release them. The shards are summed in
+	/// shard order, so the result does not depend on which worker recorded
+	/// which hits. Hits recorded for the cell afterwards, e.g. by a further
+	/// round of rays, start again from zero.
+	/// \param cell Valid values are \f$ 0 \le \f$ cell < numCells.
+	/// \return Returns the number of hits on each sensor, indexed by sensor ID.
+	virtual std::vector<int> endCell(int cell) = 0;
+
   protected:
 	/// Compute which sensor was struck, if any, given a ray direction in the
 	/// sphere.
@@ -37,6 +80,16 @@ class ICollectorSphere
 	virtual int getSensorId(const Ray3& photon) const = 0;
 
   public:
+	/// Compute which sensor was struck for a block of directions. This is the
+	/// batch equivalent of getSensorId(const Ray3&).
+	/// \param x The x components of the directions.
+	/// \param y The y components of the directions.
+	/// \param z The z components of the directions.
+	/// \param count The number of directions in each array.
+	/// \param[out] ids Receives count sensor IDs, negative for no sensor.
+	virtual void getSensorIds(const Scalar * x, const Scalar * y,
+							  const Scalar * z, int count, int * ids) const = 0;
+
 	/// Query the location of the center a sensor in spherical coordinates.
 	/// \throw std::out_of_range Thrown when sensorId is out of range.
 	/// \param sensorId Valid values are \f$ 0 \le \f$ sensorId < numSensors().
@@ -61,6 +114,12 @@ class ICollectorSphere
 	/// \return The return value should be \f$ > 0\f$.
 	virtual Scalar getProjectedSolidAngle(int sensorId) const = 0;
 
+	/// Add the geometry of the sensors to a hash, e.g. to key cached results
+	/// by it. Collector spheres with equal hashes must bin every direction
+	/// into the same sensor.
+	/// \param hash The hash to add to.
+	virtual void fingerprint(ContentHash & hash) const = 0;
+
 	/// Default virtual destructor.
 	virtual ~ICollectorSphere() = default;
 };
@@ -10,23 +10,37 @@ namespace nix {
 
 class Interval;
 class Point3;
+class RandomStream;
 class Ray3;
 class Vector3;
 
-/// Pure virtual interface for a particle.
+/// Pure virtual interface for a particle. A particle is centred on the origin
+/// of its own coordinate system.
 class IParticle
 {
   public:
+	/// Find where a ray that starts inside the particle leaves it.
+	///
+	/// @param ray A ray whose origin is inside, or on, the particle.
+	/// @param[out] t The distance along the ray to the exit point.
+	/// @param[out] p The exit point.
+	/// @param[out] N The outward unit normal at the exit point.
+	/// @return Returns false if the ray does not leave the particle, which
+	///         only happens if it starts outside of it.
 	virtual bool GetExitPoint(const Ray3& ray, Scalar &t, Point3& p, Vector3& N) const = 0;
 	/// Get a random point on the hemispher of the particle's surface that is in
-	/// the direction of \c dir.
+	/// the direction of \c dir. The points are distributed uniformly over the
+	/// particle's projected area, as seen along \c dir, which is where a
+	/// random ray travelling along \c dir strikes the particle.
 	///
 	/// @param[out] p Out parameter storing the random point on the particle's
 	///               surface.
 	/// @param[out] N Out parameter storing the normal at that point.
 	/// @param dir The direction of the incoming ray is used to choose a point
 	///        on the correct hemisphere of the particle.
-	virtual void GetUniformRandomPoint(Point3& p, Vector3& N, const Vector3& dir) const = 0;
+	/// @param random The random numbers of the ray being traced.
+	virtual void GetUniformRandomPoint(Point3& p, Vector3& N, const Vector3& dir,
+									   RandomStream& random) const = 0;
 	virtual bool intersects(const Ray3& ray, const Interval& I) const = 0;
 	virtual bool intersects(const Ray3& ray) const = 0;
 
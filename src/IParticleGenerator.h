@@ -8,7 +8,10 @@
 
 namespace nix {
 
+class ContentHash;
 class IParticle;
+class ParticleArena;
+class RandomStream;
 
 /**
  * Interface for particle generation.
@@ -18,10 +21,15 @@ class IParticleGenerator
 {
   public:
 	/// Generate a new particle.
-	/// Memory is allocated by this method that must be freed by the called.
+	/// The particle is made in \p arena, which owns it. It must not be freed
+	/// by the caller, and is destroyed when the arena is reset.
+	/// @param random The random numbers of the ray the particle is generated
+	///        for.
+	/// @param arena The arena of the calling thread.
 	/// @return A new IParticle is returned.  Null is never returned, but errors
 	/// may be thrown.
-	virtual IParticle* generate() const = 0;
+	virtual IParticle* generate(RandomStream& random,
+								ParticleArena& arena) const = 0;
 
 	/// Get the average distance between the particles.
 	/// This is distance from the exit point of one particle to the entry point
@@ -29,6 +37,17 @@ class IParticleGenerator
 	/// \return Returns the average distance to use between the particles.
 	virtual Scalar averageParticleDistance() const noexcept = 0;
 
+	/// Add everything that the particles depend on to a hash, e.g. to key
+	/// cached results by it. Generators with equal hashes must generate the
+	/// same particles from the same random numbers.
+	/// @param hash The hash to add to.
+	virtual void fingerprint(ContentHash & hash) const = 0;
+
+	/// Are the generated particles SpheroidParticles? Their exits can then be
+	/// found in batches, without inspecting the type of every particle.
+	/// @return Returns true if generate() only makes SpheroidParticles.
+	virtual bool generatesSpheroids() const noexcept { return false; }
+
 	/// Default virtual destructor.
 	virtual ~IParticleGenerator() = default;
 };
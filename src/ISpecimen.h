@@ -4,14 +4,19 @@
  ***************************************************************************/
 #pragma once
 
+#include <RandomScatterRecord.h>
+#include <RayResult.h>
+
+#include <Scalar.h>
+
 #include <string>
+#include <vector>
 
 namespace nix {
 
+class ContentHash;
 class Intersection;
 class IMedium;
-class RandomScatterRecord;
-class RayResult;
 class SpectralSample;
 
 class ISpecimen
@@ -32,6 +37,43 @@ class ISpecimen
 									const IMedium & ambient,
 									RandomScatterRecord & sr) const = 0;
 
+	/// Scatter a batch of rays that strike the specimen at the same point
+	/// with the same wavelengths. Every ray has its own record, with its own
+	/// random stream, weights and hero wavelength, and its outcome must be
+	/// exactly what Scatter() would give it. Implementations may interleave
+	/// the rays in any way to trace them more efficiently. The default traces
+	/// the rays one at a time.
+	/// @param x The Intersection shared by the rays.
+	/// @param ss The wavelengths to scatter through the medium.
+	/// @param ambient The medium surrounding the sample.
+	/// @param records The scatter record of each ray.
+	/// @param[out] results What happened to each ray.
+	/// @param count The number of rays.
+	virtual void ScatterBatch(const Intersection & x, const SpectralSample & ss,
+							  const IMedium & ambient,
+							  RandomScatterRecord * records,
+							  Interaction * results, int count) const
+	{
+		for (int i=0; i<count; ++i) {
+			results[i] = Scatter(x, ss, ambient, records[i]).interaction();
+		}
+	}
+
+	/// Prepare to scatter rays at a set of wavelengths, e.g. by tabulating
+	/// whatever depends on the wavelength alone. This is called before any
+	/// ray of a job is cast, and never while rays are being scattered. Rays
+	/// may still be scattered at other wavelengths afterwards. The default
+	/// does nothing.
+	/// @param lambdas Every wavelength of the job, in nanometres.
+	virtual void prepare(const std::vector<Scalar> & /*lambdas*/) {}
+
+	/// Add everything that the scattering depends on to a hash, e.g. to key
+	/// cached results by it. Specimens with equal hashes must scatter every
+	/// ray identically, so names and settings that don't change the results
+	/// are left out.
+	/// @param hash The hash to add to.
+	virtual void fingerprint(ContentHash & hash) const = 0;
+
 	/// Provide a name for parameter name output.
 	/// @return Returns a reference to a sting name.
 	virtual std::string & name() const = 0;
@@ -0,0 +1,29 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include "Point3.h"
+#include "Ray3.h"
+#include "Scalar.h"
+
+namespace nix {
+
+/// The result of a ray striking a specimen. It contains the Ray3, the distance
+/// along the ray and the intersection Point3 on the sample.
+class Intersection
+{
+  public:
+	/// Construct an intersection along a ray.
+	/// \param ray The ray that struck the specimen.
+	/// \param t The distance along the ray to the struck point.
+	Intersection(const Ray3 & ray, Scalar t)
+	  : ray(ray), t(t), p(ray.at(t)) {}
+
+	Ray3	ray;	///< The incoming ray.
+	Scalar	t;		///< Distance along the ray.
+	Point3	p;		///< The struck point on the surface of the specimen.
+};
+
+} // namespace nix
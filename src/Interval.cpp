@@ -19,26 +19,46 @@ Interval::Interval()
 	SetEmpty();
 }
 
-Interval::Interval(const Interval& /*I*/)
+Interval::Interval(const Interval& I)
+ : _min(I._min), _max(I._max)
 {
 }
 
 void Interval::SetEmpty()
 {
+	_min = 1;
+	_max = 0;
 }
 
-Interval & Interval::operator=(const Interval& /*rhs*/)
+Interval & Interval::operator=(const Interval& rhs)
 {
+	if (rhs.IsEmpty()) {
+		SetEmpty();
+	} else {
+		Set(rhs._min, rhs._max);
+	}
 	return * this;
 }
 
-void Interval::Set(Scalar /*sMin*/, Scalar /*sMax*/)
+void Interval::Set(Scalar sMin, Scalar sMax)
 {
+	if (isnan(sMin) or isnan(sMax)) {
+		SetEmpty();
+	} else if (sMin > sMax) {
+		_min = sMax;
+		_max = sMin;
+	} else {
+		_min = sMin;
+		_max = sMax;
+	}
 }
 
-std::ostream & operator<<(std::ostream & os, const Interval & /*i*/)
+std::ostream & operator<<(std::ostream & os, const Interval & i)
 {
-	return os;
+	if (i.IsEmpty()) {
+		return os << "[]";
+	}
+	return os << "[" << i.Min() << ", " << i.Max() << "]";
 }
 
 }
@@ -37,6 +37,23 @@ public:
 	void Set(Scalar sMin, Scalar sMax);
 	void SetEmpty();
 
+	/// Test if the interval contains no values.
+	/// \return Returns true if the interval is empty.
+	bool IsEmpty() const noexcept { return !(_min <= _max); }
+
+	/// Test if a value is in the interval.
+	/// \param s The value to test.
+	/// \return Returns true if \f$a \le s \le b\f$.
+	bool Contains(Scalar s) const noexcept { return _min <= s and s <= _max; }
+
+	/// Get the lower bound. It is meaningless if the interval is empty.
+	/// \return Returns \f$a\f$.
+	Scalar Min() const noexcept { return _min; }
+
+	/// Get the upper bound. It is meaningless if the interval is empty.
+	/// \return Returns \f$b\f$.
+	Scalar Max() const noexcept { return _max; }
+
 	/**
 	 * Assignment operator for the Interval class.
 	 * Makes use of the Set(Scalar, Scalar) method to initialize the left-hand
@@ -49,6 +66,10 @@ public:
 	Interval & operator=(const Interval& rhs);
 
 	static const Interval Empty;	///< The empty interval.
+
+private:
+	Scalar _min;	///< The lower bound, \f$a\f$.
+	Scalar _max;	///< The upper bound, \f$b\f$.
 };
 
 /// Prints an Interval in readable form.
@@ -0,0 +1,77 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "JobStatistics.h"
+
+namespace nix {
+
+JobStatistics::JobStatistics()
+  : _numSlots(0), _timing(true), _start(Clock::now())
+{
+}
+
+void JobStatistics::reset(unsigned numSlots)
+{
+	_slots.reset(new Slot[numSlots]);
+	_numSlots = numSlots;
+	for (unsigned s=0; s<_numSlots; ++s) {
+		for (auto & count : _slots[s].counts) {
+			count = 0;
+		}
+		for (auto & time : _slots[s].times) {
+			time = 0;
+		}
+	}
+	_start = Clock::now();
+}
+
+long long JobStatistics::total(Counter counter) const noexcept
+{
+	long long sum = 0;
+	for (unsigned s=0; s<_numSlots; ++s) {
+		sum += _slots[s].counts[static_cast<unsigned>(counter)].load(
+			std::memory_order_relaxed);
+	}
+	return sum;
+}
+
+Scalar JobStatistics::seconds(Stage stage) const noexcept
+{
+	Clock::rep sum = 0;
+	for (unsigned s=0; s<_numSlots; ++s) {
+		sum += _slots[s].times[static_cast<unsigned>(stage)].load(
+			std::memory_order_relaxed);
+	}
+	return std::chrono::duration<Scalar>(Clock::duration(sum)).count();
+}
+
+Scalar JobStatistics::elapsed() const noexcept
+{
+	return std::chrono::duration<Scalar>(Clock::now() - _start).count();
+}
+
+const char * JobStatistics::name(Counter counter) noexcept
+{
+	switch (counter) {
+	case Counter::raysCast:				return "rays_cast";
+	case Counter::scatteringEvents:		return "scattering_events";
+	case Counter::particlesGenerated:	return "particles_generated";
+	case Counter::collectorHits:		return "collector_hits";
+	default:							return "";
+	}
+}
+
+const char * JobStatistics::name(Stage stage) noexcept
+{
+	switch (stage) {
+	case Stage::trace:		return "trace";
+	case Stage::bin:		return "bin";
+	case Stage::merge:		return "merge";
+	case Stage::write:		return "write";
+	case Stage::checkpoint:	return "checkpoint";
+	default:				return "";
+	}
+}
+
+} // namespace nix
@@ -0,0 +1,175 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include "Scalar.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace nix {
+
+/// Throughput counters of a PhotometerJob, kept per worker thread.
+///
+/// Each thread adds to its own slot, which is padded so that no two slots
+/// share a cache line. The slots are only summed when the totals are asked
+/// for, so counting costs an uncontended atomic add. Hot loops should count
+/// locally and add once per batch of rays.
+///
+/// The counters may be read while the job is running, e.g. to report its
+/// progress, in which case the totals are a recent snapshot.
+class JobStatistics
+{
+  public:
+	/// The things that are counted.
+	enum class Counter : unsigned {
+		raysCast,			///< Rays cast at the specimen.
+		scatteringEvents,	///< Events along the paths of the rays.
+		particlesGenerated,	///< Particles generated by the specimen.
+		collectorHits,		///< Hits recorded by the collector sphere.
+		count				///< The number of counters.
+	};
+
+	/// The stages of the pipeline that are timed.
+	enum class Stage : unsigned {
+		trace,				///< Scattering rays through the specimen.
+		bin,				///< Binning exit directions into sensors.
+		merge,				///< Merging collector shards after a round.
+		write,				///< Writing results to the output.
+		checkpoint,			///< Saving checkpoints.
+		count				///< The number of stages.
+	};
+
+	/// Clock used to time the stages.
+	using Clock = std::chrono::steady_clock;
+
+	/// Construct without any slots.
+	JobStatistics();
+
+	/// Zero every counter and restart the elapsed time. This must not be
+	/// called while another thread is counting.
+	/// \param numSlots The number of threads that count, each of which
+	///        passes its own index in [0, numSlots).
+	void reset(unsigned numSlots);
+
+	/// Get the number of slots.
+	/// \return Returns the value passed to reset().
+	unsigned size() const noexcept { return _numSlots; }
+
+	/// Are the stages being timed?
+	/// \return Returns true if the stages are timed.
+	bool timing() const noexcept { return _timing; }
+
+	/// Time the stages of the pipeline. Timing reads the clock a few times
+	/// per batch of rays.
+	/// \param timing Set to false to skip timing.
+	void setTiming(bool timing) noexcept { _timing = timing; }
+
+	/// Add to a counter.
+	/// \param slot The index of the calling thread.
+	/// \param counter The counter to add to.
+	/// \param n The amount to add.
+	void add(unsigned slot, Counter counter, long long n) noexcept
+	{
+		if (slot < _numSlots) {
+			_slots[slot].counts[static_cast<unsigned>(counter)].fetch_add(n,
+				std::memory_order_relaxed);
+		}
+	}
+
+	/// Add time spent in a stage.
+	/// \param slot The index of the calling thread.
+	/// \param stage The stage that the time was spent in.
+	/// \param time The time spent.
+	void add(unsigned slot, Stage stage, Clock::duration time) noexcept
+	{
+		if (slot < _numSlots) {
+			_slots[slot].times[static_cast<unsigned>(stage)].fetch_add(
+				time.count(), std::memory_order_relaxed);
+		}
+	}
+
+	/// Sum a counter over the threads.
+	/// \param counter The counter to sum.
+	/// \return Returns a non-negative value.
+	long long total(Counter counter) const noexcept;
+
+	/// Sum the time spent in a stage over the threads. This is thread time,
+	/// so it can exceed the elapsed time.
+	/// \param stage The stage to sum.
+	/// \return Returns the time in seconds.
+	Scalar seconds(Stage stage) const noexcept;
+
+	/// Get the wall time since reset().
+	/// \return Returns the time in seconds.
+	Scalar elapsed() const noexcept;
+
+	/// Get the name of a counter, as used in Lua.
+	/// \param counter A counter other than Counter::count.
+	/// \return Returns a lower case name, e.g. "rays_cast".
+	static const char * name(Counter counter) noexcept;
+
+	/// Get the name of a stage, as used in Lua.
+	/// \param stage A stage other than Stage::count.
+	/// \return Returns a lower case name, e.g. "trace".
+	static const char * name(Stage stage) noexcept;
+
+  private:
+	/// The counters of one thread. The padding keeps the counters of
+	/// neighbouring slots on different cache lines.
+	struct Slot {
+		std::atomic<long long> counts[unsigned(Counter::count)];
+		std::atomic<Clock::rep> times[unsigned(Stage::count)];
+		char padding[64];
+	};
+
+	std::unique_ptr<Slot[]> _slots;	///< One slot per counting thread
+	unsigned _numSlots;				///< Number of entries in _slots
+	bool _timing;					///< Time the stages
+	Clock::time_point _start;		///< Time of the last reset()
+};
+
+/// Adds the time from its construction to its destruction to a stage.
+class StageTimer
+{
+  public:
+	/// Start timing, if the statistics are timing stages.
+	/// \param stats The statistics to add the time to.
+	/// \param slot The index of the calling thread.
+	/// \param stage The stage being timed.
+	StageTimer(JobStatistics & stats, unsigned slot,
+			   JobStatistics::Stage stage) noexcept
+	  : _stats(stats), _slot(slot), _stage(stage), _timing(stats.timing())
+	{
+		if (_timing) {
+			_start = JobStatistics::Clock::now();
+		}
+	}
+
+	/// Add the elapsed time to the stage.
+	~StageTimer()
+	{
+		if (_timing) {
+			_stats.add(_slot, _stage, JobStatistics::Clock::now() - _start);
+		}
+	}
+
+	/// The timer is not copyable.
+	StageTimer(const StageTimer &) = delete;
+
+	/// The timer is not assignable.
+	/// \return Never returns.
+	StageTimer & operator=(const StageTimer &) = delete;
+
+  private:
+	JobStatistics & _stats;				///< Statistics to add to
+	unsigned _slot;						///< Index of the timing thread
+	JobStatistics::Stage _stage;		///< Stage being timed
+	bool _timing;						///< Timing is enabled
+	JobStatistics::Clock::time_point _start;	///< Start of the stage
+};
+
+} // namespace nix
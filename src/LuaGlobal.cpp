@@ -24,6 +24,9 @@ namespace nix {
 namespace lua {
 
 unsigned int LuaGlobal::cores = std::thread::hardware_concurrency();
+int LuaGlobal::shardIndex = 0;
+int LuaGlobal::shardCount = 1;
+std::string LuaGlobal::shardFile;
 
 const luaL_Reg LuaGlobal::methods[] = {
 	{ "spectrophotometer_collector_sphere",
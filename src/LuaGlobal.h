@@ -7,6 +7,8 @@
 
 #include "lua_includes.h"
 
+#include <string>
+
 namespace nix {
 namespace lua {
 
@@ -23,6 +25,17 @@ struct LuaGlobal {
 	/// Specify the number of cores that exist, which may be used to instantiate
 	/// a number of thread.
 	static unsigned int cores;
+
+	/// The index of the shard that new photometer jobs run, as set by the
+	/// \c --shard command line option.
+	static int shardIndex;
+
+	/// The number of shards that new photometer jobs are split into. One
+	/// runs the whole job.
+	static int shardCount;
+
+	/// The results file that new photometer jobs save their shard to.
+	static std::string shardFile;
 };
 
 namespace global {
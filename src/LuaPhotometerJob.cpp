@@ -7,11 +7,14 @@
 #include "LuaPhotometerJob.h"
 
 #include <CollimatedBeamPhotometer.h>
+#include <JobStatistics.h>
 #include <LuaCollimatedBeamPhotometer.h>
 #include <LuaDiffuseReflector.h>
 #include <LuaTest1Material.h>
 #include <SphericalCoordinates.h>
 
+#include <limits>
+#include <stdexcept>
 #include <vector>
 #include <typeinfo>
 
@@ -25,6 +28,19 @@ const luaL_Reg LuaPhotometerJob::methods[] = {
 	{ "dump", job::nix_photometer_job_dump },
 	{ "set_verbose", job::nix_photometer_job_set_verbose_cmd },
 	{ "set_n", job::nix_photometer_job_set_n_cmd },
+	{ "set_adaptive", job::nix_photometer_job_set_adaptive_cmd },
+	{ "num_photons_cast", job::nix_photometer_job_num_photons_cast_cmd },
+	{ "stats", job::nix_photometer_job_stats_cmd },
+	{ "set_progress", job::nix_photometer_job_set_progress_cmd },
+	{ "set_seed", job::nix_photometer_job_set_seed_cmd },
+	{ "set_cell", job::nix_photometer_job_set_cell_cmd },
+	{ "set_hero_wavelengths", job::nix_photometer_job_set_hero_wavelengths_cmd },
+	{ "set_checkpoint", job::nix_photometer_job_set_checkpoint_cmd },
+	{ "set_resume", job::nix_photometer_job_set_resume_cmd },
+	{ "set_shard", job::nix_photometer_job_set_shard_cmd },
+	{ "set_bsdf_table", job::nix_photometer_job_set_bsdf_table_cmd },
+	{ "set_cache", job::nix_photometer_job_set_cache_cmd },
+	{ "set_trace", job::nix_photometer_job_set_trace_cmd },
 	{ "set_output", job::nix_photometer_job_set_output_cmd },
 	{ "set_incident_angles", job::nix_photometer_job_set_incident_angles_cmd },
 	{ "set_wavelengths", job::nix_photometer_job_set_wavelengths_cmd },
@@ -89,6 +105,19 @@ int nix_photometer_job_dump(lua_State * L)
 		 << "    Running:    " << self.running() << endl
 		 << "    Verbose:    " << self.verbose() << endl
 		 << "    N:          " << self.n() << endl
+		 << "    Adaptive:   " << self.adaptive() << endl
+		 << "    Target:     " << self.targetError() << endl
+		 << "    Min Rays:   " << self.minRays() << endl
+		 << "    Max Rays:   " << self.maxRays() << endl
+		 << "    Seed:       " << self.seed() << endl
+		 << "    Hero:       " << self.heroWavelengths() << endl
+		 << "    Checkpoint: " << self.checkpoint() << endl
+		 << "    Interval:   " << self.checkpointInterval() << endl
+		 << "    Resume:     " << self.resume() << endl
+		 << "    Progress:   " << self.progressInterval() << endl
+		 << "    Shard:      " << self.shardIndex() + 1 << "/"
+		 << self.shardCount() << " " << self.shardFile() << endl
+		 << "    Cache:      " << self.cacheDirectory() << endl
 		 << "    File:       " << self.fileName() << endl
 		 << "    # Incident: " << self.incidentAngles().size() << endl
 		 << "    # Lambda:   " << self.wavelengths().size() << endl
@@ -154,7 +183,322 @@ int nix_photometer_job_set_n_cmd(lua_State * L)
 	return 0;
 }
 
-// set the output file name
+// set the seed of the random streams
+int nix_photometer_job_set_seed_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 2) {
+		return luaL_argerror(L, numArgs, "Only one argument should be passed"
+			" to set_seed.");
+	}
+
+	// Get the argument
+	if (!lua_isinteger(L, 2) or lua_tointeger(L, 2) < 0) {
+		return luaL_argerror(L, 2, "Expected non-negative integer.");
+	}
+	self.setSeed(lua_tointeger(L, 2));
+
+	return 0;
+}
+
+// cast rays until the estimates converge
+int nix_photometer_job_set_adaptive_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 4) {
+		return luaL_argerror(L, numArgs, "Three arguments should be passed"
+			" to set_adaptive.");
+	}
+
+	// Get the arguments
+	if (!lua_isnumber(L, 2) or lua_tonumber(L, 2) < 0) {
+		return luaL_argerror(L, 2, "Expected non-negative number.");
+	}
+	if (!lua_isinteger(L, 3) or lua_tointeger(L, 3) < 1) {
+		return luaL_argerror(L, 3, "Expected positive integer.");
+	}
+	if (!lua_isinteger(L, 4) or lua_tointeger(L, 4) < lua_tointeger(L, 3) or
+		lua_tointeger(L, 4) > std::numeric_limits<int>::max()) {
+		return luaL_argerror(L, 4, "Expected integer no less than the"
+			" minimum.");
+	}
+	self.setAdaptive(lua_tonumber(L, 2), lua_tointeger(L, 3),
+					 lua_tointeger(L, 4));
+
+	return 0;
+}
+
+// get the number of rays cast by the last run
+int nix_photometer_job_num_photons_cast_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 1) {
+		return luaL_argerror(L, numArgs, "No arguments should be passed"
+			" to num_photons_cast.");
+	}
+	lua_pushinteger(L, self.numPhotonsCast());
+
+	return 1;
+}
+
+// get the throughput counters
+int nix_photometer_job_stats_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 1) {
+		return luaL_argerror(L, numArgs, "No arguments should be passed"
+			" to stats.");
+	}
+
+	const JobStatistics * stats = nullptr;
+	try {
+		stats = &self.statistics();
+	} catch (std::exception & e) {
+		return luaL_error(L, "Error getting stats: %s", e.what());
+	}
+
+	using Counter = JobStatistics::Counter;
+	using Stage = JobStatistics::Stage;
+	lua_newtable(L);
+	for (unsigned c=0; c<unsigned(Counter::count); ++c) {
+		lua_pushinteger(L, stats->total(Counter(c)));
+		lua_setfield(L, -2, JobStatistics::name(Counter(c)));
+	}
+	lua_pushinteger(L, self.cellsTotal());
+	lua_setfield(L, -2, "cells");
+	lua_pushinteger(L, self.cellsDone());
+	lua_setfield(L, -2, "cells_complete");
+	const Scalar elapsed = stats->elapsed();
+	lua_pushnumber(L, elapsed);
+	lua_setfield(L, -2, "elapsed");
+	lua_pushnumber(L, elapsed > 0 ?
+		stats->total(Counter::raysCast) / elapsed : 0);
+	lua_setfield(L, -2, "rays_per_second");
+	lua_newtable(L);
+	for (unsigned s=0; s<unsigned(Stage::count); ++s) {
+		lua_pushnumber(L, stats->seconds(Stage(s)));
+		lua_setfield(L, -2, JobStatistics::name(Stage(s)));
+	}
+	lua_setfield(L, -2, "stage_seconds");
+
+	return 1;
+}
+
+// print progress while the job runs
+int nix_photometer_job_set_progress_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 2) {
+		return luaL_argerror(L, numArgs, "Only one argument should be passed"
+			" to set_progress.");
+	}
+
+	// Get the argument
+	if (!lua_isnumber(L, 2) or lua_tonumber(L, 2) < 0) {
+		return luaL_argerror(L, 2, "Expected non-negative number.");
+	}
+	self.setProgress(lua_tonumber(L, 2));
+
+	return 0;
+}
+
+// trace packets of wavelengths along each path
+int nix_photometer_job_set_hero_wavelengths_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 2) {
+		return luaL_argerror(L, numArgs, "Only one argument should be passed"
+			" to set_hero_wavelengths.");
+	}
+
+	// Get the argument
+	if (!lua_isinteger(L, 2) or lua_tointeger(L, 2) < 1) {
+		return luaL_argerror(L, 2, "Expected positive integer.");
+	}
+	self.setHeroWavelengths(lua_tointeger(L, 2));
+
+	return 0;
+}
+
+// restrict the job to a single cell
+int nix_photometer_job_set_cell_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 3) {
+		return luaL_argerror(L, numArgs, "Two arguments should be passed"
+			" to set_cell.");
+	}
+
+	// Get the arguments, converting from Lua's 1-based indices
+	for (int arg=2; arg<=3; ++arg) {
+		if (!lua_isinteger(L, arg) or lua_tointeger(L, arg) < 1) {
+			return luaL_argerror(L, arg, "Expected positive integer.");
+		}
+	}
+	self.setCell(lua_tointeger(L, 2) - 1, lua_tointeger(L, 3) - 1);
+
+	return 0;
+}
+
+// save the progress of the job
+int nix_photometer_job_set_checkpoint_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 2 and numArgs != 3) {
+		return luaL_argerror(L, numArgs, "One or two arguments should be"
+			" passed to set_checkpoint.");
+	}
+
+	// Get the arguments
+	if (!lua_isstring(L, 2)) {
+		return luaL_argerror(L, 2, "Expected string.");
+	}
+	Scalar interval = 600;
+	if (numArgs == 3) {
+		if (!lua_isnumber(L, 3) or lua_tonumber(L, 3) < 0) {
+			return luaL_argerror(L, 3, "Expected non-negative number.");
+		}
+		interval = lua_tonumber(L, 3);
+	}
+	self.setCheckpoint(lua_tostring(L, 2), interval);
+
+	return 0;
+}
+
+// resume the job from its checkpoint
+int nix_photometer_job_set_resume_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 2) {
+		return luaL_argerror(L, numArgs, "Only one argument should be passed"
+			" to set_resume.");
+	}
+
+	// Get the argument
+	if (!lua_isboolean(L, 2)) {
+		return luaL_argerror(L, 2, "Expected boolean.");
+	}
+	self.setResume(lua_toboolean(L, 2));
+
+	return 0;
+}
+
+// run one shard of the job
+int nix_photometer_job_set_shard_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 4) {
+		return luaL_argerror(L, numArgs, "Three arguments should be passed"
+			" to set_shard.");
+	}
+
+	// Get the arguments, converting from Lua's 1-based index
+	if (!lua_isinteger(L, 3) or lua_tointeger(L, 3) < 1) {
+		return luaL_argerror(L, 3, "Expected positive integer.");
+	}
+	if (!lua_isinteger(L, 2) or lua_tointeger(L, 2) < 1 or
+		lua_tointeger(L, 2) > lua_tointeger(L, 3)) {
+		return luaL_argerror(L, 2, "Expected integer from 1 to the number of"
+			" shards.");
+	}
+	if (!lua_isstring(L, 4)) {
+		return luaL_argerror(L, 4, "Expected string.");
+	}
+	self.setShard(lua_tointeger(L, 2) - 1, lua_tointeger(L, 3),
+				  lua_tostring(L, 4));
+
+	return 0;
+}
+
+// write a BSDF table when the job completes
+int nix_photometer_job_set_bsdf_table_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 2) {
+		return luaL_argerror(L, numArgs, "Only one argument should be passed"
+			" to set_bsdf_table.");
+	}
+
+	if (!lua_isstring(L, 2)) {
+		return luaL_argerror(L, 2, "Expected string.");
+	}
+	self.setBsdfTable(lua_tostring(L, 2));
+
+	return 0;
+}
+
+// serve cells from a result cache
+int nix_photometer_job_set_cache_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 2) {
+		return luaL_argerror(L, numArgs, "Only one argument should be passed"
+			" to set_cache.");
+	}
+
+	if (!lua_isstring(L, 2)) {
+		return luaL_argerror(L, 2, "Expected string.");
+	}
+	self.setCache(lua_tostring(L, 2));
+
+	return 0;
+}
+
+int nix_photometer_job_set_trace_cmd(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	PhotometerJob & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 2) {
+		return luaL_argerror(L, numArgs, "Only one argument should be passed"
+			" to set_trace.");
+	}
+
+	if (!lua_isstring(L, 2)) {
+		return luaL_argerror(L, 2, "Expected string.");
+	}
+	self.setTrace(lua_tostring(L, 2));
+
+	return 0;
+}
+
 int nix_photometer_job_set_output_cmd(lua_State * L)
 {
 	NIX_LUA_DEBUG_CALL;
@@ -170,7 +514,11 @@ int nix_photometer_job_set_output_cmd(lua_State * L)
 		return luaL_argerror(L, 2, "Expected string.");
 	}
 	auto fname = lua_tostring(L, 2);
-	self.setOutput(fname);
+	try {
+		self.setOutput(fname);
+	} catch (std::exception & e) {
+		return luaL_error(L, "Error setting the output: %s", e.what());
+	}
 
 	return 0;
 }
@@ -339,7 +687,12 @@ int nix_photometer_job_run_cmd(lua_State * L)
 		return luaL_argerror(L, 1, "No arguements should be passed to run().");
 	}
 
-	self.Run();
+	// Exceptions must not propagate through the Lua C API
+	try {
+		self.Run();
+	} catch(std::exception & e) {
+		return luaL_error(L, "Error running photometer_job: %s", e.what());
+	}
 
 	return 0;
 }
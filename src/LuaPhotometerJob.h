@@ -73,6 +73,152 @@ int nix_photometer_job_set_verbose_cmd(lua_State * L);
 /// \return Returns 0, since there are no objects returned to the Lua caller.
 int nix_photometer_job_set_n_cmd(lua_State * L);
 
+/// Cast rays in rounds until every sensor's reflectance meets a target
+/// relative standard error, instead of a fixed number of rays. The Lua method
+/// expects three parameters: the target error, and the minimum and maximum
+/// number of rays per measurement. A target of zero restores the fixed
+/// budget set by set_n. E.g.
+/// \code{.lua}
+/// my_photometer_job:set_adaptive(0.01, 10000, 1000000)
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_photometer_job_set_adaptive_cmd(lua_State * L);
+
+/// Get the number of rays cast by the last run of the job. The Lua method
+/// expects no parameters. E.g.
+/// \code{.lua}
+/// print(my_photometer_job:num_photons_cast())
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 1, the integer count.
+int nix_photometer_job_num_photons_cast_cmd(lua_State * L);
+
+/// Get the throughput counters of the last run of the job, which may be
+/// called while it runs. The Lua method expects no parameters, and returns a
+/// table with the counts rays_cast, scattering_events, particles_generated
+/// and collector_hits, the cells and cells_complete, the elapsed seconds,
+/// rays_per_second, and a table stage_seconds of the thread time spent in
+/// each stage: trace, bin, merge, write and checkpoint. E.g.
+/// \code{.lua}
+/// my_photometer_job:run()
+/// local stats = my_photometer_job:stats()
+/// print(stats.rays_per_second, stats.stage_seconds.trace)
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 1, the table.
+int nix_photometer_job_stats_cmd(lua_State * L);
+
+/// Print a line of progress to stderr at a fixed interval while the job
+/// runs. The Lua method expects exactly one number, the seconds between
+/// lines. Zero disables them. E.g.
+/// \code{.lua}
+/// my_photometer_job:set_progress(10)
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_photometer_job_set_progress_cmd(lua_State * L);
+
+/// Set the seed of the random streams of the job. The Lua method expects
+/// exactly one non-negative integer parameter. E.g.
+/// \code{.lua}
+/// my_photometer_job:set_seed(42)
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_photometer_job_set_seed_cmd(lua_State * L);
+
+/// Trace each path for a packet of wavelengths at once. The Lua method expects
+/// exactly one integer parameter, the number of wavelengths per packet. A
+/// value of one traces each wavelength on its own. E.g.
+/// \code{.lua}
+/// my_photometer_job:set_hero_wavelengths(8)
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_photometer_job_set_hero_wavelengths_cmd(lua_State * L);
+
+/// Restrict the job to a single (incident angle, wavelength) cell. The cell is
+/// given by its 1-based indices into the incident angle and wavelength arrays.
+/// Its output is identical to that of the same cell in a full run. E.g.
+/// \code{.lua}
+/// -- Re-run the second wavelength of the first incident angle
+/// my_photometer_job:set_cell(1, 2)
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_photometer_job_set_cell_cmd(lua_State * L);
+
+/// Save the progress of the job to a binary checkpoint file while it runs.
+/// The Lua method expects a file name, and optionally the least number of
+/// seconds between checkpoints, which defaults to 600. An empty file name
+/// disables checkpoints. E.g.
+/// \code{.lua}
+/// my_photometer_job:set_checkpoint("snow.ckpt", 300)
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_photometer_job_set_checkpoint_cmd(lua_State * L);
+
+/// Resume the job from its checkpoint file, if the file exists. Cells that
+/// were complete are written again, and the others continue where they left
+/// off. The Lua method expects exactly one boolean parameter. E.g.
+/// \code{.lua}
+/// my_photometer_job:set_checkpoint("snow.ckpt", 300)
+/// my_photometer_job:set_resume(true)
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_photometer_job_set_resume_cmd(lua_State * L);
+
+/// Run only one of several shards of the job, and save its results to a file.
+/// The Lua method expects the 1-based index of the shard, the number of
+/// shards and the name of the results file. Running every shard and merging
+/// their files with \c "nix_demo --merge" gives the output of the whole job.
+/// The \c --shard command line option sets this for every job. E.g.
+/// \code{.lua}
+/// my_photometer_job:set_shard(3, 16, "snow-3.shard")
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_photometer_job_set_shard_cmd(lua_State * L);
+
+/// Write the results of the job to a binary BSDF table when it completes,
+/// which analysis tools can memory map and slice without parsing. The text
+/// output is written as well, and \c "nix_demo --bsdf-text" turns the table
+/// back into text. The Lua method expects exactly one string parameter. An
+/// empty file name disables the table. E.g.
+/// \code{.lua}
+/// my_photometer_job:set_bsdf_table("snow.bsdf")
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_photometer_job_set_bsdf_table_cmd(lua_State * L);
+
+/// Serve the cells of the job from a cache directory of results, and store
+/// the cells that are traced in it. Cells are keyed by a hash of everything
+/// their rays depend on, so a rerun only traces the cells whose material,
+/// collector sphere, rays, seed, incident angle or wavelength changed. The
+/// Lua method expects exactly one string parameter. An empty directory name
+/// disables the cache. E.g.
+/// \code{.lua}
+/// my_photometer_job:set_cache("snow.cache")
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_photometer_job_set_cache_cmd(lua_State * L);
+
+/// Record a timeline of the job while it runs, and write it to a file as a
+/// Chrome trace, which chrome://tracing and Perfetto can open. The Lua method
+/// expects exactly one string parameter. An empty file name disables tracing.
+/// E.g.
+/// \code{.lua}
+/// my_photometer_job:set_trace("snow.trace.json")
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_photometer_job_set_trace_cmd(lua_State * L);
+
 /// Set the output file name for the data.
 /// The Lua method expects exactly one string parameter. E.g.
 /// \code{.lua}
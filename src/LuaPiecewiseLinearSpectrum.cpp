@@ -16,6 +16,7 @@ namespace lua {
 // implementation It must be null-terminated.
 const luaL_Reg LuaPiecewiseLinearSpectrum::methods[] = {
 	{ "dump", spectrum::nix_piecewise_linear_spectrum_dump },
+	{ "resample", spectrum::nix_piecewise_linear_spectrum_resample },
 	{ "__gc", spectrum::nix_piecewise_linear_spectrum_gc },
 	{ 0, 0 }
 };
@@ -61,10 +62,34 @@ int nix_piecewise_linear_spectrum_dump(lua_State * L)
 	if (self->values().size() > 0) {
 		cout << "    Range: (" << self->low() << ", " << self->high() << ")" << endl;
 	}
+	if (self->resampled()) {
+		cout << "    Error: " << self->resamplingError() << endl;
+	}
 
 	return 0;
 }
 
+int nix_piecewise_linear_spectrum_resample(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	auto self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 2) {
+		return luaL_argerror(L, numArgs,
+			"Only one argument should be passed to resample.");
+	}
+
+	const Scalar step = luaL_checknumber(L, 2);
+	try {
+		lua_pushnumber(L, self->resample(step));
+	} catch (std::exception & e) {
+		return luaL_error(L, "Error resampling spectrum: %s", e.what());
+	}
+
+	return 1;
+}
+
 int nix_piecewise_linear_spectrum_gc(lua_State * L)
 {
 	NIX_LUA_DEBUG_CALL;
@@ -46,6 +46,18 @@ extern "C" {
 /// \return Returns 0, since there are no objects returned to the Lua caller.
 int nix_piecewise_linear_spectrum_dump(lua_State * L);
 
+/// Resample the spectrum onto a uniform grid, which is faster to evaluate
+/// than the breakpoints it was defined with. The step is the largest spacing
+/// of the grid, in nanometres, and the largest error of the resampled
+/// spectrum is returned, e.g.
+/// \code{.lua}
+/// ice_n = nix.piecewise_linear_spectrum("ice_n", {{350, 1.32}, {2500, 1.25}})
+/// err = ice_n:resample(1.0)
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 1, the error of the resampling.
+int nix_piecewise_linear_spectrum_resample(lua_State * L);
+
 /// Garbage collect the data that was created for Lua.
 /// \param L The current Lua State object.
 /// \return Returns 0, since there are no objects returned to the Lua caller.
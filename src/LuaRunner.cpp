@@ -143,6 +143,17 @@ void LuaRunner::setThreads(int numThreads)
 	}
 }
 
+void LuaRunner::setShard(int index, int count)
+{
+	if (count < 1 or index < 1 or index > count) {
+		throw std::invalid_argument("The shard must be k/S, with 1 <= k <= S.");
+	}
+	LuaGlobal::shardIndex = index - 1;
+	LuaGlobal::shardCount = count;
+	LuaGlobal::shardFile = fs::path(_fname).stem().string() + ".shard-" +
+		std::to_string(index) + "-of-" + std::to_string(count);
+}
+
 unsigned int LuaRunner::getThreads() const noexcept
 {
 	return LuaGlobal::cores;
@@ -45,6 +45,15 @@ class LuaRunner
 	///        number of available cores. Any error case are quietly discarded.
 	void setThreads(int numThreads);
 
+	/// Run only one shard of every photometer job of the script. The results
+	/// of each shard are saved next to the script, in a file named after it,
+	/// e.g. \c snow.shard-3-of-16 for the third of 16 shards of \c snow.lua.
+	/// \param index The 1-based index of the shard.
+	/// \param count The number of shards.
+	/// \throws Throws std::invalid_argument if the index is not in
+	///         [1, count].
+	void setShard(int index, int count);
+
 	/// Return the number of threads that are available for process execution.
 	/// Note that the return type of this is different than the parameter
 	/// argument for setThreads(int).
@@ -54,7 +54,7 @@ int nix_spectrophotometer_collector_sphere_dump(lua_State * L)
 	NIX_LUA_DEBUG_CALL;
 
 	// Get a pointer to self
-	auto self = getSelf(L);
+	SpectrophotometerCollectorSphere & self = getSelf(L);
 
 	using namespace std;
 
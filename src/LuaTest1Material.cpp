@@ -29,7 +29,9 @@ const luaL_Reg LuaTest1Material::methods[] = {
 	{ "set_depth", material::nix_test1material_set_depth },
 	{ "set_media", material::nix_test1material_set_media },
 	{ "set_mirror", material::nix_test1material_set_mirror },
+	{ "set_lower_reflector", material::nix_test1material_set_lower_reflector },
 	{ "set_particles", material::nix_test1material_set_particles },
+	{ "set_wavefront", material::nix_test1material_set_wavefront },
 	{ "__gc", material::nix_test1material_gc },
 	{ 0, 0 }
 };
@@ -239,7 +241,7 @@ std::map<std::string, bool> initializeMap()
 	m["roundness_stdev"] = false;
 	m["roundness_range"] = false;
 	m["generator"] = false;
-	m["cloudiness"] = false;
+	m["cloudiness"] = true;	// NB: Cloudiness is not modelled, so optional
 	m["coating"] = true;		// NB: Specifying a coating is optional
 	m["n"] = false;
 	m["k"] = false;
@@ -389,6 +391,23 @@ int nix_test1material_set_lower_reflector(lua_State * L)
 	return 0;
 }
 
+int nix_test1material_set_wavefront(lua_State * L)
+{
+	NIX_LUA_DEBUG_CALL;
+
+	Test1Material & self = getSelf(L);
+	auto numArgs = lua_gettop(L);
+	if (numArgs != 2) {
+		return luaL_argerror(L, numArgs,
+			"Only one argument should be passed to set_wavefront.");
+	}
+
+	luaL_checktype(L, 2, LUA_TBOOLEAN);
+	self.setWavefront(lua_toboolean(L, 2));
+
+	return 0;
+}
+
 int nix_test1material_gc(lua_State * L)
 {
 	NIX_LUA_DEBUG_CALL;
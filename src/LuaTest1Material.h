@@ -145,6 +145,18 @@ int nix_test1material_set_particles(lua_State * L);
 /// \return Returns 0, since there are no objects returned to the Lua caller.
 int nix_test1material_set_lower_reflector(lua_State * L);
 
+/// Choose how batches of rays are traced. By default, the rays of a batch are
+/// traced together as a wavefront, one event at a time. With `false`, each ray
+/// is traced from entry to exit before the next. The results are identical
+/// either way, so this is only useful to compare their speed. E.g.
+/// \code{.lua}
+/// material = nix.test1material()
+/// material:set_wavefront(false)
+/// \endcode
+/// \param L The current Lua State object.
+/// \return Returns 0, since there are no objects returned to the Lua caller.
+int nix_test1material_set_wavefront(lua_State * L);
+
 /// Garbage collect the struct that contains the Test1Material object reference.
 /// \param L The current Lua State object.
 /// \return Returns 0, since there are no objects returned to the Lua caller.
@@ -0,0 +1,47 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "ParticleArena.h"
+
+namespace nix {
+
+constexpr std::size_t ParticleArena::blockSize;
+
+void ParticleArena::reset() noexcept
+{
+	for (auto p = _particles.rbegin(); p != _particles.rend(); ++p) {
+		if (*p) {
+			(*p)->~IParticle();
+		}
+	}
+	_particles.clear();
+	_block = 0;
+	_used = 0;
+}
+
+std::size_t ParticleArena::size() const noexcept
+{
+	std::size_t count = 0;
+	for (const IParticle * p : _particles) {
+		count += p ? 1 : 0;
+	}
+	return count;
+}
+
+void * ParticleArena::allocate(std::size_t size, std::size_t alignment)
+{
+	std::size_t offset = (_used + alignment - 1) & ~(alignment - 1);
+	if (_block < _blocks.size() and offset + size > blockSize) {
+		++_block;
+		offset = 0;
+	}
+	if (_block == _blocks.size()) {
+		_blocks.emplace_back(new char[blockSize]);
+		offset = 0;
+	}
+	_used = offset + size;
+	return _blocks[_block].get() + offset;
+}
+
+} // namespace nix
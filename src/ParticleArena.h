@@ -0,0 +1,93 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include <IParticle.h>
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nix {
+
+/// A bump allocator for the particles generated along ray paths.
+///
+/// Particles live for a single scattering event, but used to be allocated on
+/// the heap one at a time, which made the allocator a point of contention
+/// between the worker threads. An arena hands out memory from large blocks
+/// instead, and frees every particle at once when it is reset. The blocks are
+/// kept for reuse, so once an arena has grown to the size its paths need it
+/// doesn't allocate at all.
+///
+/// An arena is not thread safe. Each thread should use its own.
+class ParticleArena
+{
+  public:
+	/// The size of the blocks of memory, in bytes.
+	static constexpr std::size_t blockSize = 16384;
+
+	/// Construct an empty arena. No memory is allocated until the first
+	/// particle is made.
+	ParticleArena() : _block(0), _used(0) {}
+
+	/// Destroy the particles, and free the memory.
+	~ParticleArena() { reset(); }
+
+	/// The arena is not copyable.
+	ParticleArena(const ParticleArena &) = delete;
+
+	/// The arena is not assignable.
+	/// \return Never returns.
+	ParticleArena & operator=(const ParticleArena &) = delete;
+
+	/// Construct a particle in the arena. The particle is owned by the arena,
+	/// and must not be deleted.
+	/// \param args The arguments of the constructor of \p P.
+	/// \return Returns the new particle, which is valid until reset().
+	template <typename P, typename... Args>
+	P * make(Args &&... args)
+	{
+		static_assert(std::is_base_of<IParticle, P>::value,
+					  "Only particles can be made in a ParticleArena.");
+		static_assert(sizeof(P) <= blockSize and
+					  alignof(P) <= alignof(std::max_align_t),
+					  "The particle doesn't fit in a block of the arena.");
+		void * memory = allocate(sizeof(P), alignof(P));
+		_particles.push_back(nullptr);
+		P * particle = new (memory) P(std::forward<Args>(args)...);
+		_particles.back() = particle;
+		return particle;
+	}
+
+	/// Destroy every particle made since the last reset, and reuse their
+	/// memory.
+	void reset() noexcept;
+
+	/// Get the number of particles in the arena.
+	/// \return Returns the number of particles made since the last reset.
+	std::size_t size() const noexcept;
+
+	/// Get the memory held by the arena.
+	/// \return Returns the size of the blocks, in bytes.
+	std::size_t capacity() const noexcept { return _blocks.size() * blockSize; }
+
+  private:
+	/// Allocate memory from the current block, moving to the next one if it
+	/// is full.
+	/// \param size The number of bytes.
+	/// \param alignment The alignment, which must be a power of two.
+	/// \return Returns uninitialized memory.
+	void * allocate(std::size_t size, std::size_t alignment);
+
+	std::vector<std::unique_ptr<char[]>> _blocks;	///< Memory to allocate from
+	std::size_t _block;						///< Index of the current block
+	std::size_t _used;						///< Bytes used in the current block
+	std::vector<IParticle *> _particles;	///< Particles to destroy
+};
+
+} // namespace nix
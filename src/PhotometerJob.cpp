@@ -4,38 +4,116 @@
  ***************************************************************************/
 
 #include "PhotometerJob.h"
+#include <BsdfTable.h>
+#include <ContentHash.h>
 #include <ICollectorSphere.h>
 #include <ISpecimen.h>
 #include <CollimatedBeamPhotometer.h>
 #include <ISpecimen.h>
+#include <LuaGlobal.h>
+#include <ResultCache.h>
+#include <ResultFile.h>
+#include <SpectralSample.h>
+#include <WorkStealingPool.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <exception>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <stdexcept>
 #include <functional>
 #include <unistd.h>
 #include <cassert>
+#include <condition_variable>
+#include <thread>
 
 namespace nix {
 
+namespace {
+
+/// The spans kept per thread when the job is traced. The oldest are dropped
+/// beyond this, which takes 1.5 MiB per thread.
+constexpr std::size_t traceCapacity = 1 << 16;
+
+/// Calls back at a fixed interval from its own thread, until destroyed.
+class ProgressReporter
+{
+  public:
+	/// Start calling back.
+	/// \param interval Seconds between calls. Zero or less disables them.
+	/// \param report The function to call.
+	ProgressReporter(Scalar interval, std::function<void()> report)
+	  : _done(false)
+	{
+		if (interval <= 0) {
+			return;
+		}
+		_thread = std::thread([this, interval, report]() {
+			const std::chrono::duration<Scalar> wait(interval);
+			std::unique_lock<std::mutex> lock(_lock);
+			while (!_stop.wait_for(lock, wait, [this]() { return _done; })) {
+				report();
+			}
+		});
+	}
+
+	/// Stop calling back and join the thread.
+	~ProgressReporter()
+	{
+		if (_thread.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				_done = true;
+			}
+			_stop.notify_one();
+			_thread.join();
+		}
+	}
+
+  private:
+	std::mutex _lock;					///< Guards _done
+	std::condition_variable _stop;		///< Signalled on destruction
+	bool _done;							///< Set on destruction
+	std::thread _thread;				///< Calls back
+};
+
+} // namespace
+
+constexpr int PhotometerJob::chunkSize;
+std::atomic<long long> PhotometerJob::_totalRaysCast(0);
+
 PhotometerJob::PhotometerJob()
- : _out(&std::cout)
+ : _n(0), _targetError(0), _minRays(0), _maxRays(0), _seed(0),
+   _onlyIncident(-1), _onlyLambda(-1), _packetSize(1), _interval(0),
+   _resume(false), _shardIndex(lua::LuaGlobal::shardIndex),
+   _shardCount(lua::LuaGlobal::shardCount),
+   _shardFile(lua::LuaGlobal::shardFile), _verbose(false),
+   _running(false), _writer(nullptr), _cache(nullptr), _numCells(0),
+   _nextToWrite(0), _endCell(0), _roundRays(0), _pool(nullptr), _cellsDone(0),
+   _cellsTotal(0), _cellsCached(0), _progress(0)
 {
 }
 
-PhotometerJob::~PhotometerJob()
+void PhotometerJob::setOutput(const std::string & fname)
 {
-	if (_out != &std::cout) {
-		delete _out;
+	if (not fname.empty() and !std::ofstream(fname, std::ios::app)) {
+		throw std::runtime_error("Unable to write the output file " + fname +
+			".");
 	}
+	_outputFile = fname;
 }
 
-void PhotometerJob::setOutput(const std::string & /*fname*/)
+void PhotometerJob::setCell(int incident, int lambda) noexcept
 {
+	_onlyIncident = incident;
+	_onlyLambda = lambda;
 }
 
 void PhotometerJob::setIncidentAngles(
@@ -69,6 +147,19 @@ const CollimatedBeamPhotometer & PhotometerJob::photometer() const noexcept
 	return *(_photometer.get());
 }
 
+long long PhotometerJob::numPhotonsCast() const noexcept
+{
+	return _photometer ? _photometer->numPhotonsCast() : 0;
+}
+
+const JobStatistics & PhotometerJob::statistics() const
+{
+	if (!_photometer) {
+		throw std::runtime_error("No photometer set on the job.");
+	}
+	return _photometer->statistics();
+}
+
 void PhotometerJob::setMaterial(std::unique_ptr<ISpecimen> material)
 {
 	_material = std::move(material);
@@ -79,16 +170,559 @@ const ISpecimen & PhotometerJob::material() const noexcept
 	return *(_material.get());
 }
 
-int PhotometerJob::numPhotonsCast() const
+void PhotometerJob::Run()
+{
+	if (!_photometer or !_material) {
+		std::cout << "Hello from C++." << std::endl;
+		return;
+	}
+
+	ICollectorSphere & cs = _photometer->collectorSphere();
+	const std::size_t numLambdas = _lambdas.size();
+	_numCells = _incident.size() * numLambdas;
+	_nextToWrite = 0;
+	_endCell = _numCells;
+	if (_onlyIncident >= 0 or _onlyLambda >= 0) {
+		if (_onlyIncident < 0 or _onlyIncident >= int(_incident.size()) or
+			_onlyLambda < 0 or _onlyLambda >= int(numLambdas)) {
+			throw std::out_of_range("The selected cell is not in the job.");
+		}
+		_nextToWrite = _onlyIncident * numLambdas + _onlyLambda;
+		_endCell = _nextToWrite + 1;
+	}
+	if (_shardCount < 1 or _shardIndex < 0 or _shardIndex >= _shardCount) {
+		throw std::out_of_range("The selected shard is not in the job.");
+	}
+	const int firstRound = adaptive() ? std::min(_minRays, _maxRays) : _n;
+	if (_numCells == 0 or firstRound <= 0) {
+		return;
+	}
+
+	// The writer and the cache outlive the pool, whose tasks use them.
+	std::unique_ptr<ResultCache> cache;
+	if (not _cacheDirectory.empty()) {
+		cache.reset(new ResultCache(_cacheDirectory));
+	}
+	_projectedSolidAngles.resize(cs.numSensors());
+	for (int id=0; id<cs.numSensors(); ++id) {
+		_projectedSolidAngles[id] = cs.getProjectedSolidAngle(id);
+	}
+	ResultWriter writer(_outputFile, _projectedSolidAngles);
+	_writer = &writer;
+	_cache = cache.get();
+
+	_running = true;
+	_cells.reset(new Cell[_numCells]);
+	for (int c=0; c<_numCells; ++c) {
+		_cells[c].incident = c / numLambdas;
+		_cells[c].lambda = c % numLambdas;
+		_cells[c].remaining = 0;
+		_cells[c].rays = 0;
+		_cells[c].round = 0;
+		_cells[c].complete = false;
+		_cells[c].foreign = false;
+		_cells[c].cached = false;
+	}
+
+	// Packets are dealt to the shards round-robin. The cells of other shards
+	// are complete from the start, but are neither written nor saved.
+	if (_shardCount > 1) {
+		int packet = 0;
+		for (std::size_t i=0; i<_incident.size(); ++i) {
+			for (std::size_t l=0; l<numLambdas; l+=_packetSize, ++packet) {
+				const int c = i * numLambdas + l;
+				const int len = std::min<int>(_packetSize, numLambdas - l);
+				const bool foreign = packet % _shardCount != _shardIndex;
+				for (int j=0; j<len; ++j) {
+					_cells[c + j].complete = foreign;
+					_cells[c + j].foreign = foreign;
+				}
+			}
+		}
+	}
+	_material->prepare(_lambdas);
+	_jobKey = jobHash().hex();
+	WorkStealingPool pool(lua::LuaGlobal::cores);
+	_pool = &pool;
+	cs.initCells(_numCells, pool.size());
+
+	// The workers count into their own slots, and this thread into the
+	// last one.
+	_photometer->statistics().reset(pool.size() + 1);
+	_tracer.reset(pool.size() + 1, _trace.empty() ? 0 : traceCapacity);
+	const unsigned self = pool.size();
+	_cellsDone = 0;
+	_cellsTotal = 0;
+	_cellsCached = 0;
+
+	// Rounds only matter to adaptive cells. Otherwise they are split up
+	// when checkpointing, so that the progress within long cells is saved.
+	// The hits of the rounds are summed exactly, so this doesn't change the
+	// results.
+	_roundRays = _n;
+	if (not _checkpoint.empty()) {
+		_roundRays = chunkSize * 8 * pool.size();
+	}
+	_lastCheckpoint = std::chrono::steady_clock::now();
+
+	try {
+		ProgressReporter progress(_progress, [this]() { printProgress(); });
+		if (_resume) {
+			readCheckpoint();
+		}
+		if (_cache) {
+			readCache();
+		}
+
+		// Tasks are queued in cell order, so that the cells complete roughly
+		// in the order that they are written and few of them are in flight
+		// at once. Each task covers a packet of consecutive wavelengths.
+		// Later rounds are queued by the worker that finishes a round, which
+		// runs them next. Cells that are already complete, e.g. from the
+		// checkpoint or the cache, are written once they are all counted;
+		// no task can complete before the lock is released.
+		std::unique_lock<std::mutex> guard(_writeLock);
+		const int beginCell = _nextToWrite;
+		for (std::size_t i=0; i<_incident.size(); ++i) {
+			for (std::size_t l=0; l<numLambdas; l+=_packetSize) {
+				const int c = i * numLambdas + l;
+				const int len = std::min<int>(_packetSize, numLambdas - l);
+				if (c + len <= beginCell or c >= _endCell or
+					_cells[c].foreign) {
+					continue;
+				}
+				_cellsTotal += len;
+				if (_cells[c].complete) {
+					_cellsDone += len;
+					continue;
+				}
+				if (_tracer.enabled()) {
+					for (int j=0; j<len; ++j) {
+						_cells[c + j].queued = Tracer::Clock::now();
+					}
+				}
+				nextRound(c, len, self);
+			}
+		}
+		writeCompleted();
+		guard.unlock();
+		flushOutput(self);
+
+		pool.wait();
+		_totalRaysCast += _photometer->statistics().total(
+			JobStatistics::Counter::raysCast);
+
+		if (not _checkpoint.empty()) {
+			writeResults(_checkpoint, self);
+		}
+		if (not _shardFile.empty()) {
+			writeResults(_shardFile, self);
+		}
+		if (not _bsdfTable.empty()) {
+			StageTimer timer(_photometer->statistics(), self,
+							 JobStatistics::Stage::write);
+			TraceScope scope(_tracer, self, Tracer::Span::write);
+			BsdfTable::write(_bsdfTable, results(), cs);
+		}
+		if (_progress > 0) {
+			printProgress();
+		}
+		writer.close();
+		if (_tracer.enabled()) {
+			_tracer.write(_trace);
+		}
+	} catch (...) {
+		_running = false;
+		_pool = nullptr;
+		_writer = nullptr;
+		_cache = nullptr;
+		_cacheKeys.clear();
+		_unwritten.clear();
+		_cells.reset();
+		_tracer.reset(0, 0);
+		throw;
+	}
+	_tracer.reset(0, 0);
+	_writer = nullptr;
+	_cache = nullptr;
+	_cacheKeys.clear();
+
+	_running = false;
+	_pool = nullptr;
+	_cells.reset();
+}
+
+void PhotometerJob::nextRound(int cell, int numLambdas, unsigned worker)
 {
-	//return _photometer->numPhotonsCast() + _photonsCast;
-	return 0;
+	const int rays = _cells[cell].rays;
+	int next = 0;
+	if (not adaptive()) {
+		next = std::min(_roundRays, _n - rays);
+	} else if (rays == 0) {
+		next = std::min(_minRays, _maxRays);
+	} else if (rays < _maxRays) {
+		Scalar needed = 0;
+		for (int j=0; j<numLambdas; ++j) {
+			needed = std::max(needed, raysNeeded(_cells[cell + j]));
+		}
+
+		// Each round adds at least an eighth of the rays cast so far, so
+		// that a noisy estimate can't creep towards the target in tiny
+		// steps, and at most as many again, so that it can't overshoot the
+		// target by much.
+		if (needed > rays) {
+			const Scalar wanted = std::ceil(needed) - rays;
+			next = std::min<Scalar>(wanted, rays);
+			next = std::max(next, (rays + 7) / 8);
+			next = std::min(next, _maxRays - rays);
+		}
+	}
+
+	if (next <= 0) {
+		const Tracer::Clock::time_point now = _tracer.enabled() ?
+			Tracer::Clock::now() : Tracer::Clock::time_point();
+		for (int j=0; j<numLambdas; ++j) {
+			_cells[cell + j].complete = true;
+			if (_tracer.enabled()) {
+				_tracer.record(worker, Tracer::Span::cell,
+							   _cells[cell + j].queued, now, cell + j,
+							   _cells[cell + j].rays);
+			}
+		}
+		_cellsDone += numLambdas;
+		writeCompleted();
+		return;
+	}
+
+	// The counters must be set before any task of the round can complete.
+	for (int j=0; j<numLambdas; ++j) {
+		_cells[cell + j].round = next;
+	}
+	_cells[cell].remaining = (next + chunkSize - 1) / chunkSize;
+	for (int first=0; first<next; first+=chunkSize) {
+		const int n = std::min(chunkSize, next - first);
+		const int ray = rays + first;
+		_pool->submit([this, cell, numLambdas, ray, n](unsigned worker) {
+			castChunk(cell, numLambdas, ray, n, worker);
+		});
+	}
 }
 
-void PhotometerJob::Run()
+void PhotometerJob::castChunk(int cell, int numLambdas, int firstRay,
+							  int numRays, unsigned worker)
 {
-	std::cout << "Hello from C++." << std::endl;
+	TraceScope scope(_tracer, worker, Tracer::Span::task, cell, numRays);
+	const Cell & c = _cells[cell];
+	SpectralSample packet;
+	for (int j=0; j<numLambdas; ++j) {
+		packet.add(_lambdas[c.lambda + j], 1);
+	}
+	// The material was prepared with the wavelengths of the job.
+	packet.setPreparedIndex(c.lambda);
+	_photometer->Cast(*_material, _incident[c.incident], packet, cell, _seed,
+					  c.incident, c.lambda, firstRay, numRays, worker);
+	if (_cells[cell].remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		finishRound(cell, numLambdas, worker);
+	}
 }
 
-} // namespace nix
+void PhotometerJob::finishRound(int cell, int numLambdas, unsigned worker)
+{
+	ICollectorSphere & cs = _photometer->collectorSphere();
+	std::vector<std::vector<int>> hits(numLambdas);
+	{
+		StageTimer timer(_photometer->statistics(), worker,
+						 JobStatistics::Stage::merge);
+		TraceScope scope(_tracer, worker, Tracer::Span::merge, cell);
+		for (int j=0; j<numLambdas; ++j) {
+			hits[j] = cs.endCell(cell + j);
+		}
+	}
 
+	{
+		std::lock_guard<std::mutex> guard(_writeLock);
+		for (int j=0; j<numLambdas; ++j) {
+			Cell & c = _cells[cell + j];
+			if (c.hits.empty()) {
+				c.hits = std::move(hits[j]);
+			} else {
+				for (std::size_t id=0; id<hits[j].size(); ++id) {
+					c.hits[id] += hits[j][id];
+				}
+			}
+			c.rays += c.round;
+			c.round = 0;
+		}
+		nextRound(cell, numLambdas, worker);
+
+		if (not _checkpoint.empty() and std::chrono::steady_clock::now() -
+				_lastCheckpoint >= std::chrono::duration<Scalar>(_interval)) {
+			writeResults(_checkpoint, worker);
+			_lastCheckpoint = std::chrono::steady_clock::now();
+		}
+	}
+	flushOutput(worker);
+}
+
+void PhotometerJob::writeCompleted()
+{
+	while (_nextToWrite < _endCell and _cells[_nextToWrite].complete) {
+		Cell & cell = _cells[_nextToWrite];
+		if (!cell.foreign) {
+			writeCell(_nextToWrite);
+		}
+		if (not keepsHits()) {
+			cell.hits.clear();
+			cell.hits.shrink_to_fit();
+		}
+		++_nextToWrite;
+	}
+}
+
+void PhotometerJob::flushOutput(unsigned worker)
+{
+	std::vector<Output> batch;
+	for (;;) {
+		std::unique_lock<std::mutex> flushing(_outputLock, std::try_to_lock);
+		if (!flushing) {
+			// The thread that is flushing will find the output.
+			return;
+		}
+		for (;;) {
+			{
+				std::lock_guard<std::mutex> guard(_writeLock);
+				batch.swap(_unwritten);
+			}
+			if (batch.empty()) {
+				break;
+			}
+			StageTimer timer(_photometer->statistics(), worker,
+							 JobStatistics::Stage::write);
+			TraceScope scope(_tracer, worker, Tracer::Span::write);
+			for (Output & output : batch) {
+				if (not output.cacheKey.empty()) {
+					_cache->store(output.cacheKey, output.block.rays,
+								  output.block.hits);
+				}
+				_writer->push(std::move(output.block));
+			}
+			batch.clear();
+		}
+		flushing.unlock();
+
+		// Output queued after the last batch, but before the lock was
+		// released, was left to this thread.
+		std::lock_guard<std::mutex> guard(_writeLock);
+		if (_unwritten.empty()) {
+			return;
+		}
+	}
+}
+
+Scalar PhotometerJob::raysNeeded(const Cell & cell) const
+{
+	// The relative standard error of a binomial proportion p = h/n is
+	// sqrt((1 - p) / h), and it falls with the square root of n.
+	const Scalar target2 = _targetError * _targetError;
+	Scalar needed = 0;
+	for (int h : cell.hits) {
+		const Scalar p = static_cast<Scalar>(h) / cell.rays;
+		if (h > 0 and p < 1) {
+			const Scalar rse2 = (1 - p) / h;
+			needed = std::max(needed, cell.rays * rse2 / target2);
+		}
+	}
+	return needed;
+}
+
+ResultFile PhotometerJob::describe() const
+{
+	ResultFile file;
+	file.seed = _seed;
+	file.n = _n;
+	file.targetError = _targetError;
+	file.minRays = _minRays;
+	file.maxRays = _maxRays;
+	file.packetSize = _packetSize;
+	file.jobKey = _jobKey;
+	for (const SphericalCoordinates & incident : _incident) {
+		file.polar.push_back(incident.polar());
+		file.azimuth.push_back(incident.azimuthal());
+	}
+	file.lambdas = _lambdas;
+	file.projectedSolidAngles = _projectedSolidAngles;
+	return file;
+}
+
+void PhotometerJob::writeResults(const std::string & fname,
+								 unsigned worker) const
+{
+	StageTimer timer(_photometer->statistics(), worker,
+					 JobStatistics::Stage::checkpoint);
+	TraceScope scope(_tracer, worker, Tracer::Span::checkpoint);
+	if (_writer) {
+		_writer->sync();
+	}
+	results().write(fname);
+}
+
+ResultFile PhotometerJob::results() const
+{
+	ResultFile file = describe();
+	file.cells.resize(_numCells);
+	for (int c=0; c<_numCells; ++c) {
+		const Cell & cell = _cells[c];
+		if (cell.foreign) {
+			continue;
+		}
+		file.cells[c].rays = cell.rays;
+		file.cells[c].complete = cell.complete;
+		if (cell.rays > 0) {
+			file.cells[c].hits = cell.hits;
+		}
+	}
+	return file;
+}
+
+void PhotometerJob::readCheckpoint()
+{
+	std::ifstream exists(_checkpoint);
+	if (!exists) {
+		// Nothing to resume from, so start from scratch.
+		return;
+	}
+	exists.close();
+
+	// The job must be identical, or the cells would not continue the same
+	// streams of rays, through the same material.
+	ResultFile file = ResultFile::read(_checkpoint);
+	if (!file.sameJob(describe())) {
+		throw std::runtime_error("The checkpoint file " + _checkpoint +
+			" was not written by this job.");
+	}
+	for (int c=0; c<_numCells; ++c) {
+		if (_cells[c].foreign) {
+			continue;
+		}
+		_cells[c].rays = file.cells[c].rays;
+		_cells[c].complete = file.cells[c].complete;
+		_cells[c].hits = std::move(file.cells[c].hits);
+	}
+}
+
+ContentHash PhotometerJob::jobHash() const
+{
+	ContentHash job;
+	job.addString("PhotometerJob").addInteger(ResultCache::version);
+	job.addInteger(std::numeric_limits<Scalar>::digits);
+	_material->fingerprint(job);
+	_photometer->collectorSphere().fingerprint(job);
+	job.addInteger(_seed).addInteger(adaptive());
+	if (adaptive()) {
+		job.addScalar(_targetError).addInteger(_minRays).addInteger(_maxRays);
+	} else {
+		job.addInteger(_n);
+	}
+	return job;
+}
+
+std::vector<std::string> PhotometerJob::cacheKeys() const
+{
+	// The rays of a cell are drawn from streams keyed by the seed and by the
+	// indices of its incident angle and of the first wavelength of its
+	// packet, so those are hashed along with their values. Nothing else of
+	// the job, e.g. its other wavelengths, changes the results of a cell.
+	const ContentHash job = jobHash();
+
+	const std::size_t numLambdas = _lambdas.size();
+	std::vector<std::string> keys(_numCells);
+	for (int c=0; c<_numCells; ++c) {
+		const std::size_t i = c / numLambdas;
+		const std::size_t l = c % numLambdas;
+		const std::size_t first = l - l % _packetSize;
+		const std::size_t end = std::min<std::size_t>(first + _packetSize,
+													  numLambdas);
+		ContentHash cell = job;
+		cell.addInteger(i).addScalar(_incident[i].polar())
+			.addScalar(_incident[i].azimuthal());
+		cell.addInteger(first).addScalars(std::vector<Scalar>(
+			_lambdas.begin() + first, _lambdas.begin() + end));
+		cell.addInteger(l - first);
+		keys[c] = cell.hex();
+	}
+	return keys;
+}
+
+void PhotometerJob::readCache()
+{
+	_cacheKeys = cacheKeys();
+
+	// A packet is traced as a whole, so it is only served from the cache if
+	// every one of its cells is found.
+	const std::size_t numLambdas = _lambdas.size();
+	const int numSensors = _projectedSolidAngles.size();
+	std::vector<int> rays(_packetSize);
+	std::vector<std::vector<int>> hits(_packetSize);
+	for (std::size_t i=0; i<_incident.size(); ++i) {
+		for (std::size_t l=0; l<numLambdas; l+=_packetSize) {
+			const int c = i * numLambdas + l;
+			const int len = std::min<int>(_packetSize, numLambdas - l);
+			if (c + len <= _nextToWrite or c >= _endCell or
+				_cells[c].foreign or _cells[c].complete) {
+				continue;
+			}
+			int found = 0;
+			while (found < len and _cache->load(_cacheKeys[c + found],
+					numSensors, rays[found], hits[found])) {
+				++found;
+			}
+			if (found < len) {
+				continue;
+			}
+			for (int j=0; j<len; ++j) {
+				Cell & cell = _cells[c + j];
+				cell.rays = rays[j];
+				cell.hits = std::move(hits[j]);
+				cell.complete = true;
+				cell.cached = true;
+			}
+			_cellsCached += len;
+		}
+	}
+}
+
+void PhotometerJob::printProgress() const
+{
+	const JobStatistics & stats = _photometer->statistics();
+	const Scalar elapsed = stats.elapsed();
+	const long long rays = stats.total(JobStatistics::Counter::raysCast);
+	std::ostringstream line;
+	line << std::fixed << std::setprecision(1)
+		 << "progress: " << _cellsDone << "/" << _cellsTotal << " cells, ";
+	if (not _cacheDirectory.empty()) {
+		line << _cellsCached << " cached, ";
+	}
+	line << rays << " rays, "
+		 << (elapsed > 0 ? rays / elapsed : 0) << " rays/s, "
+		 << elapsed << " s\n";
+	std::cerr << line.str() << std::flush;
+}
+
+void PhotometerJob::writeCell(int c)
+{
+	Cell & cell = _cells[c];
+	const SphericalCoordinates & incident = _incident[cell.incident];
+	Output output { { incident.polar(), incident.azimuthal(),
+		_lambdas[cell.lambda], cell.rays, {} }, {} };
+	if (not keepsHits()) {
+		output.block.hits = std::move(cell.hits);
+	} else {
+		output.block.hits = cell.hits;
+	}
+	if (_cache and not cell.cached) {
+		output.cacheKey = _cacheKeys[c];
+	}
+	_unwritten.push_back(std::move(output));
+}
+
+} // namespace nix
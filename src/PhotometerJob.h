@@ -4,17 +4,29 @@
  ***************************************************************************/
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
-#include <memory>
 
 #include <Scalar.h>
 #include <SphericalCoordinates.h>
+#include <ResultWriter.h>
+#include <Tracer.h>
 
 namespace nix {
 
+class ContentHash;
 class ISpecimen;
 class CollimatedBeamPhotometer;
+class JobStatistics;
+class ResultCache;
+class ResultFile;
+class WorkStealingPool;
 
 /// Executes a spectrophotometer job process.
 /// This class contains a photometer instance as well as the requisite
@@ -24,16 +36,17 @@ class PhotometerJob
 {
 public:
 	/// Default construct the job.  In this state, not enough information
-	/// will be present to actually execute the job.
+	/// will be present to actually execute the job. The shard is that given
+	/// on the command line, if any.
 	PhotometerJob();
 
 	/// Is the job running?
 	/// \return Returns true if the job is currently running.
-	bool running() const noexcept { return true; }
+	bool running() const noexcept { return _running; }
 
 	/// Should verbose output be generated?
 	/// \return Returns true if verbose output is generated.
-	bool verbose() const noexcept { return false; }
+	bool verbose() const noexcept { return _verbose; }
 
 	/// Should verbose output be generated?
 	/// \param verbose Set to true if verbose output should be generated.
@@ -44,19 +57,207 @@ public:
 	/// 
 	/// @TODO Consider making this unsigned.
 	/// \return Returns the number of rays to be cast per measurement.
-	int n() const noexcept { return 0; }
+	int n() const noexcept { return _n; }
 
 	/// Set the number of rays to cast per measurment.
 	/// \param n This is assumed to be a positive number. I.e. \f$n > 0\f$.
 	void setN(int n) noexcept { _n = n; }
 
-	/// Set the filename to direct the output to.
-	/// \param fname The file name is tested for validity when set.
+	/// Is the ray budget of each measurement adaptive?
+	/// \return Returns true if setAdaptive() enabled an error target.
+	bool adaptive() const noexcept { return _targetError > 0; }
+
+	/// Get the relative standard error targeted in adaptive mode.
+	/// \return Returns the target, or zero if the ray budget is fixed.
+	Scalar targetError() const noexcept { return _targetError; }
+
+	/// Get the fewest rays cast per measurement in adaptive mode.
+	/// \return Returns the minimum number of rays.
+	int minRays() const noexcept { return _minRays; }
+
+	/// Get the most rays cast per measurement in adaptive mode.
+	/// \return Returns the maximum number of rays.
+	int maxRays() const noexcept { return _maxRays; }
+
+	/// Cast rays into each measurement cell in rounds until the reflectance
+	/// of every sensor is known to a relative standard error of \p target,
+	/// rather than casting n() rays. The error of a sensor that was hit
+	/// \f$h\f$ times by \f$n\f$ rays is estimated as that of a binomial
+	/// proportion, \f$\sqrt{(1 - h/n) / h}\f$. Sensors that have not been hit
+	/// are taken to be converged, since a reflectance of zero has no relative
+	/// error to speak of. Each round is sized from the worst sensor, and at
+	/// most doubles the rays cast so far. With hero wavelengths, the rounds
+	/// continue until every cell of the packet has converged.
+	///
+	/// The rounds are decided by the results alone, so the output remains
+	/// independent of the number of threads.
+	/// \param target The relative standard error, or zero for a fixed budget.
+	/// \param minRays Rays cast in the first round. \f$minRays > 0\f$.
+	/// \param maxRays Rays cast at most. \f$maxRays \ge minRays\f$.
+	void setAdaptive(Scalar target, int minRays, int maxRays) noexcept
+	{
+		_targetError = target;
+		_minRays = minRays;
+		_maxRays = maxRays;
+	}
+
+	/// Get the seed of the random streams of the job.
+	/// \return Returns the seed.
+	std::uint64_t seed() const noexcept { return _seed; }
+
+	/// Set the seed of the random streams of the job. Every ray draws from
+	/// its own RandomStream, keyed by this seed and by the indices of its
+	/// incident angle, wavelength and position in the measurement. The output
+	/// is therefore the same for a given seed, regardless of the number of
+	/// threads.
+	/// \param seed Any value.
+	void setSeed(std::uint64_t seed) noexcept { _seed = seed; }
+
+	/// Get the number of wavelengths traced together along each path.
+	/// \return Returns a positive number.
+	int heroWavelengths() const noexcept { return _packetSize; }
+
+	/// Trace each path once for a packet of several wavelengths, rather than
+	/// once per wavelength. The path is sampled for a hero wavelength, and
+	/// every wavelength of the packet is weighted by its own refractive index
+	/// and absorption along it. Consecutive wavelengths of _lambdas are
+	/// grouped into packets, so a sweep costs about as much as one wavelength
+	/// per packet. Results depend on the packet size, but not on the number
+	/// of threads.
+	/// \param packetSize The number of wavelengths per packet. Values below
+	///        two trace every wavelength on its own.
+	void setHeroWavelengths(int packetSize) noexcept
+		{ _packetSize = packetSize > 1 ? packetSize : 1; }
+
+	/// Restrict the job to a single measurement cell, e.g. to debug it. The
+	/// rays of the cell are the same as when the whole job is run, so the
+	/// cell's output is identical. With hero wavelengths, the whole packet
+	/// containing the cell is traced.
+	/// \param incident Index of the incident angle, or -1 to run every cell.
+	/// \param lambda Index of the wavelength, or -1 to run every cell.
+	void setCell(int incident, int lambda) noexcept;
+
+	/// Get the file that the progress of the job is saved to.
+	/// \return Returns the file name, which is empty if there is none.
+	const std::string & checkpoint() const noexcept { return _checkpoint; }
+
+	/// Get the time between checkpoints.
+	/// \return Returns the interval in seconds.
+	Scalar checkpointInterval() const noexcept { return _interval; }
+
+	/// Save the progress of the job to a file while it runs, so that it can
+	/// be resumed if it is interrupted. The file holds the job parameters,
+	/// and for every cell the rays cast so far, whether it is complete, and
+	/// its hits. Since every ray draws from its own RandomStream, the number
+	/// of rays cast is the position of the cell's streams. Progress is saved
+	/// at the end of a round of rays once the interval has elapsed, and when
+	/// the job completes. The file is a ResultFile, which is replaced
+	/// atomically.
+	/// \param fname The checkpoint file, or empty to disable checkpoints.
+	/// \param interval The least number of seconds between checkpoints.
+	void setCheckpoint(const std::string & fname, Scalar interval)
+	{
+		_checkpoint = fname;
+		_interval = interval;
+	}
+
+	/// Is the job resumed from its checkpoint file?
+	/// \return Returns true if Run() continues from the checkpoint.
+	bool resume() const noexcept { return _resume; }
+
+	/// Continue from the checkpoint file, if it exists, when the job is run.
+	/// Completed cells are written again without casting any rays, and other
+	/// cells continue from the rays they had cast, so the output is identical
+	/// to that of an uninterrupted run. The checkpoint must have been written
+	/// by the same job, with the same seed, rays, wavelengths, incident
+	/// angles, material and collector sphere.
+	/// \param resume Set to true to resume.
+	void setResume(bool resume) noexcept { _resume = resume; }
+
+	/// Get the index of the shard of the job that is run.
+	/// \return Returns an index in [0, shardCount()).
+	int shardIndex() const noexcept { return _shardIndex; }
+
+	/// Get the number of shards that the job is split into.
+	/// \return Returns a positive number, which is one if it isn't split.
+	int shardCount() const noexcept { return _shardCount; }
+
+	/// Get the file that the results of the shard are saved to.
+	/// \return Returns the file name, which is empty if there is none.
+	const std::string & shardFile() const noexcept { return _shardFile; }
+
+	/// Run only one of several shards of the job, e.g. in separate processes
+	/// or on separate machines. The packets of cells are dealt to the shards
+	/// round-robin. Only the cells of the shard are written to the output,
+	/// and its results are saved to a ResultFile when it completes. The
+	/// results files of all of the shards merge into exactly the output of
+	/// a single run, see ResultFile::merge().
+	/// \param index The index of the shard, in [0, count).
+	/// \param count The number of shards. One runs the whole job.
+	/// \param fname The results file of the shard.
+	void setShard(int index, int count, const std::string & fname)
+	{
+		_shardIndex = index;
+		_shardCount = count;
+		_shardFile = fname;
+	}
+
+	/// Get the file that the BSDF table of the job is written to.
+	/// \return Returns the file name, which is empty if there is none.
+	const std::string & bsdfTableFile() const noexcept { return _bsdfTable; }
+
+	/// Write the results of the job to a binary BsdfTable when it completes,
+	/// besides the text output. The table holds the geometry of the sensors
+	/// and dense arrays of the hits and BSDF estimates, which can be memory
+	/// mapped and sliced without parsing.
+	/// \param fname The table file, or empty for none.
+	void setBsdfTable(const std::string & fname) { _bsdfTable = fname; }
+
+	/// Get the directory of the cache of cell results.
+	/// \return Returns the directory, which is empty if there is none.
+	const std::string & cacheDirectory() const noexcept
+		{ return _cacheDirectory; }
+
+	/// Serve cells from a ResultCache, and store the cells that are traced in
+	/// it. Each cell is keyed by a ContentHash of everything its rays depend
+	/// on: the fingerprints of the material, including its spectra and
+	/// particle generators, and of the collector sphere, the ray budget, the
+	/// seed, its incident angle and the wavelengths of its packet, with their
+	/// indices, which key the random streams. Cells found in the cache are
+	/// complete before any ray is cast and are written without being traced,
+	/// so changing one wavelength of a sweep only traces the cells of that
+	/// wavelength again. A packet of hero wavelengths is only served if all
+	/// of its cells are. The output is identical to that of a run without
+	/// the cache.
+	/// \param directory The cache directory, which is created if it doesn't
+	///        exist, or empty for no cache.
+	void setCache(const std::string & directory)
+		{ _cacheDirectory = directory; }
+
+	/// Get the file that the timeline of the job is written to.
+	/// \return Returns the file name, which is empty if it isn't traced.
+	const std::string & traceFile() const noexcept { return _trace; }
+
+	/// Record a timeline of the job while it runs, and write it to a file as
+	/// a Chrome trace when it completes. Each thread records the tasks it
+	/// runs, the merges of collector shards, and the writes of the output
+	/// and of results files, and the cells are shown from their first task
+	/// being queued to their completion. See Tracer. Tracing is off by
+	/// default, and then costs a test of a flag per span.
+	/// \param fname The trace file, or empty to disable tracing.
+	void setTrace(const std::string & fname) { _trace = fname; }
+
+	/// Set the filename to direct the output to. The output is written by a
+	/// ResultWriter on a thread of its own, and the file is synced to disk
+	/// whenever a checkpoint or results file is saved.
+	/// \param fname The file name, which is tested for validity when set,
+	///        or empty for stdout.
+	/// \throws Throws std::runtime_error if the file can't be written.
 	void setOutput(const std::string & fname);
 
 	/// Get the filename where output is directed.
 	/// \return Returns the filename, which may be empty if stdout is used.
-	std::string fileName() const noexcept { return "asdf.txt"; }
+	const std::string & fileName() const noexcept { return _outputFile; }
 
 	/// Set the incident angles that are to be used for measurement.
 	/// \param incident A vector of incident angles to be used for measurement.
@@ -92,26 +293,234 @@ public:
 	/// \return Returns a const reference which can't be altered.
 	const ISpecimen & material() const noexcept;
 
-	/// Get the total number of photons cast.
+	/// Get the total number of photons cast by the most recent, or the
+	/// running, execution of the job. In adaptive mode this is what was
+	/// actually spent, rather than n() per measurement.
 	/// \return Returns a non-negative value.
-	int numPhotonsCast() const;
+	long long numPhotonsCast() const noexcept;
+
+	/// Get the throughput counters of the most recent, or the running,
+	/// execution of the job. They are kept by the photometer.
+	/// \throws Throws std::runtime_error if there is no photometer.
+	/// \return Returns a const reference to the statistics.
+	const JobStatistics & statistics() const;
+
+	/// Get the number of measurement cells completed by the job.
+	/// \return Returns a non-negative value.
+	int cellsDone() const noexcept { return _cellsDone; }
+
+	/// Get the number of measurement cells that the job runs.
+	/// \return Returns a non-negative value.
+	int cellsTotal() const noexcept { return _cellsTotal; }
+
+	/// Get the number of measurement cells that the job served from its
+	/// cache.
+	/// \return Returns a non-negative value.
+	int cellsCached() const noexcept { return _cellsCached; }
+
+	/// Get the interval between progress lines.
+	/// \return Returns the interval in seconds, or zero if there are none.
+	Scalar progressInterval() const noexcept { return _progress; }
+
+	/// Print a line of progress to stderr at a fixed interval while the job
+	/// runs, and once more when it completes. The line gives the cells
+	/// completed, and those served from the cache if there is one, the rays
+	/// cast, and the rays cast per second.
+	/// \param interval The seconds between lines, or zero for none.
+	void setProgress(Scalar interval) noexcept { _progress = interval; }
 
 	/// Execute the job.
+	/// \throws Throws std::out_of_range if the cell set by setCell() or the
+	///         shard set by setShard() does not exist.
+	/// \throws Throws std::runtime_error if the checkpoint can't be written,
+	///         or if the job is resumed from a checkpoint of another job.
+	///
+	/// The work is split into tasks of up to chunkSize rays for one
+	/// (incident angle, wavelength) measurement cell. The tasks are scheduled
+	/// on a WorkStealingPool with one worker per available core, as set by
+	/// the \c -t command line option. Results are written to the output in
+	/// cell order, as soon as every cell before them is complete.
 	void Run();
 
-	/// Non-trivial destructor. Delete's the output stream if necessary.
-	virtual ~PhotometerJob();
+	/// The maximum number of rays cast by a single task.
+	static constexpr int chunkSize = 4096;
+
+	/// Get the number of rays cast by all the jobs that this process has
+	/// run, e.g. to measure the throughput of a whole script.
+	/// \return Returns the sum of the rays_cast counters of the jobs.
+	static long long totalRaysCast() noexcept
+	{ return _totalRaysCast.load(std::memory_order_relaxed); }
+
+	/// There are no resources to free.
+	virtual ~PhotometerJob() = default;
 
   private:
+	/// Book-keeping for one (incident angle, wavelength) measurement cell.
+	/// The rounds of a packet are tracked by the packet's first cell.
+	struct Cell {
+		std::size_t incident;			///< Index into _incident.
+		std::size_t lambda;				///< Index into _lambdas.
+		std::atomic<int> remaining;		///< Tasks of the round not completed.
+		int rays;						///< Rays cast by the completed rounds.
+		int round;						///< Rays cast by this round.
+		bool complete;					///< All rounds have completed.
+		bool foreign;					///< Run by another shard.
+		bool cached;					///< Served from the cache.
+		std::vector<int> hits;			///< Hits per sensor of past rounds.
+		Tracer::Clock::time_point queued;	///< First queued, if tracing.
+	};
+
+	/// The output of a completed cell, waiting for flushOutput().
+	struct Output {
+		ResultWriter::Block block;		///< The lines of the cell.
+		std::string cacheKey;			///< Key to store it under, or empty.
+	};
+
+	/// Queue the tasks of the next round of rays for a packet of cells, or
+	/// mark the cells complete and queue their output if there is none.
+	/// Requires _writeLock.
+	/// \param cell Index into _cells of the first cell of the packet.
+	/// \param numLambdas Number of wavelengths, and so cells, in the packet.
+	/// \param worker Statistics slot of the calling thread.
+	void nextRound(int cell, int numLambdas, unsigned worker);
+
+	/// Cast a chunk of the rays of a packet of cells. The worker that
+	/// completes the last chunk of a round calls finishRound().
+	/// \param cell Index into _cells of the first cell of the packet.
+	/// \param numLambdas Number of wavelengths, and so cells, in the packet.
+	/// \param firstRay Index of the first ray of the chunk within the cell.
+	/// \param numRays Number of rays to cast.
+	/// \param worker Index of the worker thread running the task.
+	void castChunk(int cell, int numLambdas, int firstRay, int numRays,
+				   unsigned worker);
+
+	/// Merge the collector sphere shards of a completed round into the cells
+	/// of a packet, queue the next round, and save a checkpoint if one is
+	/// due.
+	/// \param cell Index into _cells of the first cell of the packet.
+	/// \param numLambdas Number of wavelengths, and so cells, in the packet.
+	/// \param worker Index of the worker thread running the task.
+	void finishRound(int cell, int numLambdas, unsigned worker);
+
+	/// Get the rays a cell needs for every sensor to meet _targetError.
+	/// \param cell A cell whose rounds so far are complete.
+	/// \return Returns an estimate, which may be less than cell.rays.
+	Scalar raysNeeded(const Cell & cell) const;
+
+	/// Queue the output of every completed cell that is next in line, for
+	/// flushOutput(). Requires _writeLock.
+	void writeCompleted();
+
+	/// Hand the queued output of the cells to the writer, and store it in
+	/// the result cache, in the order of the cells. Only one thread does so
+	/// at a time; a thread that finds another doing it leaves its output to
+	/// that thread. It must not hold _writeLock, so that a writer that falls
+	/// behind only holds up the threads with output, not the job.
+	/// \param worker Statistics slot of the calling thread.
+	void flushOutput(unsigned worker);
+
+	/// Describe the job, without any of its cells.
+	/// \return Returns a ResultFile with no cells.
+	ResultFile describe() const;
+
+	/// Describe the job and the cells that are not foreign. Requires
+	/// _writeLock, or that no tasks are running.
+	/// \return Returns a ResultFile with every cell.
+	ResultFile results() const;
+
+	/// Are the hits of written cells needed later, by results files or by
+	/// the BSDF table?
+	/// \return Returns true if the hits must be kept.
+	bool keepsHits() const noexcept
+	{
+		return not _checkpoint.empty() or not _shardFile.empty() or
+			not _bsdfTable.empty();
+	}
+
+	/// Save the cells of the job that are not foreign, after syncing the
+	/// output written so far. Requires _writeLock, or that no tasks are
+	/// running.
+	/// \param fname The results file.
+	/// \param worker Statistics slot of the calling thread.
+	void writeResults(const std::string & fname, unsigned worker) const;
+
+	/// Restore the cells from the checkpoint file, if it exists.
+	/// \throws Throws std::runtime_error if the checkpoint is of another
+	///         job, including one of another material or collector sphere.
+	void readCheckpoint();
+
+	/// Hash everything of the job that the rays of all of its cells depend
+	/// on: the material, the collector sphere, the seed and the rays per
+	/// cell.
+	/// \return Returns the hash, to which the parameters of a cell may be
+	///         added.
+	ContentHash jobHash() const;
+
+	/// Compute the key of every cell in the result cache.
+	/// \return Returns the keys, indexed by cell.
+	std::vector<std::string> cacheKeys() const;
+
+	/// Complete the packets of cells that are found in the result cache.
+	void readCache();
+
+	/// Write a line of progress to stderr.
+	void printProgress() const;
+
+	/// Queue the results of a cell for flushOutput(). Requires _writeLock.
+	/// \param c The index of the completed cell. Its hits are moved to the
+	///        queue unless results files need them.
+	void writeCell(int c);
+
 	std::unique_ptr<CollimatedBeamPhotometer> _photometer;
 	/// Pointer to the material being simulated.
-	std::unique_ptr<const ISpecimen> _material;
+	std::unique_ptr<ISpecimen> _material;
 	std::vector<Scalar> _lambdas;	///< The wavelengths to measure
 	/// The incident angles ot measure.
 	std::vector<SphericalCoordinates> _incident;
 	int _n;							///< Rays cast per measurement
+	Scalar _targetError;			///< Adaptive error target, or 0
+	int _minRays;					///< Adaptive rays in the first round
+	int _maxRays;					///< Adaptive rays at most
+	std::uint64_t _seed;			///< Seed of the random streams
+	int _onlyIncident;				///< Single incident angle to run, or -1
+	int _onlyLambda;				///< Single wavelength to run, or -1
+	int _packetSize;				///< Wavelengths traced per path
+	std::string _checkpoint;		///< Checkpoint file, or empty
+	Scalar _interval;				///< Seconds between checkpoints
+	bool _resume;					///< Resume from the checkpoint
+	int _shardIndex;				///< Index of the shard to run
+	int _shardCount;				///< Number of shards
+	std::string _shardFile;			///< Results file of the shard
 	bool _verbose;					///< Verbosity flag
-	std::ostream* _out;				///< Stream to write the output to
+	bool _running;					///< Set while Run() is executing
+	std::string _outputFile;		///< Output file, or empty for stdout
+	ResultWriter * _writer;			///< Writes the output of the running job
+	static std::atomic<long long> _totalRaysCast;	///< Over all jobs
+	std::string _bsdfTable;			///< BSDF table file, or empty
+	std::string _cacheDirectory;	///< Result cache directory, or empty
+	ResultCache * _cache;			///< Result cache of the running job
+	std::vector<std::string> _cacheKeys;	///< Key of each cell in _cache
+	std::string _jobKey;			///< jobHash() of the running job
+	std::string _trace;				///< Trace file, or empty
+	mutable Tracer _tracer;			///< Timeline of the running job
+
+	std::unique_ptr<Cell[]> _cells;	///< The cells of the running job
+	int _numCells;					///< Number of entries in _cells
+	int _nextToWrite;				///< First cell not yet written
+	int _endCell;					///< One past the last cell to write
+	int _roundRays;					///< Most rays per round if not adaptive
+	/// Projected solid angle of each sensor of the collector sphere.
+	std::vector<Scalar> _projectedSolidAngles;
+	/// Time that the last checkpoint was written.
+	std::chrono::steady_clock::time_point _lastCheckpoint;
+	std::mutex _writeLock;			///< Guards the cell results and writing
+	std::vector<Output> _unwritten;	///< Queued output, under _writeLock
+	std::mutex _outputLock;			///< Held by the thread flushing output
+	WorkStealingPool * _pool;		///< Runs the tasks of the running job
+	std::atomic<int> _cellsDone;	///< Cells completed by the job
+	std::atomic<int> _cellsTotal;	///< Cells run by the job
+	std::atomic<int> _cellsCached;	///< Cells served from the cache
+	Scalar _progress;				///< Seconds between progress lines
 };
 
 }
@@ -4,15 +4,18 @@
  ***************************************************************************/
 
 #include "PiecewiseLinearSpectrum.h"
+#include <ContentHash.h>
 #include <Scalar.h>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <iostream>
+#include <stdexcept>
 
 namespace nix {
 
 PiecewiseLinearSpectrum::PiecewiseLinearSpectrum()
- : _name("vacuum"), _wavelengths(), _values()
+ : _name("vacuum"), _wavelengths(), _values(), _gridStep(0), _gridError(0)
 {
 	_wavelengths.push_back(380.);
 	_wavelengths.push_back(2500.);
@@ -23,10 +26,13 @@ PiecewiseLinearSpectrum::PiecewiseLinearSpectrum()
 PiecewiseLinearSpectrum::PiecewiseLinearSpectrum(
 	const std::string & name, Scalar low, Scalar high,
 	const std::vector<Scalar> & values)
-  : _name(name)
+  : _name(name), _gridStep(0), _gridError(0)
 {
-	_wavelengths.push_back(low);
-	_wavelengths.push_back(high);
+	// Spread the wavelengths uniformly over the range, one per value
+	const std::size_t n = values.size();
+	for (std::size_t i=0; i<n; ++i) {
+		_wavelengths.push_back(n > 1 ? low + (high - low) * i / (n - 1) : low);
+	}
 	_values = values;
 }
 
@@ -34,7 +40,7 @@ PiecewiseLinearSpectrum::PiecewiseLinearSpectrum(
 	const std::string & name,
 	const std::vector<Scalar> & wavelengths,
 	const std::vector<Scalar> & values)
-  : _name(name)
+  : _name(name), _gridStep(0), _gridError(0)
 {
 	if (wavelengths.size() != values.size()) {
 		throw std::runtime_error("Wavelength size does not match value size.");
@@ -61,9 +67,79 @@ Scalar PiecewiseLinearSpectrum::high() const
 	return * _wavelengths.rbegin()++;
 }
 
-Scalar PiecewiseLinearSpectrum::evaluate(Scalar /*lambda*/) const
+Scalar PiecewiseLinearSpectrum::evaluate(Scalar lambda) const
+{
+	if (_wavelengths.empty() or lambda < _wavelengths.front() or
+		lambda > _wavelengths.back()) {
+		return 0;
+	}
+
+	if (!_grid.empty()) {
+		const Scalar x = (lambda - _wavelengths.front()) / _gridStep;
+		const std::size_t i = std::min(static_cast<std::size_t>(x),
+									   _grid.size() - 2);
+		return _grid[i] + (x - i) * (_grid[i + 1] - _grid[i]);
+	}
+	return interpolate(lambda);
+}
+
+Scalar PiecewiseLinearSpectrum::interpolate(Scalar lambda) const
+{
+	if (_wavelengths.size() == 1) {
+		return _values[0];
+	}
+
+	// Find the first breakpoint at or above lambda, which ends its segment
+	const auto end = std::lower_bound(_wavelengths.begin() + 1,
+									  _wavelengths.end() - 1, lambda);
+	const std::size_t i = end - _wavelengths.begin();
+	const Scalar width = _wavelengths[i] - _wavelengths[i - 1];
+	const Scalar t = width > 0 ? (lambda - _wavelengths[i - 1]) / width : 0;
+	return _values[i - 1] + t * (_values[i] - _values[i - 1]);
+}
+
+Scalar PiecewiseLinearSpectrum::resample(Scalar step)
+{
+	if (!(step > 0)) {
+		throw std::runtime_error("The resampling step of " + _name +
+			" must be positive.");
+	}
+	const Scalar range = high() - low();
+	if (!(range > 0)) {
+		throw std::runtime_error("The spectrum " + _name +
+			" has no range to resample.");
+	}
+
+	clearResampling();
+	const std::size_t steps = std::max<Scalar>(1, std::ceil(range / step));
+	std::vector<Scalar> grid(steps + 1);
+	for (std::size_t i=0; i<=steps; ++i) {
+		grid[i] = interpolate(low() + range * i / steps);
+	}
+	_grid = std::move(grid);
+	_gridStep = range / steps;
+
+	// The difference of two piecewise linear functions is largest at one of
+	// their breakpoints. It is zero at the grid points, so check the others.
+	_gridError = 0;
+	for (std::size_t i=0; i<_wavelengths.size(); ++i) {
+		_gridError = std::max(_gridError,
+			std::abs(evaluate(_wavelengths[i]) - _values[i]));
+	}
+	return _gridError;
+}
+
+void PiecewiseLinearSpectrum::clearResampling() noexcept
 {
-	return 0;
+	_grid.clear();
+	_gridStep = 0;
+	_gridError = 0;
+}
+
+void PiecewiseLinearSpectrum::fingerprint(ContentHash & hash) const
+{
+	hash.addScalars(_wavelengths).addScalars(_values);
+	hash.addScalar(_gridStep).addScalars(_grid);
 }
 
 std::complex<Scalar> getComplexRefractiveIndex(
@@ -73,5 +149,14 @@ std::complex<Scalar> getComplexRefractiveIndex(
 	return std::complex<Scalar>(n ? n->evaluate(lambda) : 1.0, k ? k->evaluate(lambda) : 0.0);
 }
 
+void fingerprint(ContentHash & hash,
+		const std::shared_ptr<const PiecewiseLinearSpectrum> & spectrum)
+{
+	hash.addInteger(spectrum != nullptr);
+	if (spectrum) {
+		spectrum->fingerprint(hash);
+	}
+}
+
 }
 
@@ -12,6 +12,8 @@
 
 namespace nix {
 
+class ContentHash;
+
 /// Specifies a set of values by wavelength.
 /// In-between values are linearly interpolated (I presume).
 class PiecewiseLinearSpectrum
@@ -44,11 +46,39 @@ class PiecewiseLinearSpectrum
 	/// There are no resouces to be explicitly deleted.
 	virtual ~PiecewiseLinearSpectrum() = default;
 
-	/// Linearly interpolate to get a value at the specified wavelength.
+	/// Linearly interpolate to get a value at the specified wavelength. The
+	/// segment is found by binary search, or, if the spectrum has been
+	/// resampled, by indexing the uniform grid.
 	/// \param lambda The desire wavelength.
 	/// \return Returns the interpolated value or zero if it is out of range.
 	Scalar evaluate(Scalar lambda) const;
 
+	/// Resample the spectrum onto a uniform grid over its range, so that
+	/// evaluate() takes one index computation and one multiply-add rather than
+	/// a search. The grid spacing is the largest that divides the range into
+	/// whole steps no larger than \p step. The original breakpoints are kept,
+	/// so the spectrum can be resampled again at another step.
+	///
+	/// This must not be called while other threads evaluate the spectrum.
+	/// \param step The largest spacing of the grid, in nanometres.
+	/// \throws Throws std::runtime_error if the step is not positive, or if
+	///         the spectrum has no range.
+	/// \return Returns the largest absolute difference between the resampled
+	///         and the original spectrum, which is the resamplingError().
+	Scalar resample(Scalar step);
+
+	/// Go back to evaluating the spectrum at its original breakpoints.
+	void clearResampling() noexcept;
+
+	/// Has the spectrum been resampled onto a uniform grid?
+	/// \return Returns true after resample(), until clearResampling().
+	bool resampled() const noexcept { return !_grid.empty(); }
+
+	/// Get the error of resampling.
+	/// \return Returns the largest absolute difference between the resampled
+	///         and the original spectrum, or 0 if it isn't resampled.
+	Scalar resamplingError() const noexcept { return _gridError; }
+
 	/// Return the name of this spectrum.
 	/// \return Returns the name of this spectrum.
 	const std::string & name() const noexcept { return _name; }
@@ -66,16 +96,37 @@ class PiecewiseLinearSpectrum
 	/// is no specified range.
 	/// \return Returns the value pointed to by rbegin()++ in the set of lambdas.
 	Scalar high() const;
+
+	/// Add the breakpoints of the spectrum to a hash, and its grid if it has
+	/// been resampled, since evaluate() then interpolates the grid. The name
+	/// is left out.
+	/// \param hash The hash to add to.
+	void fingerprint(ContentHash & hash) const;
 	
   private:
+	/// Interpolate at the original breakpoints.
+	/// \param lambda A wavelength within the range.
+	/// \return Returns the interpolated value.
+	Scalar interpolate(Scalar lambda) const;
+
 	std::string _name;					///< Names are nice, aren't they?
 	std::vector<Scalar>	_wavelengths;	///< The set of wavelengths.
 	std::vector<Scalar>	_values;		///< The values at each specified wavelength.
+	std::vector<Scalar> _grid;			///< Values on the uniform grid, if any.
+	Scalar _gridStep;					///< Spacing of the uniform grid.
+	Scalar _gridError;					///< Largest error of the grid.
 };
 
 std::complex<Scalar> getComplexRefractiveIndex(
 		const std::shared_ptr<const PiecewiseLinearSpectrum>& n,
 		const std::shared_ptr<const PiecewiseLinearSpectrum>& k, Scalar lambda);
 
+/// Add an optional spectrum to a hash. A missing spectrum is distinct from an
+/// empty one, since getComplexRefractiveIndex() treats them differently.
+/// \param hash The hash to add to.
+/// \param spectrum The spectrum, which may be null.
+void fingerprint(ContentHash & hash,
+		const std::shared_ptr<const PiecewiseLinearSpectrum> & spectrum);
+
 }
 
@@ -0,0 +1,24 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+
+#include "Point3.h"
+
+#include <iostream>
+
+namespace nix {
+
+const Point3 Point3::Origin(0.0, 0.0, 0.0);
+
+std::ostream& Point3::Print(std::ostream &os) const
+{
+	return os << "(" << x << ", " << y << ", " << z << ")";
+}
+
+std::ostream& operator<<(std::ostream &os, const Point3 &p)
+{
+	return p.Print(os);
+}
+
+}
@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include "Scalar.h"
+#include "Vector3.h"
+
+#include <iosfwd>
+
+namespace nix {
+
+//! 3D Point
+/*!
+ * A point in three dimensional space.  Unlike a Vector3, a point is
+ * affected by translations.
+ */
+class Point3
+{
+public:
+	Scalar x /*! x component */, y /*! y component */, z /*! z component */;
+
+	Point3()										//! the origin
+	 : x(0.0), y(0.0), z(0.0)
+	{ }
+
+	Point3(Scalar x, Scalar y, Scalar z)			//! returns the point (x, y, z)
+	 : x(x), y(y), z(z)
+	{ }
+
+	/*!
+	 * \param v [in] displacement to apply
+	 * \returns this point translated by v
+	 */
+	Point3 operator+(const Vector3 & v) const		//! translate by a vector
+	{ return Point3(x + v.x, y + v.y, z + v.z); }
+
+	/*!
+	 * \param p [in] the start point
+	 * \returns the displacement from p to this point
+	 */
+	Vector3 operator-(const Point3 & p) const		//! displacement between points
+	{ return Vector3(x - p.x, y - p.y, z - p.z); }
+
+	/*!
+	 * \param os [in] output stream to write to
+	 * \returns os after it has been written to
+	 */
+	std::ostream& Print(std::ostream& os) const;	//!< prints this point in readable form
+	static const Point3	Origin;						//!< the point (0, 0, 0)
+};
+
+//! prints a point in readable form
+/*!
+ * \sa Point3::Print()
+ * \param os [in] output stream to write to
+ * \param p [in] point to write
+ * \returns output stream after writing
+ */
+std::ostream& operator<<(std::ostream &os, const Point3 &p);
+
+}
@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include "RandomStream.h"
+#include "Ray3.h"
+#include "Scalar.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace nix {
+
+/// The outcome of scattering a single ray through an ISpecimen.
+///
+/// The record is created by the caller of ISpecimen::Scatter() and filled in
+/// by the specimen. Only the exiting ray is of interest to the photometer; the
+/// RayResult returned by the specimen says whether or not it exists.
+///
+/// The record also carries the ray's RandomStream. A specimen must draw all of
+/// its random numbers from it, so that the ray can be reproduced exactly.
+///
+/// When the SpectralSample being scattered holds several wavelengths, the path
+/// is sampled with the probabilities of a single hero wavelength, and the
+/// specimen scales the weight of every wavelength by the ratio of its own
+/// probabilities to those of the hero. The weights start at one. Once a
+/// refraction bends the wavelengths apart, the path is dispersed: only the
+/// hero follows it, and the specimen ends the other wavelengths.
+class RandomScatterRecord
+{
+  public:
+	/// Construct a record whose exit ray leaves the origin straight up.
+	/// \param random The random stream of the ray being scattered.
+	explicit RandomScatterRecord(const RandomStream & random)
+	  : random(random), weights(1, 1) {}
+
+	/// Prepare the record for a new ray, keeping its storage.
+	/// \param stream The random stream of the ray being scattered.
+	/// \param numWavelengths The number of wavelengths in the packet.
+	/// \param heroIndex The wavelength that the path is sampled for.
+	void reset(const RandomStream & stream, std::size_t numWavelengths,
+			   std::size_t heroIndex)
+	{
+		random = stream;
+		exit = Ray3();
+		weights.assign(numWavelengths, 1);
+		hero = heroIndex;
+		dispersed = false;
+	}
+
+	/// The random numbers of the ray being scattered.
+	RandomStream random;
+
+	/// The throughput of each wavelength of the SpectralSample.
+	std::vector<Scalar> weights;
+
+	/// The index of the wavelength that the path is sampled for.
+	std::size_t hero = 0;
+
+	/// Whether the path has been dispersed, and only carries the hero.
+	bool dispersed = false;
+
+	/// The ray leaving the specimen. It is only meaningful if the ray was
+	/// reflected or transmitted.
+	Ray3 exit;
+
+	/// Running count of the scattering events of every ray scattered with
+	/// the record. It is not cleared by reset().
+	long long events = 0;
+
+	/// Running count of the particles generated for every ray scattered with
+	/// the record. It is not cleared by reset().
+	long long particles = 0;
+};
+
+} // namespace nix
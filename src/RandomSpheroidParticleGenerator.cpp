@@ -4,25 +4,90 @@
  ***************************************************************************/
 #include "RandomSpheroidParticleGenerator.h"
 
+#include <ContentHash.h>
+#include <ParticleArena.h>
+#include <RandomStream.h>
+#include <SpheroidParticle.h>
+#include <Vector3.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iostream>
 
 namespace nix {
 
+/// Warp a uniform random number through a warping function.
+/// \param warp The warping function, over any range of "wavelengths".
+/// \param u A uniform random number in \f$[0, 1)\f$.
+/// \param fallback The value to use if there is no warping function.
+/// \return Returns the warped value.
+static Scalar warped(const std::shared_ptr<const PiecewiseLinearSpectrum> & warp,
+					 Scalar u, Scalar fallback)
+{
+	if (!warp or warp->values().empty()) {
+		return fallback;
+	}
+	return warp->evaluate(warp->low() + u * (warp->high() - warp->low()));
+}
+
 //#define DEBUG_WARP_READING
 RandomSpheroidParticleGenerator::RandomSpheroidParticleGenerator(
-	const Array2 /*prolateWarp*/, const Array2 /*oblateWarp*/,
-	std::shared_ptr<PiecewiseLinearSpectrum> /*sizeWarp*/,
-	std::shared_ptr<PiecewiseLinearSpectrum> /*sphericityWarp*/,
-	Scalar /*avgParticleDistance*/)
+	const Array2 & prolateWarp, const Array2 & oblateWarp,
+	std::shared_ptr<PiecewiseLinearSpectrum> sizeWarp,
+	std::shared_ptr<PiecewiseLinearSpectrum> sphericityWarp,
+	Scalar avgParticleDistance)
+  : _prolateWarp(std::make_shared<const WarpTable>(prolateWarp)),
+	_oblateWarp(std::make_shared<const WarpTable>(oblateWarp)),
+	_sizeWarp(sizeWarp),
+	_sphericityWarp(sphericityWarp), _avgParticleDistance(avgParticleDistance)
 {
-
 }
 
-IParticle* RandomSpheroidParticleGenerator::generate() const
+IParticle* RandomSpheroidParticleGenerator::generate(RandomStream& random,
+	ParticleArena& arena) const
 {
-	return nullptr;
+	// Choose the kind of spheroid in proportion to the mass of its table,
+	// then where it lies in the size and sphericity distributions.
+	const double prolate = _prolateWarp->mass();
+	const double total = prolate + _oblateWarp->mass();
+	const bool isProlate = total > 0 ? random.uniform() * total < prolate :
+		random.uniform() < 0.5;
+	const Scalar u1 = random.uniform();
+	const Scalar u2 = random.uniform();
+	Scalar x, y;
+	(isProlate ? _prolateWarp : _oblateWarp)->sample(u1, u2, x, y);
+
+	const Scalar diameter = warped(_sizeWarp, x, 0);
+	Scalar aspect = warped(_sphericityWarp, y, 1);
+	if (!(aspect > 0)) {
+		aspect = 1;
+	}
+	if ((aspect < 1) == isProlate) {
+		aspect = 1 / aspect;
+	}
+
+	// Keep the volume of the sphere of the drawn diameter: a^2 c = r^3
+	const Scalar r = diameter > 0 ? diameter / 2 : 0;
+	const Scalar a = r / std::cbrt(aspect);
+	const Scalar c = a * aspect;
+
+	// Uniformly distributed axis
+	const Scalar z = 1 - 2 * random.uniform();
+	const Scalar phi = 2 * M_PI * random.uniform();
+	const Scalar s = std::sqrt(std::max(Scalar(0), 1 - z * z));
+	return arena.make<SpheroidParticle>(a, c,
+		Vector3(s * std::cos(phi), s * std::sin(phi), z));
 }
 
+void RandomSpheroidParticleGenerator::fingerprint(ContentHash & hash) const
+{
+	hash.addString("RandomSpheroidParticleGenerator");
+	_prolateWarp->fingerprint(hash);
+	_oblateWarp->fingerprint(hash);
+	nix::fingerprint(hash, _sizeWarp);
+	nix::fingerprint(hash, _sphericityWarp);
+	hash.addScalar(_avgParticleDistance);
 }
 
+}
@@ -7,6 +7,7 @@
 #include <IParticleGenerator.h>
 #include <PiecewiseLinearSpectrum.h>
 #include <Scalar.h>
+#include <WarpTable.h>
 
 #include <Array2.h>
 
@@ -15,32 +16,62 @@
 namespace nix {
 
 /// Generate a random spheroidal particle.
+///
+/// A particle is prolate or oblate with probabilities in proportion to the
+/// masses of the prolate and oblate warps. The warp of its kind is a joint
+/// density of two numbers in \f$[0, 1]\f$, which place the particle within
+/// the size and sphericity distributions.
+///
+/// The warping functions map such a number, scaled onto their wavelength
+/// range, to a value. The size warp gives the diameter of the sphere of equal
+/// volume in metres, and the sphericity warp gives the ratio of the polar to
+/// the equatorial radius. The ratio is inverted if it doesn't match the kind
+/// of the particle, so that it is at least 1 for prolate and at most 1 for
+/// oblate spheroids. The axis of each particle is oriented uniformly at
+/// random.
 class RandomSpheroidParticleGenerator : public IParticleGenerator
 {
   public:
 
 	/// Construct a RandomSpheroidParticleGenerator object that is ready to use.
-	/// \param prolateWarp The 2D array used for warping the prolate spheres.
-	/// \param oblateWarp The 2D array used for warping the oblate spheres.
+	/// The 2D warping arrays are not kept, but turned into inverse cumulative
+	/// distribution tables, which are shared by copies of the generator.
+	/// \param prolateWarp The joint density of the size and sphericity of the
+	///        prolate spheroids, rows by size.
+	/// \param oblateWarp The joint density of the size and sphericity of the
+	///        oblate spheroids, rows by size.
 	/// \param sizeWarp The warping function for the particle size.
 	/// \param sphericityWarp The warping function for the sphericity.
 	/// \param avgParticleDistance The average space between the particles. This
 	///        is the distance from the exit point of one particle to the entry
 	///        point of the next particle.
 	RandomSpheroidParticleGenerator(
-		const Array2 prolateWarp, const Array2 oblateWarp,
+		const Array2 & prolateWarp, const Array2 & oblateWarp,
 		std::shared_ptr<PiecewiseLinearSpectrum> sizeWarp,
 		std::shared_ptr<PiecewiseLinearSpectrum> sphericityWarp,
 		Scalar avgParticleDistance);
 
-	IParticle* generate() const;
+	/// Generate a new SpheroidParticle.
+	/// @param random The random numbers of the ray being traced.
+	/// @param arena The arena to make the particle in.
+	/// @return Returns a new particle, owned by \p arena.
+	IParticle* generate(RandomStream& random,
+						ParticleArena& arena) const override;
 
 	/// Get the average distance between the particles.
 	/// This is distance from the exit point of one particle to the entry point
 	/// of the next particle.
 	/// \return Returns the average distance to use between the particles.
 	virtual Scalar
-	averageParticleDistance() const noexcept { return 0.0; }
+	averageParticleDistance() const noexcept { return _avgParticleDistance; }
+
+	/// Add the warping tables and functions and the distance to a hash.
+	/// \copydetails IParticleGenerator::fingerprint()
+	void fingerprint(ContentHash & hash) const override;
+
+	/// Every particle is a SpheroidParticle.
+	/// \return Returns true.
+	bool generatesSpheroids() const noexcept override { return true; }
 
 	/// Provided const access to the size warp function for debugging.
 	/// \return Returns a const pointer.
@@ -52,14 +83,30 @@ class RandomSpheroidParticleGenerator : public IParticleGenerator
 	std::shared_ptr<const PiecewiseLinearSpectrum>
 	sphericityWarpFunction() const { return _sphericityWarp; }
 
+	/// Provide access to the sampling table of the prolate warp.
+	/// \return Returns a pointer to the immutable table.
+	std::shared_ptr<const WarpTable>
+	prolateWarpTable() const { return _prolateWarp; }
+
+	/// Provide access to the sampling table of the oblate warp.
+	/// \return Returns a pointer to the immutable table.
+	std::shared_ptr<const WarpTable>
+	oblateWarpTable() const { return _oblateWarp; }
+
 	/// There are no resources to destroy.
 	virtual ~RandomSpheroidParticleGenerator() = default;
 
   private:
+	/// Warp the shape parameters of prolate spheroids.
+	std::shared_ptr<const WarpTable> _prolateWarp;
+	/// Warp the shape parameters of oblate spheroids.
+	std::shared_ptr<const WarpTable> _oblateWarp;
 	/// Size warp function.
 	std::shared_ptr<const PiecewiseLinearSpectrum> _sizeWarp;
 	/// Sphericity warp function.
 	std::shared_ptr<const PiecewiseLinearSpectrum> _sphericityWarp;
+	/// Average distance between particles.
+	Scalar _avgParticleDistance;
 };
 
 }
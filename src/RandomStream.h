@@ -0,0 +1,115 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include "Scalar.h"
+
+#include <cstdint>
+#include <limits>
+
+namespace nix {
+
+/// A counter-based stream of random numbers.
+///
+/// The stream is the Philox-4x32-10 generator of Salmon et al., "Parallel
+/// Random Numbers: As Easy as 1, 2, 3" (SC 2011). Philox is a keyed bijection
+/// of a 128 bit counter, so the numbers drawn by a ray depend only on the job
+/// seed and on the position of the ray in the job: the incident angle index,
+/// the wavelength index and the ray index. No state is shared between rays or
+/// threads, which makes the output of a job bit-for-bit the same regardless
+/// of the number of threads, of the order in which the rays are cast, or of
+/// whether a single measurement cell is re-run on its own.
+///
+/// The 128 bit counter holds the ray's coordinates in its upper three words
+/// and the number of blocks drawn so far in its lowest word, so each ray owns
+/// a stream of \f$2^{32}\f$ blocks of four 32 bit numbers.
+class RandomStream
+{
+  public:
+	/// Construct the stream of a single ray.
+	/// \param seed The job seed.
+	/// \param incident The index of the incident angle.
+	/// \param lambda The index of the wavelength.
+	/// \param ray The index of the ray within its measurement cell.
+	RandomStream(std::uint64_t seed, std::uint32_t incident,
+				 std::uint32_t lambda, std::uint32_t ray) noexcept
+	  : _key{ static_cast<std::uint32_t>(seed),
+			  static_cast<std::uint32_t>(seed >> 32) },
+		_counter{ 0, ray, lambda, incident }, _used(4)
+	{ }
+
+	/// Draw 32 random bits.
+	/// \return Returns a uniformly distributed 32 bit integer.
+	std::uint32_t next() noexcept
+	{
+		if (_used == 4) {
+			generate();
+		}
+		return _block[_used++];
+	}
+
+	/// Draw a uniform random number.
+	/// \return Returns a Scalar uniformly distributed in \f$[0, 1)\f$.
+	Scalar uniform() noexcept
+	{
+		// Keep as many of 64 random bits as the mantissa holds, so that the
+		// result can't round up to 1.
+		constexpr int digits = std::numeric_limits<Scalar>::digits < 64 ?
+			std::numeric_limits<Scalar>::digits : 64;
+		const std::uint64_t bits =
+			(static_cast<std::uint64_t>(next()) << 32) | next();
+		return static_cast<Scalar>(bits >> (64 - digits)) /
+			static_cast<Scalar>(std::uint64_t(1) << (digits - 1)) / 2;
+	}
+
+	/// Get the number of blocks of four 32 bit numbers drawn so far.
+	/// \return Returns the lowest word of the counter.
+	std::uint32_t blocksDrawn() const noexcept { return _counter[0]; }
+
+	/// Encrypt a counter with the ten rounds of Philox-4x32.
+	/// \param counter The 128 bit counter, lowest word first.
+	/// \param key The 64 bit key, lowest word first.
+	/// \param[out] block Receives the four 32 bit random numbers.
+	static void philox(const std::uint32_t counter[4],
+					   const std::uint32_t key[2],
+					   std::uint32_t block[4]) noexcept
+	{
+		std::uint32_t c[4] = { counter[0], counter[1], counter[2], counter[3] };
+		std::uint32_t k[2] = { key[0], key[1] };
+		for (int round=0; round<10; ++round) {
+			const std::uint64_t p0 = std::uint64_t(0xD2511F53) * c[0];
+			const std::uint64_t p1 = std::uint64_t(0xCD9E8D57) * c[2];
+			const std::uint32_t hi0 = static_cast<std::uint32_t>(p0 >> 32);
+			const std::uint32_t lo0 = static_cast<std::uint32_t>(p0);
+			const std::uint32_t hi1 = static_cast<std::uint32_t>(p1 >> 32);
+			const std::uint32_t lo1 = static_cast<std::uint32_t>(p1);
+			c[0] = hi1 ^ c[1] ^ k[0];
+			c[1] = lo1;
+			c[2] = hi0 ^ c[3] ^ k[1];
+			c[3] = lo0;
+			k[0] += 0x9E3779B9;
+			k[1] += 0xBB67AE85;
+		}
+		for (int i=0; i<4; ++i) {
+			block[i] = c[i];
+		}
+	}
+
+  private:
+	/// Encrypt the counter into the next block and advance the counter.
+	void generate() noexcept
+	{
+		philox(_counter, _key, _block);
+		++_counter[0];
+		_used = 0;
+	}
+
+	std::uint32_t _key[2];		///< The job seed.
+	std::uint32_t _counter[4];	///< Ray coordinates and block number.
+	std::uint32_t _block[4];	///< The most recently generated block.
+	int _used;					///< Numbers of _block already handed out.
+};
+
+} // namespace nix
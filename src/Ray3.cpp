@@ -0,0 +1,22 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+
+#include "Ray3.h"
+
+#include <iostream>
+
+namespace nix {
+
+std::ostream& Ray3::Print(std::ostream &os) const
+{
+	return os << o << " + t" << d;
+}
+
+std::ostream& operator<<(std::ostream &os, const Ray3 &r)
+{
+	return r.Print(os);
+}
+
+}
@@ -0,0 +1,57 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include "Point3.h"
+#include "Scalar.h"
+#include "Vector3.h"
+
+#include <iosfwd>
+
+namespace nix {
+
+//! 3D Ray
+/*!
+ * A half-line defined by an origin point and a direction.  The direction is
+ * assumed to be normalized by whoever constructs the ray.
+ */
+class Ray3
+{
+public:
+	Point3	o;	//!< origin of the ray
+	Vector3	d;	//!< direction of the ray
+
+	Ray3()											//! a ray at the origin pointing up
+	 : o(), d(Vector3::ZAxis)
+	{ }
+
+	Ray3(const Point3 & o, const Vector3 & d)		//! returns the ray o + td
+	 : o(o), d(d)
+	{ }
+
+	/*!
+	 * \param t [in] distance along the ray
+	 * \returns the point \f$o + t\vec{d}\f$
+	 */
+	Point3 at(Scalar t) const						//! point along the ray
+	{ return o + Vector3(t * d.x, t * d.y, t * d.z); }
+
+	/*!
+	 * \param os [in] output stream to write to
+	 * \returns os after it has been written to
+	 */
+	std::ostream& Print(std::ostream& os) const;	//!< prints this ray in readable form
+};
+
+//! prints a ray in readable form
+/*!
+ * \sa Ray3::Print()
+ * \param os [in] output stream to write to
+ * \param r [in] ray to write
+ * \returns output stream after writing
+ */
+std::ostream& operator<<(std::ostream &os, const Ray3 &r);
+
+}
@@ -9,7 +9,8 @@
 
 namespace nix {
 
-RayResult::RayResult(Interaction /*i*/)
+RayResult::RayResult(Interaction i)
+ : _interaction(i), _flags(RayFlags::none)
 {
 }
 
@@ -71,7 +71,12 @@ class RayResult
 	///         surface, instead of undergoing subscattering.
 	bool isMirror() const;
 
-	RayFlags _flags;		///< Properties of the RayResult instance.
+	/// Query the ultimate fate of the ray.
+	/// \return Returns whether the ray was reflected, transmitted or absorbed.
+	Interaction interaction() const noexcept { return _interaction; }
+
+	Interaction _interaction;	///< What ultimately happened to the ray.
+	RayFlags _flags;			///< Properties of the RayResult instance.
 };
 
 } // namespace nix
@@ -0,0 +1,103 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "ResultCache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace nix {
+
+namespace {
+
+/// The first bytes of an entry, which include the format version.
+const char magic[8] = { 'N', 'I', 'X', 'C', 'E', 'L', 'L', '1' };
+
+/// The length of a key, in hexadecimal digits.
+constexpr std::size_t keySize = 32;
+
+} // namespace
+
+constexpr std::int64_t ResultCache::version;
+
+ResultCache::ResultCache(const std::string & directory)
+  : _directory(directory)
+{
+	if (::mkdir(directory.c_str(), 0755) != 0 and errno != EEXIST) {
+		throw std::runtime_error("Unable to create the cache directory " +
+			directory + ": " + std::strerror(errno) + ".");
+	}
+	struct stat st;
+	if (::stat(directory.c_str(), &st) != 0 or not S_ISDIR(st.st_mode)) {
+		throw std::runtime_error(directory + " is not a directory.");
+	}
+}
+
+std::string ResultCache::entry(const std::string & key) const
+{
+	return _directory + "/" + key + ".cell";
+}
+
+bool ResultCache::load(const std::string & key, int numSensors, int & rays,
+					   std::vector<int> & hits) const
+{
+	std::ifstream is(entry(key), std::ios::binary);
+	char header[sizeof(magic) + keySize];
+	std::int32_t count = 0;
+	std::int32_t sensors = 0;
+	if (!is.read(header, sizeof(header)) or
+		std::memcmp(header, magic, sizeof(magic)) != 0 or
+		key.compare(0, std::string::npos, header + sizeof(magic), keySize) != 0
+		or !is.read(reinterpret_cast<char *>(&count), sizeof(count)) or
+		!is.read(reinterpret_cast<char *>(&sensors), sizeof(sensors)) or
+		count <= 0 or sensors != numSensors) {
+		return false;
+	}
+	std::vector<int> found(numSensors);
+	if (!is.read(reinterpret_cast<char *>(found.data()),
+				 numSensors * sizeof(int))) {
+		return false;
+	}
+	rays = count;
+	hits = std::move(found);
+	return true;
+}
+
+void ResultCache::store(const std::string & key, int rays,
+						const std::vector<int> & hits) const
+{
+	// Other processes may store the same entry at once, so each writes a
+	// temporary file of its own.
+	const std::string fname = entry(key);
+	const std::string temp = fname + ".tmp" + std::to_string(::getpid());
+	{
+		const std::int32_t count = rays;
+		const std::int32_t sensors = hits.size();
+		std::ofstream os(temp, std::ios::binary | std::ios::trunc);
+		os.write(magic, sizeof(magic));
+		os.write(key.data(), std::min(key.size(), keySize));
+		os.write(reinterpret_cast<const char *>(&count), sizeof(count));
+		os.write(reinterpret_cast<const char *>(&sensors), sizeof(sensors));
+		os.write(reinterpret_cast<const char *>(hits.data()),
+				 sensors * sizeof(int));
+		if (!os.flush()) {
+			throw std::runtime_error("Unable to write the cache entry " +
+				temp + ".");
+		}
+	}
+	if (std::rename(temp.c_str(), fname.c_str()) != 0) {
+		std::remove(temp.c_str());
+		throw std::runtime_error("Unable to replace the cache entry " +
+			fname + ".");
+	}
+}
+
+} // namespace nix
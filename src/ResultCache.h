@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nix {
+
+/// A directory of the results of measurement cells, keyed by the content
+/// hash of everything that the results depend on.
+///
+/// Each complete cell is stored in a file of its own, named by its key, so
+/// that jobs, and shards of jobs in other processes, can share a directory.
+/// A file holds the key, the rays cast into the cell and its hits. Files are
+/// written to a temporary file which then replaces the entry, so an entry is
+/// either whole or absent. Entries are never removed; deleting the directory,
+/// or any of its files, is always safe.
+///
+/// Numbers are stored in the native byte order, as in ResultFile.
+class ResultCache
+{
+  public:
+	/// The version of the results. It is part of every key, and is to be
+	/// bumped whenever a change to the simulation changes its results, so
+	/// that stale entries are no longer found.
+	static constexpr std::int64_t version = 3;
+
+	/// Open a cache directory, creating it if it doesn't exist. Its parent
+	/// must exist.
+	/// \param directory The name of the directory.
+	/// \throws Throws std::runtime_error if the directory can't be created,
+	///         or if it isn't a directory.
+	explicit ResultCache(const std::string & directory);
+
+	/// Get the directory of the cache.
+	/// \return Returns the name of the directory.
+	const std::string & directory() const noexcept { return _directory; }
+
+	/// Look up the results of a cell. Entries that are truncated, corrupt or
+	/// of another key are treated as missing, and are replaced when the cell
+	/// is stored again.
+	/// \param key The key of the cell, see ContentHash::hex().
+	/// \param numSensors The number of sensors of the collector sphere.
+	/// \param[out] rays Receives the rays cast into the cell, if it is found.
+	/// \param[out] hits Receives the hits on each sensor, if it is found.
+	/// \return Returns true if the cell was found.
+	bool load(const std::string & key, int numSensors, int & rays,
+			  std::vector<int> & hits) const;
+
+	/// Store the results of a complete cell, replacing any previous entry.
+	/// \param key The key of the cell, see ContentHash::hex().
+	/// \param rays The rays cast into the cell, which must be positive.
+	/// \param hits The hits on each sensor.
+	/// \throws Throws std::runtime_error if the entry can't be written.
+	void store(const std::string & key, int rays,
+			   const std::vector<int> & hits) const;
+
+  private:
+	/// Get the file of an entry.
+	/// \param key The key of the entry.
+	/// \return Returns the file name, in the directory.
+	std::string entry(const std::string & key) const;
+
+	std::string _directory;			///< Directory of the entries
+};
+
+} // namespace nix
@@ -0,0 +1,136 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "ResultComparison.h"
+
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace nix {
+
+namespace {
+
+/// One line of the output of a job.
+struct Measurement {
+	double polar, azimuth, lambda;
+	long sensor, hits;
+	double fraction, bsdf;
+};
+
+/// Read the next measurement, skipping any other lines.
+/// \return Returns false at the end of the stream.
+bool next(std::istream & is, Measurement & m)
+{
+	std::string line;
+	while (std::getline(is, line)) {
+		std::istringstream ss(line);
+		if (line.empty() or line[0] == '#') {
+			continue;
+		}
+		if (ss >> m.polar >> m.azimuth >> m.lambda >> m.sensor >> m.hits >>
+			m.fraction >> m.bsdf) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/// Test whether two values printed from different precisions are the same.
+bool same(double a, double b)
+{
+	return std::abs(a - b) <= 1e-6 * std::max(std::abs(a), std::abs(b));
+}
+
+} // namespace
+
+ResultComparison ResultComparison::compare(std::istream & reference,
+										   std::istream & test)
+{
+	ResultComparison result;
+	double sumSquaredRelative = 0;
+	double sumSquaredZ = 0;
+	long relatives = 0;
+	Measurement r, t;
+	for (;;) {
+		const bool moreReference = next(reference, r);
+		const bool moreTest = next(test, t);
+		if (moreReference != moreTest) {
+			throw std::runtime_error("The outputs have different numbers of "
+				"measurements.");
+		}
+		if (!moreReference) {
+			break;
+		}
+		if (!same(r.polar, t.polar) or !same(r.azimuth, t.azimuth) or
+			!same(r.lambda, t.lambda) or r.sensor != t.sensor) {
+			throw std::runtime_error("Measurement " +
+				std::to_string(result.lines + 1) + " is of a different cell "
+				"or sensor in the two outputs.");
+		}
+		++result.lines;
+		result.maxBsdfError = std::max(result.maxBsdfError,
+									   std::abs(r.bsdf - t.bsdf));
+		if (r.hits == 0 and t.hits == 0) {
+			continue;
+		}
+		++result.lit;
+		if (r.fraction > 0) {
+			const double relative = std::abs(t.fraction / r.fraction - 1);
+			result.maxRelativeError = std::max(result.maxRelativeError,
+											   relative);
+			sumSquaredRelative += relative * relative;
+			++relatives;
+		}
+
+		// The rays of a cell follow from any sensor with hits, and are
+		// taken to be the same in both runs if one of them has none.
+		const double nr = r.hits > 0 ? r.hits / r.fraction : t.hits / t.fraction;
+		const double nt = t.hits > 0 ? t.hits / t.fraction : nr;
+		const double p = (r.hits + t.hits) / (nr + nt);
+		const double variance = p * (1 - p) * (1 / nr + 1 / nt);
+		if (variance > 0) {
+			const double z = (t.fraction - r.fraction) / std::sqrt(variance);
+			sumSquaredZ += z * z;
+			result.outliers += std::abs(z) > 3 ? 1 : 0;
+		}
+	}
+	if (relatives > 0) {
+		result.rmsRelativeError = std::sqrt(sumSquaredRelative / relatives);
+	}
+	if (result.lit > 0) {
+		result.meanSquaredZ = sumSquaredZ / result.lit;
+	}
+	return result;
+}
+
+bool ResultComparison::equivalent() const noexcept
+{
+	if (lit == 0) {
+		return true;
+	}
+	const double p = 0.0027;
+	const double maxZ = 1 + 3 * std::sqrt(2.0 / lit);
+	const double maxOutliers = p * lit + 3 * std::sqrt(p * (1 - p) * lit);
+	return meanSquaredZ <= maxZ and outliers <= std::ceil(maxOutliers);
+}
+
+void ResultComparison::writeReport(std::ostream & os) const
+{
+	os << "measurements:                 " << lines << "\n"
+	   << "with hits:                    " << lit << "\n"
+	   << "max |bsdf difference|:        " << maxBsdfError << "\n"
+	   << "max relative difference:      " << maxRelativeError << "\n"
+	   << "rms relative difference:      " << rmsRelativeError << "\n"
+	   << "mean z^2 (<= 1 is noise):     " << meanSquaredZ << "\n"
+	   << "|z| > 3 (0.27% is noise):     " << outliers << "\n"
+	   << "equivalent within noise:      " << (equivalent() ? "yes" : "no")
+	   << std::endl;
+}
+
+} // namespace nix
@@ -0,0 +1,55 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include <iosfwd>
+
+namespace nix {
+
+/// A comparison of the output of two runs of the same jobs, e.g. of a build
+/// with double or float Scalars against the long double reference.
+///
+/// The runs trace different paths once their rounding differs, so the hits
+/// aren't expected to agree exactly. Besides the raw differences, every
+/// sensor's difference is scaled by the binomial standard error of the two
+/// fractions. If the runs only differ by Monte Carlo noise, the mean square
+/// of the scaled differences is at most about one, and few of them exceed
+/// three. It is less than one when the runs share their random streams, as
+/// the builds of different precisions do, since most paths are then the same.
+class ResultComparison
+{
+  public:
+	/// Compare two outputs line by line. Lines that aren't measurements, such
+	/// as headers, are skipped.
+	/// \param reference The output of the reference run.
+	/// \param test The output of the run being compared.
+	/// \throws Throws std::runtime_error if the outputs aren't of the same
+	///         measurements.
+	/// \return Returns the comparison.
+	static ResultComparison compare(std::istream & reference,
+									std::istream & test);
+
+	/// Test whether the differences are within Monte Carlo noise. Under noise
+	/// alone, the mean square of the scaled differences of n lit
+	/// measurements is about one with a standard deviation of sqrt(2/n), and
+	/// the number beyond three is binomial with p = 0.27%. Each may be up to
+	/// three standard deviations above its expected value.
+	/// \return Returns true if the runs are statistically equivalent.
+	bool equivalent() const noexcept;
+
+	/// Write a report of the comparison.
+	/// \param os The stream to write to.
+	void writeReport(std::ostream & os) const;
+
+	long lines = 0;					///< Measurements compared.
+	long lit = 0;					///< Measurements with hits in either.
+	double maxBsdfError = 0;		///< Largest absolute BSDF difference.
+	double maxRelativeError = 0;	///< Largest relative fraction difference.
+	double rmsRelativeError = 0;	///< RMS relative fraction difference.
+	double meanSquaredZ = 0;		///< Mean square of the scaled differences.
+	long outliers = 0;				///< Scaled differences beyond three.
+};
+
+} // namespace nix
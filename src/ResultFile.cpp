@@ -0,0 +1,268 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "ResultFile.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace nix {
+
+namespace {
+
+/// The first bytes of a results file, which include the format version.
+const char magic[8] = { 'N', 'I', 'X', 'R', 'S', 'L', 'T', '2' };
+
+/// The longest job key that is read, which is far longer than any hex().
+constexpr std::int32_t maxKeySize = 256;
+
+/// Flush a file or folder to disk.
+/// \param path The file or folder.
+/// \param flags The flags to open it with.
+/// \return Returns false, with errno set, if it can't be synced.
+bool syncPath(const std::string & path, int flags)
+{
+	const int fd = ::open(path.c_str(), flags);
+	if (fd < 0) {
+		return false;
+	}
+	const bool synced = ::fsync(fd) == 0;
+	const int error = errno;
+	::close(fd);
+	errno = error;
+	return synced;
+}
+
+template<typename T>
+void writeValue(std::ostream & os, T value)
+{
+	os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+/// Write Scalars as the sum of two doubles, which is exact for Scalars of up
+/// to 106 bits of precision, and doesn't write the padding of long doubles.
+void writeScalars(std::ostream & os, const std::vector<Scalar> & values)
+{
+	writeValue<std::int32_t>(os, values.size());
+	for (Scalar value : values) {
+		const double high = static_cast<double>(value);
+		writeValue<double>(os, high);
+		writeValue<double>(os, static_cast<double>(value - high));
+	}
+}
+
+template<typename T>
+T readValue(std::istream & is)
+{
+	T value;
+	if (!is.read(reinterpret_cast<char *>(&value), sizeof(T))) {
+		throw std::runtime_error("The results file is truncated.");
+	}
+	return value;
+}
+
+void readScalars(std::istream & is, std::vector<Scalar> & values)
+{
+	const std::int32_t size = readValue<std::int32_t>(is);
+	if (size < 0) {
+		throw std::runtime_error("The results file is corrupt.");
+	}
+	values.resize(size);
+	for (Scalar & value : values) {
+		const double high = readValue<double>(is);
+		value = static_cast<Scalar>(high) + readValue<double>(is);
+	}
+}
+
+} // namespace
+
+const char * const ResultFile::textHeader =
+	"# polar azimuth lambda sensor hits fraction bsdf";
+
+bool ResultFile::sameJob(const ResultFile & other) const noexcept
+{
+	return seed == other.seed and n == other.n and
+		targetError == other.targetError and minRays == other.minRays and
+		maxRays == other.maxRays and packetSize == other.packetSize and
+		jobKey == other.jobKey and polar == other.polar and azimuth == other.azimuth and
+		lambdas == other.lambdas and
+		projectedSolidAngles == other.projectedSolidAngles;
+}
+
+void ResultFile::write(const std::string & fname) const
+{
+	const std::string temp = fname + ".tmp";
+	{
+		std::ofstream os(temp, std::ios::binary | std::ios::trunc);
+		os.write(magic, sizeof(magic));
+		writeValue<std::uint64_t>(os, seed);
+		writeValue<std::int32_t>(os, n);
+		writeValue<double>(os, targetError);
+		writeValue<std::int32_t>(os, minRays);
+		writeValue<std::int32_t>(os, maxRays);
+		writeValue<std::int32_t>(os, packetSize);
+		writeValue<std::int32_t>(os, jobKey.size());
+		os.write(jobKey.data(), jobKey.size());
+		writeScalars(os, polar);
+		writeScalars(os, azimuth);
+		writeScalars(os, lambdas);
+		writeScalars(os, projectedSolidAngles);
+		writeValue<std::int32_t>(os, cells.size());
+		for (const Cell & cell : cells) {
+			writeValue<std::int32_t>(os, cell.rays);
+			writeValue<std::uint8_t>(os, cell.complete);
+			if (cell.rays > 0) {
+				os.write(reinterpret_cast<const char *>(cell.hits.data()),
+						 numSensors() * sizeof(int));
+			}
+		}
+		if (!os.flush()) {
+			throw std::runtime_error("Unable to write the results file " +
+				temp + ".");
+		}
+	}
+	replace(temp, fname);
+}
+
+void ResultFile::replace(const std::string & temp, const std::string & fname)
+{
+	if (!syncPath(temp, O_RDONLY)) {
+		throw std::runtime_error("Unable to sync " + temp + ": " +
+			std::strerror(errno) + ".");
+	}
+	if (std::rename(temp.c_str(), fname.c_str()) != 0) {
+		throw std::runtime_error("Unable to replace " + fname + ": " +
+			std::strerror(errno) + ".");
+	}
+	const std::string::size_type slash = fname.find_last_of('/');
+	const std::string folder = slash == std::string::npos ? "." :
+		slash == 0 ? "/" : fname.substr(0, slash);
+	if (!syncPath(folder, O_RDONLY | O_DIRECTORY)) {
+		throw std::runtime_error("Unable to sync " + folder + ": " +
+			std::strerror(errno) + ".");
+	}
+}
+
+ResultFile ResultFile::read(const std::string & fname)
+{
+	std::ifstream is(fname, std::ios::binary);
+	if (!is) {
+		throw std::runtime_error("Unable to open the results file " +
+			fname + ".");
+	}
+
+	ResultFile file;
+	char found[sizeof(magic)];
+	if (!is.read(found, sizeof(found)) or
+		std::memcmp(found, magic, sizeof(magic)) != 0) {
+		throw std::runtime_error(fname + " is not a results file.");
+	}
+	file.seed = readValue<std::uint64_t>(is);
+	file.n = readValue<std::int32_t>(is);
+	file.targetError = readValue<double>(is);
+	file.minRays = readValue<std::int32_t>(is);
+	file.maxRays = readValue<std::int32_t>(is);
+	file.packetSize = readValue<std::int32_t>(is);
+	const std::int32_t keySize = readValue<std::int32_t>(is);
+	if (keySize < 0 or keySize > maxKeySize) {
+		throw std::runtime_error(fname + " is corrupt.");
+	}
+	file.jobKey.resize(keySize);
+	if (!is.read(&file.jobKey[0], keySize)) {
+		throw std::runtime_error("The results file is truncated.");
+	}
+	readScalars(is, file.polar);
+	readScalars(is, file.azimuth);
+	readScalars(is, file.lambdas);
+	readScalars(is, file.projectedSolidAngles);
+	const std::int32_t numCells = readValue<std::int32_t>(is);
+	if (file.polar.size() != file.azimuth.size() or numCells < 0 or
+		std::size_t(numCells) != file.polar.size() * file.lambdas.size()) {
+		throw std::runtime_error(fname + " is corrupt.");
+	}
+	file.cells.resize(numCells);
+	for (Cell & cell : file.cells) {
+		cell.rays = readValue<std::int32_t>(is);
+		cell.complete = readValue<std::uint8_t>(is) != 0;
+		if (cell.rays > 0) {
+			cell.hits.resize(file.numSensors());
+			for (int & h : cell.hits) {
+				h = readValue<std::int32_t>(is);
+			}
+		}
+	}
+	return file;
+}
+
+ResultFile ResultFile::merge(const std::vector<std::string> & fnames)
+{
+	if (fnames.empty()) {
+		throw std::runtime_error("There are no results files to merge.");
+	}
+
+	ResultFile result = read(fnames[0]);
+	for (std::size_t f=1; f<fnames.size(); ++f) {
+		const ResultFile shard = read(fnames[f]);
+		if (!result.sameJob(shard)) {
+			throw std::runtime_error(fnames[f] + " is of a different job than "
+				+ fnames[0] + ".");
+		}
+		for (std::size_t c=0; c<result.cells.size(); ++c) {
+			const Cell & cell = shard.cells[c];
+			if (!cell.complete) {
+				continue;
+			}
+			Cell & merged = result.cells[c];
+			if (!merged.complete) {
+				merged = cell;
+			} else if (merged.rays != cell.rays or merged.hits != cell.hits) {
+				throw std::runtime_error(fnames[f] + " disagrees with the other"
+					" results files on cell " + std::to_string(c) + ".");
+			}
+		}
+	}
+
+	for (std::size_t c=0; c<result.cells.size(); ++c) {
+		if (!result.cells[c].complete) {
+			throw std::runtime_error("Cell " + std::to_string(c) + " is not"
+				" complete in any of the results files.");
+		}
+	}
+	return result;
+}
+
+void ResultFile::writeText(std::ostream & os) const
+{
+	os << textHeader << std::endl;
+	for (std::size_t c=0; c<cells.size(); ++c) {
+		const std::size_t i = c / lambdas.size();
+		const std::size_t l = c % lambdas.size();
+		if (cells[c].complete and cells[c].rays > 0) {
+			writeCell(os, polar[i], azimuth[i], lambdas[l], cells[c].rays,
+					  cells[c].hits, projectedSolidAngles);
+		}
+	}
+	os.flush();
+}
+
+void ResultFile::writeCell(std::ostream & os, Scalar polar, Scalar azimuth,
+	Scalar lambda, int rays, const std::vector<int> & hits,
+	const std::vector<Scalar> & projectedSolidAngles)
+{
+	for (unsigned id=0; id<hits.size(); ++id) {
+		const Scalar fraction = static_cast<Scalar>(hits[id]) / rays;
+		const Scalar psa = projectedSolidAngles[id];
+		os << polar << " " << azimuth << " "
+		   << lambda << " " << id << " " << hits[id] << " "
+		   << fraction << " " << (psa > 0 ? fraction / psa : 0) << "\n";
+	}
+}
+
+} // namespace nix
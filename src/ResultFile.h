@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include "Scalar.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace nix {
+
+/// The results of a PhotometerJob, in a compact binary file.
+///
+/// The file describes the job, with the parameters that its rays depend on,
+/// the key of a hash of its material and collector sphere, and everything
+/// needed to write its output, followed by the state of every
+/// measurement cell: the rays cast into it, whether it is complete, and the
+/// hits on each sensor. Checkpoints and the output of shards are results
+/// files, and any set of results files of one job can be merged into its
+/// output without the Lua script that set it up.
+///
+/// Numbers are stored in the native byte order, so the files are only portable
+/// between machines that share it. Scalars are stored exactly, as the sum of
+/// two doubles, so that the output written from a file is identical to that
+/// of the job.
+class ResultFile
+{
+  public:
+	/// The results of one (incident angle, wavelength) measurement cell.
+	struct Cell {
+		int rays = 0;				///< Rays cast into the cell.
+		bool complete = false;		///< No more rays will be cast.
+		std::vector<int> hits;		///< Hits per sensor, if rays > 0.
+	};
+
+	std::uint64_t seed = 0;			///< Seed of the random streams.
+	int n = 0;						///< Rays per cell, if not adaptive.
+	double targetError = 0;			///< Adaptive error target, or 0.
+	int minRays = 0;				///< Adaptive rays in the first round.
+	int maxRays = 0;				///< Adaptive rays at most.
+	int packetSize = 1;				///< Wavelengths traced per path.
+	/// The hex() of the job's ContentHash, see PhotometerJob::jobHash().
+	std::string jobKey;
+	std::vector<Scalar> polar;		///< Polar angle of each incident angle.
+	std::vector<Scalar> azimuth;	///< Azimuth of each incident angle.
+	std::vector<Scalar> lambdas;	///< The wavelengths, in nanometres.
+
+	/// The projected solid angle of each sensor of the collector sphere.
+	std::vector<Scalar> projectedSolidAngles;
+
+	/// The cells, indexed by incident * lambdas.size() + lambda.
+	std::vector<Cell> cells;
+
+	/// Get the number of sensors of the collector sphere.
+	/// \return Returns the number of sensors.
+	int numSensors() const noexcept { return projectedSolidAngles.size(); }
+
+	/// Test whether two files describe the same job, ignoring the cells.
+	/// \param other The file to compare to.
+	/// \return Returns true if every parameter, and the key, is identical.
+	bool sameJob(const ResultFile & other) const noexcept;
+
+	/// Write the file. It is written to a temporary file which then replaces
+	/// \p fname, with replace(), so that an interrupted write, or a crash of
+	/// the machine, leaves either the new file or any previous one intact.
+	/// \param fname The name of the file.
+	/// \throws Throws std::runtime_error if the file can't be written.
+	void write(const std::string & fname) const;
+
+	/// Durably replace a file with a complete temporary file. The temporary
+	/// file is synced to disk before it is renamed over \p fname, and the
+	/// folder is synced after, so that the rename survives a crash.
+	/// \param temp The name of the temporary file, which has been closed.
+	/// \param fname The name of the file to replace.
+	/// \throws Throws std::runtime_error if a step fails.
+	static void replace(const std::string & temp, const std::string & fname);
+
+	/// Read a file.
+	/// \param fname The name of the file.
+	/// \throws Throws std::runtime_error if the file can't be read, or is not
+	///         a results file.
+	/// \return Returns the contents of the file.
+	static ResultFile read(const std::string & fname);
+
+	/// Merge the results files of the shards of a job. Every cell must be
+	/// complete in at least one of the files, and the files must agree on
+	/// the cells that are complete in several of them.
+	/// \param fnames The names of the files.
+	/// \throws Throws std::runtime_error if a file can't be read, if the files
+	///         are of different jobs, or if they disagree or leave a cell
+	///         incomplete.
+	/// \return Returns the results of the whole job.
+	static ResultFile merge(const std::vector<std::string> & fnames);
+
+	/// Write the output of a job, as PhotometerJob does.
+	/// \param os The stream to write to.
+	void writeText(std::ostream & os) const;
+
+	/// The header line of the output of a job.
+	static const char * const textHeader;
+
+	/// Write the output lines of a complete measurement cell.
+	/// \param os The stream to write to.
+	/// \param polar The polar angle of incidence.
+	/// \param azimuth The azimuth of incidence.
+	/// \param lambda The wavelength.
+	/// \param rays The rays cast into the cell, which must be positive.
+	/// \param hits The hits on each sensor.
+	/// \param projectedSolidAngles The projected solid angle of each sensor.
+	static void writeCell(std::ostream & os, Scalar polar, Scalar azimuth,
+		Scalar lambda, int rays, const std::vector<int> & hits,
+		const std::vector<Scalar> & projectedSolidAngles);
+};
+
+} // namespace nix
@@ -0,0 +1,175 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "ResultWriter.h"
+
+#include "ResultFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace nix {
+
+constexpr std::size_t ResultWriter::defaultCapacity;
+
+ResultWriter::ResultWriter(const std::string & fname,
+	const std::vector<Scalar> & projectedSolidAngles, std::size_t capacity)
+  : _projectedSolidAngles(projectedSolidAngles),
+	_capacity(capacity > 0 ? capacity : 1), _fd(-1), _writing(false),
+	_closing(false)
+{
+	if (not fname.empty()) {
+		_fd = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (_fd < 0) {
+			throw std::runtime_error("Unable to open the output file " +
+				fname + ": " + std::strerror(errno) + ".");
+		}
+	}
+	_pending.reserve(_capacity);
+	try {
+		write(std::string(ResultFile::textHeader) + "\n");
+		if (_fd < 0) {
+			std::cout.flush();
+		}
+		_thread = std::thread(&ResultWriter::run, this);
+	} catch (...) {
+		if (_fd >= 0) {
+			::close(_fd);
+		}
+		throw;
+	}
+}
+
+ResultWriter::~ResultWriter()
+{
+	try {
+		close();
+	} catch (...) {
+	}
+}
+
+void ResultWriter::push(Block && block)
+{
+	std::unique_lock<std::mutex> guard(_lock);
+	_done.wait(guard, [this]() {
+		return _pending.size() < _capacity or _error or _closing;
+	});
+	rethrow();
+	if (_closing) {
+		throw std::runtime_error("The output is closed.");
+	}
+	_pending.push_back(std::move(block));
+	_wake.notify_one();
+}
+
+void ResultWriter::sync()
+{
+	std::unique_lock<std::mutex> guard(_lock);
+	_done.wait(guard, [this]() {
+		return (_pending.empty() and not _writing) or _error;
+	});
+	rethrow();
+	if (_fd < 0) {
+		std::cout.flush();
+	} else if (::fsync(_fd) != 0) {
+		throw std::runtime_error(std::string("Unable to sync the output: ") +
+			std::strerror(errno) + ".");
+	}
+}
+
+void ResultWriter::close()
+{
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_closing = true;
+	}
+	_wake.notify_one();
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+	if (_fd >= 0) {
+		::close(_fd);
+		_fd = -1;
+	}
+	std::lock_guard<std::mutex> guard(_lock);
+	rethrow();
+}
+
+void ResultWriter::run()
+{
+	std::vector<Block> blocks;
+	blocks.reserve(_capacity);
+	std::ostringstream text;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> guard(_lock);
+			_writing = false;
+			_done.notify_all();
+			_wake.wait(guard, [this]() {
+				return not _pending.empty() or _closing;
+			});
+			if (_pending.empty() or _error) {
+				return;
+			}
+			blocks.swap(_pending);
+			_writing = true;
+			_done.notify_all();
+		}
+
+		try {
+			text.str(std::string());
+			for (const Block & b : blocks) {
+				ResultFile::writeCell(text, b.polar, b.azimuth, b.lambda,
+									  b.rays, b.hits, _projectedSolidAngles);
+			}
+			write(text.str());
+			if (_fd < 0) {
+				std::cout.flush();
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> guard(_lock);
+			_error = std::current_exception();
+		}
+		blocks.clear();
+	}
+}
+
+void ResultWriter::write(const std::string & text)
+{
+	if (_fd < 0) {
+		std::cout.write(text.data(), text.size());
+		if (!std::cout) {
+			throw std::runtime_error("Unable to write the output.");
+		}
+		return;
+	}
+	const char * data = text.data();
+	std::size_t left = text.size();
+	while (left > 0) {
+		const ssize_t n = ::write(_fd, data, left);
+		if (n < 0 and errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			throw std::runtime_error(std::string("Unable to write the "
+				"output: ") + std::strerror(errno) + ".");
+		}
+		data += n;
+		left -= n;
+	}
+}
+
+void ResultWriter::rethrow()
+{
+	if (_error) {
+		std::rethrow_exception(_error);
+	}
+}
+
+} // namespace nix
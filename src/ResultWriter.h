@@ -0,0 +1,106 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include "Scalar.h"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nix {
+
+/// Writes the output of a PhotometerJob on a thread of its own.
+///
+/// Workers push the results of completed measurement cells, which the writer
+/// formats as text and writes, so that formatting and I/O overlap with ray
+/// tracing rather than stalling the workers. The writer is double buffered:
+/// it takes every pending block at once, and the workers fill an empty
+/// buffer while it formats and writes them. The pending blocks are bounded,
+/// and a push waits while the writer is behind by that many.
+///
+/// The output is a file, or standard output if no file name is given. Files
+/// are only synced to disk by sync(), e.g. when the job saves a checkpoint.
+class ResultWriter
+{
+  public:
+	/// The results of one complete (incident angle, wavelength) cell.
+	struct Block {
+		Scalar polar;				///< Polar angle of incidence.
+		Scalar azimuth;				///< Azimuth of incidence.
+		Scalar lambda;				///< Wavelength.
+		int rays;					///< Rays cast into the cell.
+		std::vector<int> hits;		///< Hits on each sensor.
+	};
+
+	/// The default number of blocks that may be pending.
+	static constexpr std::size_t defaultCapacity = 64;
+
+	/// Open the output, write its header line, and start the writer thread.
+	/// \param fname The output file, which is truncated, or empty for
+	///        standard output.
+	/// \param projectedSolidAngles The projected solid angle of each sensor.
+	/// \param capacity The number of blocks that may be pending.
+	/// \throws Throws std::runtime_error if the file can't be opened.
+	ResultWriter(const std::string & fname,
+				 const std::vector<Scalar> & projectedSolidAngles,
+				 std::size_t capacity = defaultCapacity);
+
+	/// Write the pending blocks and stop the writer thread. Errors are
+	/// ignored; call close() to see them.
+	~ResultWriter();
+
+	/// The writer is not copyable.
+	ResultWriter(const ResultWriter &) = delete;
+
+	/// The writer is not assignable.
+	/// \return Never returns.
+	ResultWriter & operator=(const ResultWriter &) = delete;
+
+	/// Queue the results of a cell. Blocks are written in the order in which
+	/// they are pushed. This waits while the writer is behind by the
+	/// capacity.
+	/// \param block The results, which are moved from.
+	/// \throws Throws std::runtime_error if an earlier write failed.
+	void push(Block && block);
+
+	/// Wait until every queued block is written, then flush the output and
+	/// sync it to disk if it is a file.
+	/// \throws Throws std::runtime_error if a write or the sync failed.
+	void sync();
+
+	/// Write the pending blocks, stop the writer thread and close the file.
+	/// \throws Throws std::runtime_error if a write failed.
+	void close();
+
+  private:
+	/// Format and write blocks until closed. Runs on _thread.
+	void run();
+
+	/// Write text to the output.
+	/// \param text The text to write.
+	/// \throws Throws std::runtime_error if the write fails.
+	void write(const std::string & text);
+
+	/// Throw the error of the writer thread, if any. Requires _lock.
+	void rethrow();
+
+	std::vector<Scalar> _projectedSolidAngles;	///< Per sensor
+	std::size_t _capacity;			///< Most blocks pending
+	int _fd;						///< Output file, or -1 for stdout
+	std::mutex _lock;				///< Guards the members below
+	std::condition_variable _wake;	///< Signals the writer thread
+	std::condition_variable _done;	///< Signals pushes and syncs
+	std::vector<Block> _pending;	///< Blocks not taken by the writer
+	bool _writing;					///< The writer holds blocks
+	bool _closing;					///< No more blocks will be pushed
+	std::exception_ptr _error;		///< Failure of the writer thread
+	std::thread _thread;			///< Formats and writes the blocks
+};
+
+} // namespace nix
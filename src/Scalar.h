@@ -6,9 +6,12 @@
 
 namespace nix {
 
-#define USE_LONG_DOUBLE
-//#define USE_DOUBLE
-//#define USE_FLOAT
+// The precision is chosen when building, by defining USE_DOUBLE or USE_FLOAT.
+// The default is long double, which is the reference the others are compared
+// against. See NIX_PRECISION_VARIANTS in src/CMakeLists.txt.
+#if !defined(USE_DOUBLE) && !defined(USE_FLOAT)
+#	define USE_LONG_DOUBLE
+#endif
 
 #ifdef USE_LONG_DOUBLE
 using Scalar = long double;
@@ -11,22 +11,15 @@
 
 namespace nix {
 
-SpectralSample::SpectralSample()
+SpectralSample::SpectralSample(Scalar wavelength, Scalar value)
+ : _wavelengths(1, wavelength), _values(1, value)
 {
 }
 
-SpectralSample::SpectralSample(const SpectralSample& /*other*/)
+void SpectralSample::add(Scalar wavelength, Scalar value)
 {
+	_wavelengths.push_back(wavelength);
+	_values.push_back(value);
 }
 
-SpectralSample::SpectralSample(Scalar /*wavelength*/, Scalar /*value*/)
-{
-}
-
-SpectralSample&	SpectralSample::operator=(const SpectralSample& /*other*/)
-{
-	return *this;
 }
-
-}
-
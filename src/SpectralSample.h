@@ -7,24 +7,67 @@
 #include "Scalar.h"
 
 #include <cassert>
+#include <cstddef>
 #include <utility>
 #include <vector>
 
 namespace nix {
 
-struct SpectralSampleImpl;	//!< implementation of SpectralSample
-
 //! A set of wavelength-amplitude pairs
+/*!
+ * A sample may hold a packet of several wavelengths that travel along the
+ * same path through a specimen. Wavelengths are in nanometres.
+ */
 class SpectralSample
 {
   public:
-	SpectralSample();
-	SpectralSample(const SpectralSample& other);
+	SpectralSample() = default;
+	SpectralSample(const SpectralSample& other) = default;
 	SpectralSample(Scalar wavelength, Scalar value);
 	virtual ~SpectralSample() = default;
-	
-	SpectralSample&	operator=(const SpectralSample& other);
+
+	SpectralSample&	operator=(const SpectralSample& other) = default;
+
+	//! adds a wavelength to the sample
+	/*!
+	 * \param wavelength [in] the wavelength in nanometres
+	 * \param value [in] the amplitude at that wavelength
+	 */
+	void add(Scalar wavelength, Scalar value);
+
+	//! the number of wavelengths in the sample
+	std::size_t size() const noexcept { return _wavelengths.size(); }
+
+	//! the i-th wavelength
+	Scalar wavelength(std::size_t i) const
+	{ assert(i < size()); return _wavelengths[i]; }
+
+	//! the amplitude of the i-th wavelength
+	Scalar value(std::size_t i) const
+	{ assert(i < size()); return _values[i]; }
+
+	//! the position of the sample among the prepared wavelengths
+	/*!
+	 * \return the index of the first wavelength of the sample among those
+	 * that the specimen was prepared with, see ISpecimen::prepare(), if the
+	 * wavelengths of the sample are consecutive ones of those, or -1
+	 */
+	int preparedIndex() const noexcept { return _preparedIndex; }
+
+	//! records the position of the sample among the prepared wavelengths
+	/*!
+	 * Specimens use it to look up what they tabulated for the wavelengths,
+	 * without searching for them.
+	 * \param index [in] the index of the first wavelength of the sample
+	 * among those that the specimen was prepared with, or -1 if they are not
+	 * consecutive ones of those
+	 */
+	void setPreparedIndex(int index) noexcept { _preparedIndex = index; }
+
+  private:
+	std::vector<Scalar> _wavelengths;	//!< wavelengths in nanometres
+	std::vector<Scalar> _values;		//!< amplitude of each wavelength
+	int _preparedIndex = -1;			//!< see preparedIndex()
 };
 
 }
-
@@ -5,41 +5,74 @@
 
 #include "SpectrophotometerCollectorSphere.h"
 
+#include <ContentHash.h>
+#include <Ray3.h>
+
 #include <cassert>
+#include <cmath>
 
 namespace nix {
 
 SpectrophotometerCollectorSphere::SpectrophotometerCollectorSphere()
- : CollectorSphere(2)
+ : CollectorSphere(2), _up(Vector3::ZAxis), _upper(true), _lower(true),
+   _upperId(0), _lowerId(1)
 {
 }
 
 SpectrophotometerCollectorSphere::SpectrophotometerCollectorSphere(
-	const bool /*upper*/, const bool /*lower, const Vector3 & up*/)
- : CollectorSphere{0}
+	const bool upper, const bool lower/*, const Vector3 & up*/)
+ : CollectorSphere{(upper ? 1 : 0) + (lower ? 1 : 0)},
+   _up(Vector3::ZAxis), _upper(upper), _lower(lower),
+   _upperId(upper ? 0 : -1), _lowerId(lower ? (upper ? 1 : 0) : -1)
 {
 }
 
-SphericalCoordinates SpectrophotometerCollectorSphere::center(int /*sensorId*/) const
+void SpectrophotometerCollectorSphere::checkSensorId(int sensorId) const
 {
-	assert(false);
-	throw std::out_of_range("Sensor ID out of range.");
+	if (sensorId < 0 or sensorId >= numSensors()) {
+		throw std::out_of_range("Sensor ID out of range.");
+	}
 }
 
-Scalar SpectrophotometerCollectorSphere::getSolidAngle(int /*sensorId*/) const
+SphericalCoordinates SpectrophotometerCollectorSphere::center(int sensorId) const
 {
-	return 0.0;
+	checkSensorId(sensorId);
+	if (sensorId == 0 and _upper) {
+		return SphericalCoordinates(0, 0);
+	}
+	return SphericalCoordinates(M_PI, 0);
 }
 
-Scalar SpectrophotometerCollectorSphere::getProjectedSolidAngle(int /*sensorId*/) const
+Scalar SpectrophotometerCollectorSphere::getSolidAngle(int sensorId) const
 {
-	return 0.0;
+	checkSensorId(sensorId);
+	return 2.0 * M_PI;
 }
 
-int SpectrophotometerCollectorSphere::getSensorId(const Ray3& /*photon*/) const noexcept
+Scalar SpectrophotometerCollectorSphere::getProjectedSolidAngle(int sensorId) const
 {
-	return 0;
+	checkSensorId(sensorId);
+	return M_PI;
 }
 
-} // namespace nix
+int SpectrophotometerCollectorSphere::getSensorId(const Ray3& photon) const noexcept
+{
+	return sensorId(photon.d.x, photon.d.y, photon.d.z);
+}
 
+void SpectrophotometerCollectorSphere::getSensorIds(const Scalar * x,
+	const Scalar * y, const Scalar * z, int count, int * ids) const
+{
+	for (int i=0; i<count; ++i) {
+		ids[i] = sensorId(x[i], y[i], z[i]);
+	}
+}
+
+void SpectrophotometerCollectorSphere::fingerprint(ContentHash & hash) const
+{
+	hash.addString("SpectrophotometerCollectorSphere");
+	hash.addScalar(_up.x).addScalar(_up.y).addScalar(_up.z);
+	hash.addInteger(_upper).addInteger(_lower);
+}
+
+} // namespace nix
@@ -60,23 +60,51 @@ class SpectrophotometerCollectorSphere : public CollectorSphere
 	///         enabled, or -1 if no hemisphere is struck.
 	int getSensorId(const Ray3& photon) const noexcept;
 
+	/// Determine which hemisphere each of a block of directions strikes.
+	/// \copydetails ICollectorSphere::getSensorIds()
+	void getSensorIds(const Scalar * x, const Scalar * y, const Scalar * z,
+					  int count, int * ids) const override;
+
 	/// Test if the upper hemisphere is enabled.
 	/// \return Returns true if the upper hemisphere is enabled.
-	inline bool upperEnabled() const noexcept { return true; }
+	inline bool upperEnabled() const noexcept { return _upper; }
 
 	/// Test if the lower hemisphere is enabled.
 	/// \return Returns true if the lower hemisphere is enabled.
-	inline bool lowerEnabled() const noexcept { return false; }
+	inline bool lowerEnabled() const noexcept { return _lower; }
 
 	/// Provide read-only access to the up vector.
 	/// \return Returns a const reference to the up vector.
 	inline const Vector3 & up() const noexcept{ return _up; }
 
+	/// \copydoc ICollectorSphere::fingerprint()
+	void fingerprint(ContentHash & hash) const override;
+
 	/// Trival, generated destructor.
 	virtual ~SpectrophotometerCollectorSphere() = default;
 	
 private:
+	/// Check that a sensor ID refers to an enabled hemisphere.
+	/// \throws Throws std::out_of_range if sensorId is out of range.
+	/// \param sensorId The sensor ID to check.
+	void checkSensorId(int sensorId) const;
+
+	/// Branch-free hemisphere lookup shared by the single and block versions.
+	/// \param x The x component of the direction.
+	/// \param y The y component of the direction.
+	/// \param z The z component of the direction.
+	/// \return Returns the struck sensor, or -1.
+	int sensorId(Scalar x, Scalar y, Scalar z) const noexcept
+	{
+		const Scalar cosTheta = x * _up.x + y * _up.y + z * _up.z;
+		return cosTheta > 0 ? _upperId : (cosTheta < 0 ? _lowerId : -1);
+	}
+
 	Vector3 _up;	///< The up direction of the sphere is typically the Z-axis
+	bool _upper;	///< The upper hemisphere is enabled.
+	bool _lower;	///< The lower hemisphere is enabled.
+	int _upperId;	///< Sensor ID of the upper hemisphere, or -1.
+	int _lowerId;	///< Sensor ID of the lower hemisphere, or -1.
 
 };
 
@@ -3,24 +3,43 @@
  *   University of Waterloo, Waterloo, Canada                              *
  ***************************************************************************/
 
+#include <cmath>
 #include <iostream>
 
 #include "SphericalCoordinates.h"
+#include "Vector3.h"
 
 namespace nix {
 
 SphericalCoordinates::SphericalCoordinates()
+ : _polar(0.0), _azimuthal(0.0), _radius(1.0)
 {
 }
 
-SphericalCoordinates::SphericalCoordinates(Scalar /*polar*/, Scalar /*azimuthal*/, Scalar /*radius*/)
+SphericalCoordinates::SphericalCoordinates(Scalar polar, Scalar azimuthal, Scalar radius)
+ : _polar(polar), _azimuthal(azimuthal), _radius(radius)
 {
 }
 
-std::ostream & operator<<(std::ostream & os, const SphericalCoordinates & /*sc*/)
+Vector3 SphericalCoordinates::toVector() const
 {
+	using std::cos;
+	using std::sin;
+	const Scalar sinTheta = sin(_polar);
+	return Vector3(_radius * sinTheta * cos(_azimuthal),
+				   _radius * sinTheta * sin(_azimuthal),
+				   _radius * cos(_polar));
+}
+
+void SphericalCoordinates::print(std::ostream & os) const
+{
+	os << "(" << _polar << ", " << _azimuthal << ", " << _radius << ")";
+}
+
+std::ostream & operator<<(std::ostream & os, const SphericalCoordinates & sc)
+{
+	sc.print(os);
 	return os;
 }
 
 } // namespace nix
-
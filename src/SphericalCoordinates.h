@@ -10,6 +10,8 @@
 
 namespace nix {
 
+class Vector3;
+
 /// Representation of an point in spherical coordinates.
 /// Typically, the polar angle is denoted &theta;, the azimuthal angle
 /// is denoted with &phi;, and the radius is denoted \f$r\f$.
@@ -32,6 +34,31 @@ class SphericalCoordinates
 
 	~SphericalCoordinates() = default;
 
+	/// Get the polar angle, &theta;, in radians.
+	/// \return Returns the angle away from the up direction.
+	Scalar polar() const noexcept { return _polar; }
+
+	/// Get the azimuthal angle, &phi;, in radians.
+	/// \return Returns the angle around the up direction.
+	Scalar azimuthal() const noexcept { return _azimuthal; }
+
+	/// Get the radius.
+	/// \return Returns the distance from the origin.
+	Scalar radius() const noexcept { return _radius; }
+
+	/// Convert to a Cartesian vector with the z-axis as the up direction.
+	/// \return Returns \f$r(\sin\theta\cos\phi, \sin\theta\sin\phi,
+	///         \cos\theta)\f$.
+	Vector3 toVector() const;
+
+	/// Output the co-ordinates in a human readable format.
+	/// \param os The output stream to write to.
+	void print(std::ostream & os) const;
+
+  private:
+	Scalar _polar;		///< The polar angle in radians.
+	Scalar _azimuthal;	///< The azimuthal angle in radians.
+	Scalar _radius;		///< The distance from the origin.
 };
 
 /// Output a SphericalCoordinates object to \c os in a human readable format.
@@ -44,4 +71,3 @@ std::ostream & operator<<(std::ostream & os,
 						  const SphericalCoordinates & sc);
 
 } // namespace nix
-
@@ -0,0 +1,213 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "SpheroidParticle.h"
+
+#include <Interval.h>
+#include <Point3.h>
+#include <RandomStream.h>
+#include <Ray3.h>
+#include <Vector3Block.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace nix {
+
+/// Build two unit vectors perpendicular to a unit vector, and to each other.
+/// \param w The unit vector.
+/// \param[out] u The first perpendicular vector.
+/// \param[out] v The second perpendicular vector.
+static void perpendiculars(const Vector3 & w, Vector3 & u, Vector3 & v)
+{
+	u = std::abs(w.x) < 0.9 ? cross(Vector3(1, 0, 0), w).normalized()
+							: cross(Vector3(0, 1, 0), w).normalized();
+	v = cross(w, u);
+}
+
+SpheroidParticle::SpheroidParticle(Scalar a, Scalar c, const Vector3 & axis)
+  : _a(a), _c(c), _w(axis.normalized())
+{
+	perpendiculars(_w, _u, _v);
+}
+
+Vector3 SpheroidParticle::toUnitSphere(const Vector3 & w) const
+{
+	return Vector3(dot(w, _u) / _a, dot(w, _v) / _a, dot(w, _w) / _c);
+}
+
+Vector3 SpheroidParticle::normal(const Vector3 & q) const
+{
+	return (_u * (q.x / _a) + _v * (q.y / _a) + _w * (q.z / _c)).normalized();
+}
+
+bool SpheroidParticle::roots(const Ray3& ray, Scalar & t0, Scalar & t1) const
+{
+	const Vector3 o = toUnitSphere(ray.o - Point3::Origin);
+	const Vector3 d = toUnitSphere(ray.d);
+	const Scalar A = dot(d, d);
+	const Scalar B = dot(o, d);
+	const Scalar C = dot(o, o) - 1;
+	const Scalar disc = B * B - A * C;
+	if (disc < 0 or A <= 0) {
+		return false;
+	}
+	// Avoid cancellation by computing the root of larger magnitude first
+	const Scalar q = -(B + std::copysign(std::sqrt(disc), B));
+	if (q == 0) {
+		t0 = t1 = 0;
+		return true;
+	}
+	t0 = q / A;
+	t1 = C / q;
+	if (t0 > t1) {
+		std::swap(t0, t1);
+	}
+	return true;
+}
+
+bool SpheroidParticle::GetExitPoint(const Ray3& ray, Scalar &t, Point3& p,
+									Vector3& N) const
+{
+	Scalar t0, t1;
+	if (!roots(ray, t0, t1) or t1 < 0) {
+		return false;
+	}
+	t = std::max(t1, Scalar(0));
+	p = ray.at(t);
+	N = normal(toUnitSphere(p - Point3::Origin));
+	return true;
+}
+
+constexpr int SpheroidParticle::batchSize;
+
+void SpheroidParticle::GetExitPoints(const SpheroidParticle * const * particles,
+	const Ray3 * rays, int count, Scalar * t, Point3 * p, Vector3 * N,
+	bool * exits)
+{
+	constexpr int M = batchSize;
+	for (int first=0; first<count; first+=M) {
+		const int n = std::min(M, count - first);
+
+		// Gather the rays, in the frames where their spheroids are unit
+		// spheres, and the axes of the spheroids. Unused lanes repeat the
+		// first ray.
+		Vector3Block<M> o, d, ro, rd, u, v, w;
+		Scalar a[M], c[M];
+		for (int k=0; k<M; ++k) {
+			const int i = first + (k < n ? k : 0);
+			const SpheroidParticle & s = *particles[i];
+			o.set(k, s.toUnitSphere(rays[i].o - Point3::Origin));
+			d.set(k, s.toUnitSphere(rays[i].d));
+			ro.set(k, rays[i].o - Point3::Origin);
+			rd.set(k, rays[i].d);
+			u.set(k, s._u);
+			v.set(k, s._v);
+			w.set(k, s._w);
+			a[k] = s._a;
+			c[k] = s._c;
+		}
+
+		// The far root of the quadratic, as in roots()
+		Scalar far[M], hit[M];
+		Scalar any = 0;
+		for (int k=0; k<M; ++k) {
+			const Scalar A = d.x[k] * d.x[k] + d.y[k] * d.y[k] +
+							 d.z[k] * d.z[k];
+			const Scalar B = o.x[k] * d.x[k] + o.y[k] * d.y[k] +
+							 o.z[k] * d.z[k];
+			const Scalar C = o.x[k] * o.x[k] + o.y[k] * o.y[k] +
+							 o.z[k] * o.z[k] - 1;
+			const Scalar disc = B * B - A * C;
+			const Scalar root = std::sqrt(disc < 0 ? 0 : disc);
+			const Scalar q = -(B + std::copysign(root, B));
+			const Scalar t0 = q / A;
+			const Scalar t1 = C / q;
+			const Scalar t2 = q == 0 ? 0 : (t0 > t1 ? t0 : t1);
+			const bool ok = !(disc < 0) and !(A <= 0) and !(t2 < 0);
+			far[k] = t2 < 0 ? 0 : t2;
+			hit[k] = ok ? 1 : 0;
+			any += hit[k];
+		}
+		for (int k=0; k<n; ++k) {
+			exits[first + k] = hit[k] != 0;
+		}
+		if (any == 0) {
+			continue;
+		}
+
+		// The exit points, and the normals there, as in GetExitPoint()
+		Vector3Block<M> q, nn;
+		for (int k=0; k<M; ++k) {
+			q.x[k] = ro.x[k] + far[k] * rd.x[k];
+			q.y[k] = ro.y[k] + far[k] * rd.y[k];
+			q.z[k] = ro.z[k] + far[k] * rd.z[k];
+			const Scalar sx = (q.x[k] * u.x[k] + q.y[k] * u.y[k] +
+							   q.z[k] * u.z[k]) / a[k] / a[k];
+			const Scalar sy = (q.x[k] * v.x[k] + q.y[k] * v.y[k] +
+							   q.z[k] * v.z[k]) / a[k] / a[k];
+			const Scalar sz = (q.x[k] * w.x[k] + q.y[k] * w.y[k] +
+							   q.z[k] * w.z[k]) / c[k] / c[k];
+			nn.x[k] = u.x[k] * sx + v.x[k] * sy + w.x[k] * sz;
+			nn.y[k] = u.y[k] * sx + v.y[k] * sy + w.y[k] * sz;
+			nn.z[k] = u.z[k] * sx + v.z[k] * sy + w.z[k] * sz;
+		}
+		normalize(nn);
+		for (int k=0; k<n; ++k) {
+			t[first + k] = far[k];
+			p[first + k] = Point3::Origin + q.get(k);
+			N[first + k] = nn.get(k);
+		}
+	}
+}
+
+void SpheroidParticle::GetUniformRandomPoint(Point3& p, Vector3& N,
+	const Vector3& dir, RandomStream& random) const
+{
+	// Aim rays along dir uniformly over a disc that covers the particle and
+	// keep the first one that strikes it.
+	const Vector3 d = dir.normalized();
+	Vector3 e1, e2;
+	perpendiculars(d, e1, e2);
+	const Scalar R = std::max(_a, _c);
+	constexpr int maxTries = 1000;
+	for (int i=0; i<maxTries; ++i) {
+		const Scalar r = R * std::sqrt(random.uniform());
+		const Scalar phi = 2 * M_PI * random.uniform();
+		const Ray3 ray(Point3::Origin + (e1 * (r * std::cos(phi)) +
+						e2 * (r * std::sin(phi)) - d * (2 * R)), d);
+		Scalar t0, t1;
+		if (roots(ray, t0, t1)) {
+			p = ray.at(t0);
+			N = normal(toUnitSphere(p - Point3::Origin));
+			return;
+		}
+	}
+	// Only reachable for a degenerate particle; strike it head on.
+	const Ray3 ray(Point3::Origin + d * (-2 * R), d);
+	Scalar t0, t1;
+	roots(ray, t0, t1);
+	p = ray.at(t0);
+	N = -d;
+}
+
+bool SpheroidParticle::intersects(const Ray3& ray, const Interval& I) const
+{
+	Scalar t0, t1;
+	return roots(ray, t0, t1) and !I.IsEmpty() and
+		t0 <= I.Max() and t1 >= I.Min();
+}
+
+bool SpheroidParticle::intersects(const Ray3& ray) const
+{
+	Scalar t0, t1;
+	return roots(ray, t0, t1) and t1 >= 0;
+}
+
+Scalar SpheroidParticle::diameter() const
+{
+	return 2 * std::max(_a, _c);
+}
+
+} // namespace nix
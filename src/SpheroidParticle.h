@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include <IParticle.h>
+#include <Scalar.h>
+#include <Vector3.h>
+
+namespace nix {
+
+/// A spheroid centred on the origin. The spheroid has an equatorial radius
+/// \f$a\f$ and a polar radius \f$c\f$ along its axis of symmetry. It is
+/// prolate if \f$c > a\f$ and oblate if \f$c < a\f$.
+///
+/// Ray queries map the ray into the frame in which the spheroid is the unit
+/// sphere, where the intersection is the solution of a quadratic. The mapping
+/// is linear, so distances along the ray are the same in both frames.
+class SpheroidParticle : public IParticle
+{
+  public:
+	/// Construct a spheroid.
+	/// \param a The equatorial radius, in metres. Must be positive.
+	/// \param c The polar radius, in metres. Must be positive.
+	/// \param axis The unit axis of symmetry.
+	SpheroidParticle(Scalar a, Scalar c, const Vector3 & axis);
+
+	/// \copydoc IParticle::GetExitPoint()
+	bool GetExitPoint(const Ray3& ray, Scalar &t, Point3& p,
+					  Vector3& N) const override;
+
+	/// The number of rays that GetExitPoints() intersects at once.
+	static constexpr int batchSize = 8;
+
+	/// Find where rays that start inside spheroids leave them. Each ray has
+	/// its own spheroid, and the result is exactly what GetExitPoint() gives
+	/// it, but the rays are intersected batchSize at a time, by a kernel
+	/// without branches that is vectorized for double and float Scalars. A
+	/// batch in which every ray misses skips the exit points and normals.
+	/// \param particles The spheroid of each ray.
+	/// \param rays The rays, in the frames of their spheroids.
+	/// \param count The number of rays.
+	/// \param[out] t The distance along each ray to its exit point.
+	/// \param[out] p The exit point of each ray.
+	/// \param[out] N The outward unit normal at each exit point.
+	/// \param[out] exits Whether each ray leaves its spheroid. The other
+	///        outputs of the rays that don't are meaningless.
+	static void GetExitPoints(const SpheroidParticle * const * particles,
+							  const Ray3 * rays, int count, Scalar * t,
+							  Point3 * p, Vector3 * N, bool * exits);
+
+	/// \copydoc IParticle::GetUniformRandomPoint()
+	void GetUniformRandomPoint(Point3& p, Vector3& N, const Vector3& dir,
+							   RandomStream& random) const override;
+
+	/// Test if a ray strikes the particle within a range of distances.
+	/// \param ray The ray to test.
+	/// \param I The range of distances along the ray.
+	/// \return Returns true if the ray enters or leaves the particle in I.
+	bool intersects(const Ray3& ray, const Interval& I) const override;
+
+	/// Test if a ray strikes the particle ahead of its origin.
+	/// \param ray The ray to test.
+	/// \return Returns true if part of the particle is ahead of the ray.
+	bool intersects(const Ray3& ray) const override;
+
+	/// Get the largest extent of the particle.
+	/// \return Returns \f$2\max(a, c)\f$.
+	Scalar diameter() const override;
+
+	/// Get the equatorial radius.
+	/// \return Returns \f$a\f$.
+	Scalar a() const noexcept { return _a; }
+
+	/// Get the polar radius.
+	/// \return Returns \f$c\f$.
+	Scalar c() const noexcept { return _c; }
+
+	/// Default virtual destructor.
+	virtual ~SpheroidParticle() = default;
+
+  private:
+	/// Map a vector into the frame where the spheroid is the unit sphere.
+	/// \param w A vector in the particle's frame.
+	/// \return Returns the mapped vector.
+	Vector3 toUnitSphere(const Vector3 & w) const;
+
+	/// Get the outward unit normal at a point on the surface.
+	/// \param q The point, mapped into the unit sphere frame.
+	/// \return Returns the normal in the particle's frame.
+	Vector3 normal(const Vector3 & q) const;
+
+	/// Intersect a ray with the spheroid.
+	/// \param ray The ray to intersect.
+	/// \param[out] t0 The distance to the entry point.
+	/// \param[out] t1 The distance to the exit point.
+	/// \return Returns false if the line of the ray misses the spheroid.
+	bool roots(const Ray3& ray, Scalar & t0, Scalar & t1) const;
+
+	Scalar _a;		///< Equatorial radius.
+	Scalar _c;		///< Polar radius.
+	Vector3 _u;		///< First equatorial axis.
+	Vector3 _v;		///< Second equatorial axis.
+	Vector3 _w;		///< Axis of symmetry.
+};
+
+} // namespace nix
@@ -4,11 +4,28 @@
  ***************************************************************************/
 #include "Test1Material.h"
 
+#include <ContentHash.h>
+#include <Intersection.h>
+#include <IParticle.h>
+#include <IParticleGenerator.h>
+#include <ParticleArena.h>
+#include <PiecewiseLinearSpectrum.h>
+#include <RandomScatterRecord.h>
+#include <RandomStream.h>
 #include <RayResult.h>
+#include <SpectralSample.h>
+#include <SpheroidParticle.h>
+#include <Vector3.h>
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <stdexcept>
+#include <string>
 #include <type_traits>
 
 // USE_SNELL indicates that simple Snell's law should be used for refraction
@@ -18,16 +35,401 @@
 
 namespace nix {
 
+using Complex = std::complex<Scalar>;
+
+/// Limit on the number of particles a path may strike.
+static constexpr int maxEvents = 100000;
+
+/// Limit on the number of internal reflections within a particle.
+static constexpr int maxInternalReflections = 100;
+
+/// Paths whose largest weight drops below this play Russian roulette.
+static constexpr Scalar rouletteThreshold = 0.01;
+
+/// Unpolarized Fresnel reflectance.
+/// \param cosi Cosine of the angle of incidence.
+/// \param m Refractive index of the far side relative to the near side.
+/// \return Returns the fraction of light that is reflected.
+static Scalar fresnel(Scalar cosi, const Complex & m)
+{
+	cosi = std::min(std::max(cosi, Scalar(0)), Scalar(1));
+	const Complex cost = std::sqrt(Scalar(1) - (1 - cosi * cosi) / (m * m));
+	const Complex rs = (cosi - m * cost) / (cosi + m * cost);
+	const Complex rp = (m * cosi - cost) / (m * cosi + cost);
+	return std::min(Scalar(1), (std::norm(rs) + std::norm(rp)) / 2);
+}
+
+/// Make a choice shared by the wavelengths of a packet, and weight every
+/// wavelength by its own probability of the outcome relative to the sampling
+/// probability. The choice is sampled with the mean probability of the
+/// packet, rather than the hero's, so an outcome that is possible for any
+/// wavelength is possible for the path. E.g. total internal reflection of the
+/// hero must not rule out refraction for the others. With a single wavelength,
+/// or once the path is dispersed, the choice is the hero's and the weights are
+/// unchanged.
+/// \param p The probability of the choice for each wavelength.
+/// \param sr Holds the weights, the hero and the random stream.
+/// \return Returns true if the choice was made.
+static bool choose(const std::vector<Scalar> & p, RandomScatterRecord & sr)
+{
+	if (sr.dispersed) {
+		return sr.random.uniform() < p[sr.hero];
+	}
+	Scalar q = 0;
+	for (Scalar pj : p) {
+		q += pj;
+	}
+	q /= p.size();
+	const bool chosen = sr.random.uniform() < q;
+	if (p.size() > 1) {
+		for (std::size_t j=0; j<p.size(); ++j) {
+			sr.weights[j] *= chosen ? p[j] / q : (1 - p[j]) / (1 - q);
+		}
+	}
+	return chosen;
+}
+
+/// Fresnel reflectance of an interface for every wavelength of a packet, each
+/// with its own complex refractive index.
+/// \param cosi Cosine of the angle of incidence.
+/// \param n1 The refractive index of the incoming side per wavelength.
+/// \param n2 The refractive index of the outgoing side per wavelength.
+/// \param[out] R The reflectance per wavelength.
+static void fresnel(Scalar cosi, const std::vector<Complex> & n1,
+					const std::vector<Complex> & n2, std::vector<Scalar> & R)
+{
+	for (std::size_t j=0; j<R.size(); ++j) {
+		R[j] = fresnel(cosi, n2[j] / n1[j]);
+	}
+}
+
+/// Refract a ray of a packet into the far side of an interface, along the
+/// hero's direction. If the real parts of the relative indices differ between
+/// the wavelengths, the interface bends them apart, so the path is dispersed:
+/// the other wavelengths end, and the hero's weight is multiplied by the size
+/// of the packet. Whether an interface disperses does not depend on the hero,
+/// and the hero rotates through the packet from ray to ray, so each
+/// wavelength still gets its expected weight from the rays it is the hero of.
+/// \param d The direction of the ray.
+/// \param N The normal of the interface, on the side the ray comes from.
+/// \param n1 The refractive index of the incoming side per wavelength.
+/// \param n2 The refractive index of the outgoing side per wavelength.
+/// \param sr Holds the weights and the hero.
+/// \param[out] t The refracted direction.
+/// \return Returns false if the hero is totally internally reflected.
+static bool transmit(const Vector3 & d, const Vector3 & N,
+					 const std::vector<Complex> & n1,
+					 const std::vector<Complex> & n2,
+					 RandomScatterRecord & sr, Vector3 & t)
+{
+	const std::size_t h = sr.hero;
+	const Scalar eta = n1[h].real() / n2[h].real();
+	if (!sr.dispersed) {
+		for (std::size_t j=0; j<n1.size(); ++j) {
+			if (n1[j].real() / n2[j].real() != eta) {
+				sr.dispersed = true;
+				break;
+			}
+		}
+		if (sr.dispersed) {
+			const Scalar w = sr.weights[h] * sr.weights.size();
+			std::fill(sr.weights.begin(), sr.weights.end(), Scalar(0));
+			sr.weights[h] = w;
+		}
+	}
+	return refract(d, N, eta, t);
+}
+
+/// Apply the absorption of a distance travelled to every wavelength.
+static void absorb(const std::vector<Scalar> & alpha, Scalar distance,
+				   RandomScatterRecord & sr)
+{
+	for (std::size_t j=0; j<alpha.size(); ++j) {
+		if (alpha[j] > 0) {
+			sr.weights[j] *= std::exp(-alpha[j] * distance);
+		}
+	}
+}
+
+/// Russian roulette on paths that carry little weight.
+/// \return Returns false if the path is terminated.
+static bool roulette(RandomScatterRecord & sr)
+{
+	const Scalar maxWeight =
+		*std::max_element(sr.weights.begin(), sr.weights.end());
+	if (maxWeight >= rouletteThreshold) {
+		return true;
+	}
+	const Scalar survival = maxWeight / rouletteThreshold;
+	if (!(maxWeight > 0) or sr.random.uniform() >= survival) {
+		return false;
+	}
+	for (Scalar & w : sr.weights) {
+		w /= survival;
+	}
+	return true;
+}
+
+/// Compute the complex refractive index and the absorption coefficient of a
+/// medium or particle at every wavelength of a sample.
+template <typename Def>
+static void opticalConstants(const Def & def, const SpectralSample & ss,
+							 std::vector<Complex> & n, std::vector<Scalar> & alpha)
+{
+	n.resize(ss.size());
+	alpha.resize(ss.size());
+	for (std::size_t j=0; j<ss.size(); ++j) {
+		const Scalar lambda = ss.wavelength(j);
+		n[j] = getComplexRefractiveIndex(def.n, def.k, lambda);
+		if (!(n[j].real() > 0)) {
+			throw std::runtime_error("The refractive index of " + def.name +
+				" is not positive at " + std::to_string(double(lambda)) +
+				" nm.");
+		}
+		// alpha = 4 pi k / lambda, with lambda converted to metres
+		alpha[j] = def.alpha ? def.alpha->evaluate(lambda)
+							 : 4 * M_PI * n[j].imag() / (lambda * 1e-9);
+	}
+}
+
+/// Scatter a ray through a particle. The ray strikes the particle at a random
+/// point, and is then reflected or refracted and absorbed until it leaves.
+/// \param particle The struck particle.
+/// \param[in,out] d The direction of the ray.
+/// \param nm The refractive index of the medium per wavelength.
+/// \param np The refractive index of the particle per wavelength.
+/// \param ap The absorption coefficient of the particle per wavelength.
+/// \param sr Holds the weights, the hero and the random stream.
+/// \param[out] R Receives reflectances, and must have an entry per wavelength.
+/// \return Returns false if the ray was trapped in the particle.
+static bool ParticleScatter(const IParticle & particle, Vector3 & d,
+	const std::vector<Complex> & nm, const std::vector<Complex> & np,
+	const std::vector<Scalar> & ap, RandomScatterRecord & sr,
+	std::vector<Scalar> & R)
+{
+	Point3 p;
+	Vector3 N;
+	particle.GetUniformRandomPoint(p, N, d, sr.random);
+	fresnel(-dot(d, N), nm, np, R);
+	Vector3 inside;
+	if (choose(R, sr) or !transmit(d, N, nm, np, sr, inside)) {
+		d = reflect(d, N);
+		return true;
+	}
+
+	for (int bounce=0; bounce<maxInternalReflections; ++bounce) {
+		Scalar t;
+		Point3 q;
+		Vector3 Nq;
+		if (!particle.GetExitPoint(Ray3(p, inside), t, q, Nq)) {
+			return false;
+		}
+		absorb(ap, t, sr);
+		fresnel(dot(inside, Nq), np, nm, R);
+		Vector3 out;
+		if (choose(R, sr) or !transmit(inside, -Nq, np, nm, sr, out)) {
+			inside = reflect(inside, Nq);
+			p = q;
+			continue;
+		}
+		d = out;
+		return true;
+	}
+	return false;
+}
+
+/// Get the arena of the particles generated on the calling thread. A path
+/// only needs the particle it is scattering through, so the arena is reset
+/// for every path, or after every event of a wavefront, and its memory is
+/// reused.
+/// \return Returns the arena of the calling thread.
+static ParticleArena & particleArena()
+{
+	static thread_local ParticleArena arena;
+	return arena;
+}
+
+namespace {
+
+/// The buffers of the wavelengths of a packet that scattering needs, which
+/// are kept per thread like the particle arena, so that a ray allocates
+/// nothing once they have grown to the size of its packet.
+struct Scratch
+{
+	std::vector<Scalar> R;			///< Reflectance per wavelength
+	std::vector<Complex> vacuum;	///< Refractive index of vacuum
+	std::vector<Scalar> clear;		///< Absorption coefficient of vacuum
+	/// Refractive index and absorption coefficient of each medium and
+	/// particle type. They are empty until they are computed, and may have
+	/// more entries than there are media or particle types.
+	std::vector<std::vector<Complex>> nm, np;
+	std::vector<std::vector<Scalar>> am, ap;
+
+	/// Size the buffers for a packet, and forget the optical constants.
+	/// \param L The number of wavelengths.
+	/// \param media The number of media.
+	/// \param particles The number of particle types.
+	void reset(std::size_t L, std::size_t media, std::size_t particles)
+	{
+		R.resize(L);
+		vacuum.assign(L, Complex(1, 0));
+		clear.assign(L, 0);
+		// Never shrink, so that inner buffers keep their memory
+		nm.resize(std::max(nm.size(), media));
+		am.resize(std::max(am.size(), media));
+		np.resize(std::max(np.size(), particles));
+		ap.resize(std::max(ap.size(), particles));
+		for (std::size_t id=0; id<media; ++id) {
+			nm[id].clear();
+			am[id].clear();
+		}
+		for (std::size_t id=0; id<particles; ++id) {
+			np[id].clear();
+			ap[id].clear();
+		}
+	}
+};
+
+} // namespace
+
+/// Get the scratch buffers of the calling thread.
+/// \return Returns the buffers, which each call to scatter resets.
+static Scratch & scratch()
+{
+	static thread_local Scratch buffers;
+	return buffers;
+}
+
 Test1Material::Test1Material()
- : _particles()
+ : _particles(), _depth(0), _isMirror(true), _hasLowerReflector(false),
+   _wavefront(true)
+{
+}
+
+int Test1Material::pickMedium(RandomStream & random) const
+{
+	if (_mediumTable.empty()) {
+		return -1;
+	}
+	return _mediumTable.sample(random.uniform());
+}
+
+int Test1Material::pickParticle(RandomStream & random) const
 {
+	if (_particleTable.empty()) {
+		return -1;
+	}
+	return _particleTable.sample(random.uniform());
+}
+
+int Test1Material::opticsIndex(const SpectralSample & ss) const
+{
+	// The table is dropped when the media or particles change.
+	const int first = ss.preparedIndex();
+	if (first < 0 or first + ss.size() > _opticsLambdas.size()) {
+		return -1;
+	}
+	for (std::size_t j=0; j<ss.size(); ++j) {
+		assert(_opticsLambdas[first + j] == ss.wavelength(j));
+	}
+	return first;
+}
+
+void Test1Material::optics(std::size_t id, int first,
+	const SpectralSample & ss, std::vector<Complex> & n,
+	std::vector<Scalar> & alpha) const
+{
+	if (first < 0) {
+		if (id < _media.size()) {
+			opticalConstants(_media[id], ss, n, alpha);
+		} else {
+			opticalConstants(_particles[id - _media.size()], ss, n, alpha);
+		}
+		return;
+	}
+	const std::size_t row = id * _opticsLambdas.size() + first;
+	n.assign(_opticsN.begin() + row, _opticsN.begin() + row + ss.size());
+	alpha.assign(_opticsAlpha.begin() + row,
+				 _opticsAlpha.begin() + row + ss.size());
+}
+
+void Test1Material::prepare(const std::vector<Scalar> & lambdas)
+{
+	_opticsLambdas.clear();
+	_opticsN.clear();
+	_opticsAlpha.clear();
+
+	SpectralSample all;
+	for (Scalar lambda : lambdas) {
+		all.add(lambda, 1);
+	}
+	std::vector<Complex> n;
+	std::vector<Scalar> alpha;
+	std::vector<Complex> tableN;
+	std::vector<Scalar> tableAlpha;
+	for (std::size_t id=0; id<_media.size() + _particles.size(); ++id) {
+		optics(id, -1, all, n, alpha);
+		tableN.insert(tableN.end(), n.begin(), n.end());
+		tableAlpha.insert(tableAlpha.end(), alpha.begin(), alpha.end());
+	}
+	_opticsN = std::move(tableN);
+	_opticsAlpha = std::move(tableAlpha);
+	_opticsLambdas = lambdas;
+}
+
+void Test1Material::fingerprint(ContentHash & hash) const
+{
+	hash.addString("Test1Material");
+	hash.addScalar(_depth).addInteger(_isMirror).addInteger(_hasLowerReflector);
+	hash.addInteger(_media.size());
+	for (const MediumDef & m : _media) {
+		hash.addScalar(m.weight);
+		nix::fingerprint(hash, m.n);
+		nix::fingerprint(hash, m.k);
+		nix::fingerprint(hash, m.alpha);
+	}
+	hash.addInteger(_particles.size());
+	for (const ParticleDef & p : _particles) {
+		nix::fingerprint(hash, p.n);
+		nix::fingerprint(hash, p.k);
+		nix::fingerprint(hash, p.alpha);
+		hash.addScalar(p.roundness_mean).addScalar(p.roundness_var);
+		hash.addScalar(p.roundness_range.Min());
+		hash.addScalar(p.roundness_range.Max());
+		hash.addScalar(p.concentration).addScalar(p.meanDistance);
+		hash.addInteger(p.generator != nullptr);
+		if (p.generator) {
+			p.generator->fingerprint(hash);
+		}
+	}
 }
 
 void Test1Material::setMediaTypes(const std::vector<MediumDef> & media)
 {
+	_opticsLambdas.clear();
+	std::vector<Scalar> weights;
+	for (const MediumDef & m : media) {
+		weights.push_back(m.weight);
+	}
+	_mediumTable = AliasTable(weights);
 	_media = media;
 }
 
+void Test1Material::setParticles(const std::vector<ParticleDef> & particles)
+{
+	_opticsLambdas.clear();
+	std::vector<Scalar> concentrations;
+	std::vector<bool> spheroidTypes;
+	for (const ParticleDef & p : particles) {
+		concentrations.push_back(p.concentration);
+		spheroidTypes.push_back(p.generator and
+								p.generator->generatesSpheroids());
+	}
+	_particleTable = AliasTable(concentrations);
+	_spheroidTypes = std::move(spheroidTypes);
+	_particles = particles;
+}
+
 const std::vector<Test1Material::MediumDef> &
 Test1Material::mediaTypes() const noexcept
 {
@@ -35,10 +437,404 @@ Test1Material::mediaTypes() const noexcept
 }
 
 const RayResult
-Test1Material::Scatter(const Intersection & /*x*/, const SpectralSample & /*ss*/,
-	const IMedium & /*ambient*/, RandomScatterRecord & /*sr*/) const
+Test1Material::Scatter(const Intersection & x, const SpectralSample & ss,
+	const IMedium & /*ambient*/, RandomScatterRecord & sr) const
 {
-	return RayResult(Interaction::reflected);
+	const std::size_t L = ss.size();
+	if (L == 0) {
+		return RayResult(Interaction::absorbed);
+	}
+	if (sr.weights.size() != L) {
+		sr.weights.assign(L, 1);
+	}
+	if (sr.hero >= L) {
+		sr.hero = 0;
+	}
+	const Vector3 up = Vector3::ZAxis;
+	const Scalar top = x.p.z;
+	const Scalar bottom = top - _depth;
+	Scratch & buffers = scratch();
+	buffers.reset(L, 1, _particles.size());
+	std::vector<Scalar> & R = buffers.R;
+
+	// Optical constants of the pore space medium. Vacuum if there is none.
+	const std::vector<Complex> & vacuum = buffers.vacuum;
+	std::vector<Complex> & nm = buffers.nm[0];
+	std::vector<Scalar> & am = buffers.am[0];
+	nm = vacuum;
+	am = buffers.clear;
+
+	// Optical constants of each particle type, computed when first struck
+	std::vector<std::vector<Complex>> & np = buffers.np;
+	std::vector<std::vector<Scalar>> & ap = buffers.ap;
+	const int first = opticsIndex(ss);
+	const int medium = pickMedium(sr.random);
+	if (medium >= 0) {
+		optics(medium, first, ss, nm, am);
+	}
+
+	Point3 pos = x.p;
+	Vector3 d = x.ray.d.normalized();
+	ParticleArena & arena = particleArena();
+	arena.reset();
+
+	// Enter the sample
+	if (_isMirror) {
+		fresnel(-d.z, vacuum, nm, R);
+		Vector3 t;
+		if (choose(R, sr) or !transmit(d, up, vacuum, nm, sr, t)) {
+			sr.exit = Ray3(pos, reflect(d, up));
+			return RayResult(Interaction::reflected);
+		}
+		d = t;
+	}
+
+	for (int event=0; event<maxEvents; ++event) {
+		++sr.events;
+		// Distance to the surface or the bottom of the sample
+		Scalar boundary = std::numeric_limits<Scalar>::infinity();
+		if (d.z > 0) {
+			boundary = (top - pos.z) / d.z;
+		} else if (d.z < 0 and _depth > 0) {
+			boundary = (bottom - pos.z) / d.z;
+		}
+
+		// Distance to the next particle
+		const int type = pickParticle(sr.random);
+		Scalar flight = std::numeric_limits<Scalar>::infinity();
+		if (type >= 0 and _particles[type].meanDistance > 0) {
+			flight = -_particles[type].meanDistance *
+				std::log(1 - sr.random.uniform());
+		}
+
+		if (flight >= boundary) {
+			absorb(am, boundary, sr);
+			pos = pos + d * boundary;
+			if (d.z > 0) {
+				if (_isMirror) {
+					// Leave through the interface, or reflect back in
+					fresnel(d.z, nm, vacuum, R);
+					Vector3 t;
+					if (choose(R, sr) or
+						!transmit(d, -up, nm, vacuum, sr, t)) {
+						d = reflect(d, up);
+						continue;
+					}
+					d = t;
+				}
+				sr.exit = Ray3(pos, d);
+				return RayResult(Interaction::reflected);
+			}
+			if (_hasLowerReflector) {
+				d = reflect(d, up);
+				continue;
+			}
+			sr.exit = Ray3(pos, d);
+			return RayResult(Interaction::transmitted);
+		}
+		if (std::isinf(flight)) {
+			// Travelling parallel to an infinite sample without particles
+			break;
+		}
+
+		absorb(am, flight, sr);
+		pos = pos + d * flight;
+
+		const ParticleDef & def = _particles[type];
+		if (!def.generator) {
+			continue;
+		}
+		const IParticle * particle = def.generator->generate(sr.random, arena);
+		++sr.particles;
+		if (!particle or !(particle->diameter() > 0)) {
+			continue;
+		}
+		if (np[type].empty()) {
+			optics(_media.size() + type, first, ss, np[type], ap[type]);
+		}
+		if (!ParticleScatter(*particle, d, nm, np[type], ap[type], sr, R) or
+			!roulette(sr)) {
+			break;
+		}
+	}
+	return RayResult(Interaction::absorbed);
+}
+
+void Test1Material::ScatterBatch(const Intersection & x,
+	const SpectralSample & ss, const IMedium & ambient,
+	RandomScatterRecord * records, Interaction * results, int count) const
+{
+	const std::size_t L = ss.size();
+	if (!_wavefront or L == 0) {
+		ISpecimen::ScatterBatch(x, ss, ambient, records, results, count);
+		return;
+	}
+	const Vector3 up = Vector3::ZAxis;
+	const Scalar top = x.p.z;
+	const Scalar bottom = top - _depth;
+	Scratch & buffers = scratch();
+	buffers.reset(L, _media.size(), _particles.size());
+	std::vector<Scalar> & R = buffers.R;
+
+	// Optical constants of each medium and particle type, computed when first
+	// needed by any ray of the batch. Vacuum if there is no medium.
+	const std::vector<Complex> & vacuum = buffers.vacuum;
+	const std::vector<Scalar> & clear = buffers.clear;
+	std::vector<std::vector<Complex>> & nm = buffers.nm;
+	std::vector<std::vector<Scalar>> & am = buffers.am;
+	std::vector<std::vector<Complex>> & np = buffers.np;
+	std::vector<std::vector<Scalar>> & ap = buffers.ap;
+	const int first = opticsIndex(ss);
+
+	// The state of every ray, indexed by its position in the batch
+	std::vector<Point3> pos(count, x.p);
+	std::vector<Vector3> dir(count, x.ray.d.normalized());
+	std::vector<int> medium(count), type(count), events(count, 0);
+	std::vector<Scalar> step(count);
+	std::vector<const IParticle *> particles(count);
+	std::vector<const SpheroidParticle *> spheroids(count);
+	ParticleArena & arena = particleArena();
+
+	// The state of the rays inside particles: the point they start from, the
+	// direction they travel in and the internal reflections so far
+	std::vector<Point3> innerPos(count);
+	std::vector<Vector3> innerDir(count);
+	std::vector<int> bounces(count);
+
+	// The exits of the rays inside particles, indexed by their position in
+	// inside, and the rays in spheroids gathered for GetExitPoints()
+	std::vector<Scalar> exitT(count), spheroidT(count);
+	std::vector<Point3> exitP(count), spheroidP(count);
+	std::vector<Vector3> exitN(count), spheroidN(count);
+	std::unique_ptr<bool[]> exits(new bool[count]);
+	std::unique_ptr<bool[]> spheroidExits(new bool[count]);
+	std::vector<const SpheroidParticle *> spheroidShapes;
+	std::vector<Ray3> spheroidRays;
+	std::vector<int> spheroidSlots;
+	spheroidShapes.reserve(count);
+	spheroidRays.reserve(count);
+	spheroidSlots.reserve(count);
+
+	// The rays still in the sample, and those at each stage of an event
+	std::vector<int> active, boundaries, strikes, inside, next;
+	active.reserve(count);
+	boundaries.reserve(count);
+	strikes.reserve(count);
+	inside.reserve(count);
+	next.reserve(count);
+
+	// Choose the medium and enter the sample
+	for (int i=0; i<count; ++i) {
+		RandomScatterRecord & sr = records[i];
+		results[i] = Interaction::absorbed;
+		if (sr.weights.size() != L) {
+			sr.weights.assign(L, 1);
+		}
+		if (sr.hero >= L) {
+			sr.hero = 0;
+		}
+		medium[i] = pickMedium(sr.random);
+		if (medium[i] >= 0 and nm[medium[i]].empty()) {
+			optics(medium[i], first, ss, nm[medium[i]], am[medium[i]]);
+		}
+		if (_isMirror) {
+			const std::vector<Complex> & n = medium[i] >= 0 ? nm[medium[i]]
+															 : vacuum;
+			const Vector3 & d = dir[i];
+			fresnel(-d.z, vacuum, n, R);
+			Vector3 t;
+			if (choose(R, sr) or !transmit(d, up, vacuum, n, sr, t)) {
+				sr.exit = Ray3(pos[i], reflect(d, up));
+				results[i] = Interaction::reflected;
+				continue;
+			}
+			dir[i] = t;
+		}
+		active.push_back(i);
+	}
+
+	while (!active.empty()) {
+		// Fly every ray to the boundary or to its next particle
+		boundaries.clear();
+		strikes.clear();
+		for (int i : active) {
+			if (events[i] == maxEvents) {
+				continue;
+			}
+			++events[i];
+			RandomScatterRecord & sr = records[i];
+			++sr.events;
+			const Vector3 & d = dir[i];
+			Scalar boundary = std::numeric_limits<Scalar>::infinity();
+			if (d.z > 0) {
+				boundary = (top - pos[i].z) / d.z;
+			} else if (d.z < 0 and _depth > 0) {
+				boundary = (bottom - pos[i].z) / d.z;
+			}
+
+			type[i] = pickParticle(sr.random);
+			Scalar flight = std::numeric_limits<Scalar>::infinity();
+			if (type[i] >= 0 and _particles[type[i]].meanDistance > 0) {
+				flight = -_particles[type[i]].meanDistance *
+					std::log(1 - sr.random.uniform());
+			}
+
+			if (flight >= boundary) {
+				step[i] = boundary;
+				boundaries.push_back(i);
+			} else if (!std::isinf(flight)) {
+				step[i] = flight;
+				strikes.push_back(i);
+			}
+		}
+
+		// Leave the sample, or reflect back into it
+		next.clear();
+		for (int i : boundaries) {
+			RandomScatterRecord & sr = records[i];
+			const std::vector<Complex> & n = medium[i] >= 0 ? nm[medium[i]]
+															 : vacuum;
+			Vector3 & d = dir[i];
+			absorb(medium[i] >= 0 ? am[medium[i]] : clear, step[i], sr);
+			pos[i] = pos[i] + d * step[i];
+			if (d.z > 0) {
+				if (_isMirror) {
+					fresnel(d.z, n, vacuum, R);
+					Vector3 t;
+					if (choose(R, sr) or
+						!transmit(d, -up, n, vacuum, sr, t)) {
+						d = reflect(d, up);
+						next.push_back(i);
+						continue;
+					}
+					d = t;
+				}
+				sr.exit = Ray3(pos[i], d);
+				results[i] = Interaction::reflected;
+			} else if (_hasLowerReflector) {
+				d = reflect(d, up);
+				next.push_back(i);
+			} else {
+				sr.exit = Ray3(pos[i], d);
+				results[i] = Interaction::transmitted;
+			}
+		}
+
+		// Generate the struck particles, keeping the rays that strike one
+		std::size_t struck = 0;
+		for (int i : strikes) {
+			RandomScatterRecord & sr = records[i];
+			absorb(medium[i] >= 0 ? am[medium[i]] : clear, step[i], sr);
+			pos[i] = pos[i] + dir[i] * step[i];
+			const ParticleDef & def = _particles[type[i]];
+			if (!def.generator) {
+				next.push_back(i);
+				continue;
+			}
+			particles[i] = def.generator->generate(sr.random, arena);
+			++sr.particles;
+			if (!particles[i] or !(particles[i]->diameter() > 0)) {
+				next.push_back(i);
+				continue;
+			}
+			spheroids[i] = _spheroidTypes[type[i]] ?
+				static_cast<const SpheroidParticle *>(particles[i]) : nullptr;
+			strikes[struck++] = i;
+		}
+		strikes.resize(struck);
+
+		// Reflect off the particles, or enter them, as in ParticleScatter()
+		inside.clear();
+		for (int i : strikes) {
+			RandomScatterRecord & sr = records[i];
+			if (np[type[i]].empty()) {
+				optics(_media.size() + type[i], first, ss, np[type[i]],
+					   ap[type[i]]);
+			}
+			const std::vector<Complex> & n = medium[i] >= 0 ? nm[medium[i]]
+															 : vacuum;
+			Vector3 & d = dir[i];
+			Vector3 N;
+			particles[i]->GetUniformRandomPoint(innerPos[i], N, d, sr.random);
+			fresnel(-dot(d, N), n, np[type[i]], R);
+			if (choose(R, sr) or
+				!transmit(d, N, n, np[type[i]], sr, innerDir[i])) {
+				d = reflect(d, N);
+				if (roulette(sr)) {
+					next.push_back(i);
+				}
+				continue;
+			}
+			bounces[i] = 0;
+			if (maxInternalReflections > 0) {
+				inside.push_back(i);
+			}
+		}
+
+		// Bounce the rays inside the particles in step until they leave
+		while (!inside.empty()) {
+			spheroidShapes.clear();
+			spheroidRays.clear();
+			spheroidSlots.clear();
+			for (std::size_t k=0; k<inside.size(); ++k) {
+				const int i = inside[k];
+				const Ray3 ray(innerPos[i], innerDir[i]);
+				if (spheroids[i]) {
+					spheroidShapes.push_back(spheroids[i]);
+					spheroidRays.push_back(ray);
+					spheroidSlots.push_back(k);
+				} else {
+					exits[k] = particles[i]->GetExitPoint(ray, exitT[k],
+														  exitP[k], exitN[k]);
+				}
+			}
+			SpheroidParticle::GetExitPoints(spheroidShapes.data(),
+				spheroidRays.data(), spheroidRays.size(), spheroidT.data(),
+				spheroidP.data(), spheroidN.data(), spheroidExits.get());
+			for (std::size_t j=0; j<spheroidSlots.size(); ++j) {
+				const int k = spheroidSlots[j];
+				exits[k] = spheroidExits[j];
+				exitT[k] = spheroidT[j];
+				exitP[k] = spheroidP[j];
+				exitN[k] = spheroidN[j];
+			}
+
+			// Leave the particles, or reflect inside them. Rays that find no
+			// exit or reflect too often are trapped.
+			std::size_t kept = 0;
+			for (std::size_t k=0; k<inside.size(); ++k) {
+				const int i = inside[k];
+				if (!exits[k]) {
+					continue;
+				}
+				RandomScatterRecord & sr = records[i];
+				const std::vector<Complex> & n = medium[i] >= 0 ?
+					nm[medium[i]] : vacuum;
+				const std::vector<Complex> & nq = np[type[i]];
+				const Vector3 & Nq = exitN[k];
+				Vector3 & d = innerDir[i];
+				absorb(ap[type[i]], exitT[k], sr);
+				fresnel(dot(d, Nq), nq, n, R);
+				Vector3 out;
+				if (choose(R, sr) or !transmit(d, -Nq, nq, n, sr, out)) {
+					d = reflect(d, Nq);
+					innerPos[i] = exitP[k];
+					if (++bounces[i] < maxInternalReflections) {
+						inside[kept++] = i;
+					}
+					continue;
+				}
+				dir[i] = out;
+				if (roulette(sr)) {
+					next.push_back(i);
+				}
+			}
+			inside.resize(kept);
+		}
+		arena.reset();
+
+		active.swap(next);
+	}
 }
 
 std::string & Test1Material::name() const
@@ -47,17 +843,24 @@ std::string & Test1Material::name() const
 	return name;
 }
 
-void Test1Material::setMirrorInterface(bool /*isMirror*/)
+void Test1Material::setMirrorInterface(bool isMirror)
 {
+	_isMirror = isMirror;
 }
 
 bool Test1Material::isMirrorInterface()
 {
-	return false;
+	return _isMirror;
+}
+
+void Test1Material::setWavefront(bool wavefront) noexcept
+{
+	_wavefront = wavefront;
 }
 
-void Test1Material::setLowerReflector(bool /*hasLowerReflector*/)
+void Test1Material::setLowerReflector(bool hasLowerReflector)
 {
+	_hasLowerReflector = hasLowerReflector;
 }
 
 } // namespace nix
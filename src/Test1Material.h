@@ -4,6 +4,7 @@
  ***************************************************************************/
 #pragma once
 
+#include <AliasTable.h>
 #include <Interval.h>
 #include <ISpecimen.h>
 #include <Scalar.h>
@@ -20,6 +21,7 @@ class IProperty;
 class PiecewiseLinearSpectrum;
 class Point3;
 class RandomScatterRecord;
+class RandomStream;
 class Ray3;
 class RayResult;
 class Sphere;
@@ -129,11 +131,27 @@ class Test1Material : virtual public ISpecimen
 	/// particles.  It makes use of the ParticleScatter() method to compute
 	/// the scatting though the grains.
 	///
+	/// The sample is a slab below the plane of the intersection point, whose
+	/// pore space is filled by one medium, chosen per path by weight. The ray
+	/// flies through the medium for exponentially distributed distances
+	/// between particles of a type chosen by concentration. At every
+	/// interface, the Fresnel equations with the complex refractive index
+	/// decide between reflection and refraction, and both media and particles
+	/// absorb along the path.
+	///
+	/// All the wavelengths of \p ss share the path. Its geometry follows the
+	/// hero wavelength of \p sr, the Fresnel choices are sampled with the
+	/// mean probability of the packet, and the weight of every wavelength in
+	/// \p sr is scaled by its own Fresnel probabilities, with its own complex
+	/// refractive index, and by its own absorption. A refraction that bends
+	/// the wavelengths apart disperses the path, and only the hero carries
+	/// on from it.
+	///
 	/// @param x The Intersection object contains the Ray3, distance along the
 	///          ray and the intersection Point3 on the sample.
-	/// @param ss Assumed to have exactly one wavelength. If 0, `true` is
-	///           returned; if > 0, `false` is returned.
-	/// @param ambient The medium surrounding the sample.
+	/// @param ss The wavelengths to carry along the path.
+	/// @param ambient The medium surrounding the sample, which is taken to
+	///          have a refractive index of one.
 	/// @param[out] sr The resulting scatter record.
 	///
 	/// @return Returns a RayResult instance that provides detailed information
@@ -141,21 +159,62 @@ class Test1Material : virtual public ISpecimen
 	const RayResult Scatter(const Intersection& x, const SpectralSample& ss,
 		const IMedium& ambient, RandomScatterRecord & sr) const override;
 
+	/// Scatter a batch of rays as a wavefront. Rather than following one ray
+	/// from entry to exit, every ray in the sample advances by one event at
+	/// a time, in stages: a free flight to the boundary or to a particle,
+	/// the Fresnel decisions of the rays at the boundary, the generation of
+	/// the struck particles, and the scattering through them. Rays that
+	/// leave or are absorbed are compacted out between events. The optical
+	/// constants of the media and particles are computed once per batch.
+	/// Rays that enter particles bounce inside them in step, and the exits
+	/// of those in spheroids, i.e. of types whose generator
+	/// generatesSpheroids(), are found together by
+	/// SpheroidParticle::GetExitPoints().
+	///
+	/// Each ray draws from its own random stream in the same order as in
+	/// Scatter(), so its outcome is identical. If the wavefront is disabled
+	/// with setWavefront(), the rays are traced one at a time.
+	/// \copydetails ISpecimen::ScatterBatch()
+	void ScatterBatch(const Intersection & x, const SpectralSample & ss,
+					  const IMedium & ambient, RandomScatterRecord * records,
+					  Interaction * results, int count) const override;
+
+	/// Evaluate the complex refractive index and the absorption coefficient
+	/// of every medium and particle type at every wavelength of a job, into
+	/// a flat table indexed by material and wavelength. Packets of
+	/// consecutive wavelengths of the job, which carry their index in
+	/// \p lambdas as their SpectralSample::preparedIndex(), then read their
+	/// optical constants from the table; others still evaluate the spectra.
+	/// \param lambdas The wavelengths of the job, in nanometres.
+	/// \throws Throws std::runtime_error if a refractive index is not
+	///         positive at one of the wavelengths.
+	void prepare(const std::vector<Scalar> & lambdas) override;
+
+	/// Add the depth, the interfaces, and the weights, spectra and particle
+	/// generators of the media and particle types to a hash. Whether the
+	/// rays are traced as a wavefront is left out, since it doesn't change
+	/// their outcomes.
+	/// \copydetails ISpecimen::fingerprint()
+	void fingerprint(ContentHash & hash) const override;
+
 	/// Default virtual destructor. No resources to free.
 	virtual ~Test1Material() = default;
 
 	/// Set the depth (thickness) of the sample in metres.
 	/// \param depth The depth is assumed to be a positive value.
-	void setDepth(Scalar /*depth*/) noexcept { }
+	void setDepth(Scalar depth) noexcept { _depth = depth; }
 
-	/// Get the depth (thickness) of the sample in metres.
+	/// Get the depth (thickness) of the sample in metres. A depth of zero is
+	/// an infinitely deep sample.
 	/// \return depth The depth should be a positive value.
-	Scalar getDepth() const noexcept { return 0.0; }
+	Scalar getDepth() const noexcept { return _depth; }
 
 	/// Set the types of media that exist between the particles, and their
-	/// respective fractional quantities. An std::runtime_error is thrown
-	/// if the quantities do not add up to something close to 1.0.
+	/// respective fractional quantities. The quantities are relative, and
+	/// an alias table is built from them to choose the medium of each path.
 	/// \param media There should be at least one media type defined.
+	/// \throws Throws std::runtime_error if a weight is negative, or if
+	///         they sum to zero.
 	void setMediaTypes(const std::vector<MediumDef> & media);
 
 	/// Provide access to the media types for debugging output, etc..
@@ -163,10 +222,13 @@ class Test1Material : virtual public ISpecimen
 	const std::vector<MediumDef> & mediaTypes() const noexcept;
 
 	/// Set the particle types that exist between the particles, and their
-	/// respective fractional quantities.
+	/// respective fractional quantities. The concentrations are relative,
+	/// and an alias table is built from them to choose the type of each
+	/// struck particle.
 	/// \param particles There should be at least one particle type defined.
-	void setParticles(const std::vector<ParticleDef> & particles)
-		{ _particles = particles; }
+	/// \throws Throws std::runtime_error if a concentration is negative, or
+	///         if they sum to zero.
+	void setParticles(const std::vector<ParticleDef> & particles);
 
 	/// Provide access to the particle types for debugging output, etc..
 	/// \return Returns a vector of ParticleDef objects.
@@ -195,9 +257,65 @@ class Test1Material : virtual public ISpecimen
 	/// Returns the state of the Fresenel ambient/material boundary interface.
 	/// @return Returns `true` if set, `false` otherwise.
 	bool isMirrorInterface();
+
+	/// Trace batches of rays as a wavefront in ScatterBatch(), which is the
+	/// default, or one at a time.
+	/// @param wavefront Set to false to trace the rays one at a time.
+	void setWavefront(bool wavefront) noexcept;
+
+	/// Are batches of rays traced as a wavefront?
+	/// @return Returns `true` if they are.
+	bool wavefront() const noexcept { return _wavefront; }
   private:
+	/// Choose the medium of the pore space by weight, with one random number
+	/// in constant time.
+	/// \param random The random numbers of the ray being traced.
+	/// \return Returns an index into _media, or -1 if there are no media.
+	int pickMedium(RandomStream & random) const;
+
+	/// Choose the type of the next particle by concentration, with one random
+	/// number in constant time.
+	/// \param random The random numbers of the ray being traced.
+	/// \return Returns an index into _particles, or -1 if there are none.
+	int pickParticle(RandomStream & random) const;
+
+	/// Locate a sample in the table of optical constants, by the index that
+	/// the caller recorded in it, in constant time.
+	/// \param ss The wavelengths being traced.
+	/// \return Returns the index in the table of the first wavelength of
+	///         \p ss, if it has a SpectralSample::preparedIndex() and the
+	///         table is current, or -1 if not.
+	int opticsIndex(const SpectralSample & ss) const;
+
+	/// Get the optical constants of a medium or particle type.
+	/// \param id The index of a medium, or the number of media plus the
+	///        index of a particle type.
+	/// \param first The result of opticsIndex(), or -1 to evaluate the
+	///        spectra.
+	/// \param ss The wavelengths being traced.
+	/// \param[out] n The complex refractive index per wavelength.
+	/// \param[out] alpha The absorption coefficient per wavelength.
+	void optics(std::size_t id, int first, const SpectralSample & ss,
+				std::vector<std::complex<Scalar>> & n,
+				std::vector<Scalar> & alpha) const;
+
 	std::vector<MediumDef> _media;
 	std::vector<ParticleDef> _particles;
+	AliasTable _mediumTable;	///< Samples _media by weight.
+	AliasTable _particleTable;	///< Samples _particles by concentration.
+	/// Whether the generator of each particle type makes SpheroidParticles.
+	std::vector<bool> _spheroidTypes;
+	Scalar _depth;				///< Depth of the sample, or 0 for infinite.
+	bool _isMirror;				///< Fresnel interface at the surface.
+	bool _hasLowerReflector;	///< Perfect mirror below the sample.
+	bool _wavefront;			///< Trace batches as a wavefront.
+
+	/// The wavelengths of the table of optical constants.
+	std::vector<Scalar> _opticsLambdas;
+	/// Refractive index by material, then wavelength.
+	std::vector<std::complex<Scalar>> _opticsN;
+	/// Absorption coefficient by material, then wavelength.
+	std::vector<Scalar> _opticsAlpha;
   public:
 
 	/// Set a flag that indicates whether or not the material has a perfect
@@ -0,0 +1,142 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "Tracer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+
+namespace nix {
+
+Tracer::Tracer()
+  : _numSlots(0), _capacity(0), _start(Clock::now())
+{
+}
+
+void Tracer::reset(unsigned numSlots, std::size_t capacity)
+{
+	_slots.reset(capacity > 0 ? new Slot[numSlots] : nullptr);
+	_numSlots = capacity > 0 ? numSlots : 0;
+	_capacity = capacity;
+	for (unsigned s=0; s<_numSlots; ++s) {
+		_slots[s].records.reset(new Record[_capacity]);
+		_slots[s].recorded = 0;
+	}
+	_start = Clock::now();
+}
+
+void Tracer::record(unsigned slot, Span span, Clock::time_point begin,
+					Clock::time_point end, int cell, int rays) noexcept
+{
+	if (slot >= _numSlots) {
+		return;
+	}
+	// Only the thread of the slot writes to it, so the index needs no
+	// read-modify-write. The release store publishes the span to write().
+	Slot & s = _slots[slot];
+	const std::size_t n = s.recorded.load(std::memory_order_relaxed);
+	Record & r = s.records[n % _capacity];
+	r.begin = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		begin - _start).count();
+	r.end = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		end - _start).count();
+	r.span = span;
+	r.cell = cell;
+	r.rays = rays;
+	s.recorded.store(n + 1, std::memory_order_release);
+}
+
+std::size_t Tracer::dropped() const noexcept
+{
+	std::size_t sum = 0;
+	for (unsigned s=0; s<_numSlots; ++s) {
+		const std::size_t n = _slots[s].recorded.load(
+			std::memory_order_acquire);
+		sum += n > _capacity ? n - _capacity : 0;
+	}
+	return sum;
+}
+
+void Tracer::write(std::ostream & os) const
+{
+	// Chrome traces are in microseconds
+	auto micros = [](std::int64_t ns) { return ns / 1000.0; };
+	const std::ios::fmtflags flags = os.flags();
+	os.setf(std::ios::fixed, std::ios::floatfield);
+	const std::streamsize precision = os.precision(3);
+
+	os << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":"
+	   << dropped() << "},\"traceEvents\":[\n";
+	bool first = true;
+	auto separate = [&]() {
+		os << (first ? "" : ",\n");
+		first = false;
+	};
+	for (unsigned s=0; s<_numSlots; ++s) {
+		separate();
+		os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << s
+		   << ",\"args\":{\"name\":\"thread " << s << "\"}}";
+
+		const std::size_t n = _slots[s].recorded.load(
+			std::memory_order_acquire);
+		const std::size_t kept = std::min(n, _capacity);
+		for (std::size_t k=n-kept; k<n; ++k) {
+			const Record & r = _slots[s].records[k % _capacity];
+			const char * const name = Tracer::name(r.span);
+			separate();
+			if (r.span == Span::cell) {
+				// Cells begin and end on different threads, and overlap on
+				// one, so they are async events with their own tracks.
+				os << "{\"name\":\"" << name << "\",\"cat\":\"" << name
+				   << "\",\"ph\":\"b\",\"id\":" << r.cell
+				   << ",\"pid\":1,\"tid\":" << s << ",\"ts\":"
+				   << micros(r.begin) << ",\"args\":{\"cell\":" << r.cell
+				   << "}},\n"
+				   << "{\"name\":\"" << name << "\",\"cat\":\"" << name
+				   << "\",\"ph\":\"e\",\"id\":" << r.cell
+				   << ",\"pid\":1,\"tid\":" << s << ",\"ts\":"
+				   << micros(r.end) << "}";
+				continue;
+			}
+			os << "{\"name\":\"" << name << "\",\"cat\":\"" << name
+			   << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << s << ",\"ts\":"
+			   << micros(r.begin) << ",\"dur\":" << micros(r.end - r.begin);
+			if (r.cell >= 0) {
+				os << ",\"args\":{\"cell\":" << r.cell << ",\"rays\":"
+				   << r.rays << "}";
+			}
+			os << "}";
+		}
+	}
+	os << "\n]}\n";
+	os.precision(precision);
+	os.flags(flags);
+	os.flush();
+}
+
+void Tracer::write(const std::string & fname) const
+{
+	std::ofstream os(fname);
+	write(os);
+	if (!os) {
+		throw std::runtime_error("Unable to write the trace file " + fname +
+			".");
+	}
+}
+
+const char * Tracer::name(Span span) noexcept
+{
+	switch (span) {
+	case Span::task:		return "task";
+	case Span::cell:		return "cell";
+	case Span::merge:		return "merge";
+	case Span::write:		return "write";
+	case Span::checkpoint:	return "checkpoint";
+	default:				return "";
+	}
+}
+
+} // namespace nix
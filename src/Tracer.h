@@ -0,0 +1,160 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+namespace nix {
+
+/// A timeline of the execution of a PhotometerJob, kept per worker thread.
+///
+/// Each thread records spans, e.g. the tasks it runs or the merges of the
+/// collector shards, into a ring buffer in its own slot. A buffer has a
+/// single writer, so recording takes no lock and no atomic read-modify-write.
+/// When a buffer is full, the oldest spans are overwritten and counted as
+/// dropped. The timeline is written as a Chrome trace, which can be opened
+/// in chrome://tracing or in Perfetto to see scheduling gaps, stragglers and
+/// stalls.
+///
+/// Tracing is off until reset() is called with a positive capacity. While it
+/// is off, TraceScope neither reads the clock nor records anything.
+class Tracer
+{
+  public:
+	/// The kinds of spans that are recorded.
+	enum class Span : unsigned {
+		task,				///< A task of rays run by a worker.
+		cell,				///< A measurement cell, from its first task
+							///< being queued to its completion.
+		merge,				///< Merging the collector shards of a round.
+		write,				///< Writing completed cells to the output.
+		checkpoint,			///< Saving a checkpoint or results file.
+		count				///< The number of kinds.
+	};
+
+	/// Clock used to time the spans.
+	using Clock = std::chrono::steady_clock;
+
+	/// Construct a tracer that is off.
+	Tracer();
+
+	/// Clear the timeline and turn tracing on or off. This must not be called
+	/// while another thread is recording.
+	/// \param numSlots The number of threads that record, each of which
+	///        passes its own index in [0, numSlots).
+	/// \param capacity The number of spans kept per thread, or zero to turn
+	///        tracing off.
+	void reset(unsigned numSlots, std::size_t capacity);
+
+	/// Is the timeline being recorded?
+	/// \return Returns true if tracing is on.
+	bool enabled() const noexcept { return _capacity > 0; }
+
+	/// Record a span.
+	/// \param slot The index of the calling thread.
+	/// \param span The kind of span.
+	/// \param begin The start of the span.
+	/// \param end The end of the span.
+	/// \param cell The measurement cell of the span, or -1.
+	/// \param rays The rays cast by the span, if any.
+	void record(unsigned slot, Span span, Clock::time_point begin,
+				Clock::time_point end, int cell = -1, int rays = 0) noexcept;
+
+	/// Get the number of spans that were overwritten in full buffers.
+	/// \return Returns the number summed over the threads.
+	std::size_t dropped() const noexcept;
+
+	/// Write the timeline as a Chrome trace, in the JSON object format. This
+	/// must only be called when no thread is recording.
+	/// \param os The stream to write to.
+	void write(std::ostream & os) const;
+
+	/// Write the timeline to a file as a Chrome trace.
+	/// \param fname The name of the file.
+	/// \throws Throws std::runtime_error if the file can't be written.
+	void write(const std::string & fname) const;
+
+	/// Get the name of a kind of span, as shown in the trace.
+	/// \param span A kind other than Span::count.
+	/// \return Returns a lower case name, e.g. "task".
+	static const char * name(Span span) noexcept;
+
+  private:
+	/// A recorded span, with times relative to the last reset().
+	struct Record {
+		std::int64_t begin;			///< Start, in nanoseconds.
+		std::int64_t end;			///< End, in nanoseconds.
+		Span span;					///< Kind of span.
+		int cell;					///< Measurement cell, or -1.
+		int rays;					///< Rays cast, if any.
+	};
+
+	/// The ring buffer of one thread. The padding keeps the indices of
+	/// neighbouring slots on different cache lines.
+	struct Slot {
+		std::unique_ptr<Record[]> records;	///< Buffer of _capacity spans
+		std::atomic<std::size_t> recorded;	///< Spans recorded, ever
+		char padding[64];
+	};
+
+	std::unique_ptr<Slot[]> _slots;	///< One slot per recording thread
+	unsigned _numSlots;				///< Number of entries in _slots
+	std::size_t _capacity;			///< Spans kept per slot, or 0 if off
+	Clock::time_point _start;		///< Time of the last reset()
+};
+
+/// Records the time from its construction to its destruction as a span.
+class TraceScope
+{
+  public:
+	/// Start the span, if tracing is on.
+	/// \param tracer The tracer to record the span with.
+	/// \param slot The index of the calling thread.
+	/// \param span The kind of span.
+	/// \param cell The measurement cell of the span, or -1.
+	/// \param rays The rays cast by the span, if any.
+	TraceScope(Tracer & tracer, unsigned slot, Tracer::Span span,
+			   int cell = -1, int rays = 0) noexcept
+	  : _tracer(tracer), _slot(slot), _span(span), _cell(cell), _rays(rays),
+		_enabled(tracer.enabled())
+	{
+		if (_enabled) {
+			_begin = Tracer::Clock::now();
+		}
+	}
+
+	/// Record the span.
+	~TraceScope()
+	{
+		if (_enabled) {
+			_tracer.record(_slot, _span, _begin, Tracer::Clock::now(), _cell,
+						   _rays);
+		}
+	}
+
+	/// The scope is not copyable.
+	TraceScope(const TraceScope &) = delete;
+
+	/// The scope is not assignable.
+	/// \return Never returns.
+	TraceScope & operator=(const TraceScope &) = delete;
+
+  private:
+	Tracer & _tracer;					///< Tracer to record with
+	unsigned _slot;						///< Index of the recording thread
+	Tracer::Span _span;					///< Kind of span
+	int _cell;							///< Measurement cell, or -1
+	int _rays;							///< Rays cast, if any
+	bool _enabled;						///< Tracing is on
+	Tracer::Clock::time_point _begin;	///< Start of the span
+};
+
+} // namespace nix
@@ -18,12 +18,12 @@ const Vector3 Vector3::ZAxis(0.0, 0.0, 1.0);
 
 std::ostream& Vector3::Print(std::ostream &os) const
 {
-	return os;
+	return os << "[" << x << ", " << y << ", " << z << "]";
 }
 
-std::ostream& operator<<(std::ostream &os, const Vector3 &/*v*/)
+std::ostream& operator<<(std::ostream &os, const Vector3 &v)
 {
-	return os;
+	return v.Print(os);
 }
 
 }
@@ -6,6 +6,7 @@
 
 #include "Scalar.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <iosfwd>
@@ -37,6 +38,51 @@ public:
 	 : x(x), y(y), z(z)
 	{ }
 	
+	Vector3 operator+(const Vector3 &v) const		//! vector addition
+	{ return Vector3(x + v.x, y + v.y, z + v.z); }
+
+	Vector3 operator-(const Vector3 &v) const		//! vector subtraction
+	{ return Vector3(x - v.x, y - v.y, z - v.z); }
+
+	Vector3 operator-() const						//! negation
+	{ return Vector3(-x, -y, -z); }
+
+	Vector3 operator*(Scalar s) const				//! scaling
+	{ return Vector3(s * x, s * y, s * z); }
+
+	Vector3 operator/(Scalar s) const				//! division by a scalar
+	{ return Vector3(x / s, y / s, z / s); }
+
+	Vector3 & operator+=(const Vector3 &v)			//! in-place addition
+	{ x += v.x; y += v.y; z += v.z; return *this; }
+
+	Vector3 & operator-=(const Vector3 &v)			//! in-place subtraction
+	{ x -= v.x; y -= v.y; z -= v.z; return *this; }
+
+	Vector3 & operator*=(Scalar s)					//! in-place scaling
+	{ x *= s; y *= s; z *= s; return *this; }
+
+	Vector3 & operator=(const Vector3 &v)			//! assignment
+	{ x = v.x; y = v.y; z = v.z; return *this; }
+
+	/*!
+	 * \returns the Euclidean length of the vector
+	 */
+	Scalar length() const							//! length of the vector
+	{ return std::sqrt(x * x + y * y + z * z); }
+
+	/*!
+	 * \returns the square of the Euclidean length, without a square root
+	 */
+	Scalar lengthSquared() const					//! squared length
+	{ return x * x + y * y + z * z; }
+
+	/*!
+	 * \returns a unit vector in the same direction; must not be zero length
+	 */
+	Vector3 normalized() const						//! unit vector
+	{ Scalar l = length(); assert(l > 0); return Vector3(x / l, y / l, z / l); }
+
 	/*!
 	 * \param os [in] output stream to write to
 	 * \returns os after it has been written to
@@ -46,6 +92,72 @@ public:
 
 };
 
+//! scaling with the scalar on the left
+inline Vector3 operator*(Scalar s, const Vector3 &v)
+{ return v * s; }
+
+//! dot product
+inline Scalar dot(const Vector3 &a, const Vector3 &b)
+{ return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+//! cross product
+inline Vector3 cross(const Vector3 &a, const Vector3 &b)
+{ return Vector3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+				 a.x * b.y - a.y * b.x); }
+
+//! mirror reflection
+/*!
+ * \param d [in] the incoming direction
+ * \param N [in] the unit normal of the mirror, on either side
+ * \returns d reflected about the plane of N
+ */
+inline Vector3 reflect(const Vector3 &d, const Vector3 &N)
+{ return d - N * (2 * dot(d, N)); }
+
+//! refraction with Snell's law
+/*!
+ * \param d [in] the incoming unit direction
+ * \param N [in] the unit normal on the incoming side
+ * \param eta [in] the ratio of the incoming to the outgoing refractive index
+ * \param t [out] the refracted unit direction, unless there is total internal
+ *        reflection, in which case it is unchanged
+ * \returns false on total internal reflection
+ */
+inline bool refract(const Vector3 &d, const Vector3 &N, Scalar eta, Vector3 &t)
+{
+	const Scalar cosi = std::min(-dot(d, N), Scalar(1));
+	const Scalar k = 1 - eta * eta * (1 - cosi * cosi);
+	if (k < 0) {
+		return false;
+	}
+	t = (d * eta + N * (eta * cosi - std::sqrt(k))).normalized();
+	return true;
+}
+
+//! A Vector3 padded to four components and aligned to their size
+/*!
+ * The padding makes a vector fill a SIMD register of its components, e.g.
+ * of doubles with AVX, so that it is loaded and stored whole, and arrays of
+ * them never split a vector across cache lines. The padding is not part of
+ * the value.
+ */
+struct alignas(4 * sizeof(Scalar)) PaddedVector3
+{
+	Scalar x /*! x component */, y /*! y component */, z /*! z component */;
+	Scalar w;										//!< padding, always zero
+
+	PaddedVector3()									//! the zero vector
+	 : x(0), y(0), z(0), w(0)
+	{ }
+
+	PaddedVector3(const Vector3 &v)					//! pads a vector
+	 : x(v.x), y(v.y), z(v.z), w(0)
+	{ }
+
+	operator Vector3() const						//! drops the padding
+	{ return Vector3(x, y, z); }
+};
+
 //! prints a vector in readable form
 /*!
  * \sa Vector3::Print()
@@ -0,0 +1,151 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include "Scalar.h"
+#include "Vector3.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nix {
+
+/// A block of N vectors, stored as a structure of arrays.
+///
+/// The batched operations below are plain loops over the components, without
+/// branches, which compilers turn into SIMD code for double and float
+/// Scalars. Lanes that don't apply, e.g. rays that are totally internally
+/// reflected, are computed anyway and flagged, rather than skipped. With long double Scalars, for
+/// which there are no SIMD instructions, the loops are the scalar fallback,
+/// and give the same results as the Vector3 functions.
+///
+/// Blocks are aligned for AVX, so they should live on the stack or in a
+/// member of an object that does, rather than be allocated one at a time.
+template <int N>
+struct alignas(32) Vector3Block
+{
+	static constexpr int size = N;	///< The number of vectors.
+
+	Scalar x[N];	///< The x components.
+	Scalar y[N];	///< The y components.
+	Scalar z[N];	///< The z components.
+
+	/// Get a vector.
+	/// \param i The index of the vector, in [0, N).
+	/// \return Returns the vector.
+	Vector3 get(int i) const { return Vector3(x[i], y[i], z[i]); }
+
+	/// Set a vector.
+	/// \param i The index of the vector, in [0, N).
+	/// \param v The new value of the vector.
+	void set(int i, const Vector3 & v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+
+	/// Set every vector to the same value.
+	/// \param v The new value of the vectors.
+	void fill(const Vector3 & v)
+	{
+		for (int i=0; i<N; ++i) {
+			set(i, v);
+		}
+	}
+};
+
+template <int N>
+constexpr int Vector3Block<N>::size;
+
+/// Dot products of the vectors of two blocks.
+/// \param a The first vectors.
+/// \param b The second vectors.
+/// \param[out] out The dot product of each pair.
+template <int N>
+inline void dot(const Vector3Block<N> & a, const Vector3Block<N> & b,
+				Scalar * out)
+{
+	for (int i=0; i<N; ++i) {
+		out[i] = a.x[i] * b.x[i] + a.y[i] * b.y[i] + a.z[i] * b.z[i];
+	}
+}
+
+/// Cross products of the vectors of two blocks.
+/// \param a The first vectors.
+/// \param b The second vectors.
+/// \param[out] out The cross product of each pair. It may be \p a or \p b.
+template <int N>
+inline void cross(const Vector3Block<N> & a, const Vector3Block<N> & b,
+				  Vector3Block<N> & out)
+{
+	for (int i=0; i<N; ++i) {
+		const Scalar x = a.y[i] * b.z[i] - a.z[i] * b.y[i];
+		const Scalar y = a.z[i] * b.x[i] - a.x[i] * b.z[i];
+		const Scalar z = a.x[i] * b.y[i] - a.y[i] * b.x[i];
+		out.x[i] = x;
+		out.y[i] = y;
+		out.z[i] = z;
+	}
+}
+
+/// Normalize the vectors of a block in place. None of them may be zero.
+/// \param v The vectors.
+template <int N>
+inline void normalize(Vector3Block<N> & v)
+{
+	for (int i=0; i<N; ++i) {
+		const Scalar l = std::sqrt(v.x[i] * v.x[i] + v.y[i] * v.y[i] +
+								   v.z[i] * v.z[i]);
+		v.x[i] /= l;
+		v.y[i] /= l;
+		v.z[i] /= l;
+	}
+}
+
+/// Reflect the vectors of a block about normals, in place.
+/// \param d The directions to reflect.
+/// \param n The unit normals.
+template <int N>
+inline void reflect(Vector3Block<N> & d, const Vector3Block<N> & n)
+{
+	for (int i=0; i<N; ++i) {
+		const Scalar s = 2 * (d.x[i] * n.x[i] + d.y[i] * n.y[i] +
+							  d.z[i] * n.z[i]);
+		d.x[i] -= n.x[i] * s;
+		d.y[i] -= n.y[i] * s;
+		d.z[i] -= n.z[i] * s;
+	}
+}
+
+/// Refract the vectors of a block with Snell's law, as refract() does for
+/// one vector.
+/// \param d The incoming unit directions.
+/// \param n The unit normals on the incoming side.
+/// \param eta The ratio of the incoming to the outgoing refractive index of
+///        each vector.
+/// \param[out] t The refracted directions. Those of vectors that are totally
+///        internally reflected are meaningless. They are written anyway, as
+///        a conditional store would keep the loop from being vectorized.
+/// \param[out] refracted Set to 0 for the vectors that are totally
+///        internally reflected, and 1 for the others. The flags are Scalars,
+///        which are as wide as the other lanes of the loop, so that it can
+///        be vectorized.
+template <int N>
+inline void refract(const Vector3Block<N> & d, const Vector3Block<N> & n,
+					const Scalar * eta, Vector3Block<N> & t, Scalar * refracted)
+{
+	for (int i=0; i<N; ++i) {
+		const Scalar dn = d.x[i] * n.x[i] + d.y[i] * n.y[i] + d.z[i] * n.z[i];
+		const Scalar cosi = std::min(-dn, Scalar(1));
+		const Scalar k = 1 - eta[i] * eta[i] * (1 - cosi * cosi);
+		const Scalar s = eta[i] * cosi - std::sqrt(std::max(k, Scalar(0)));
+		const Scalar x = d.x[i] * eta[i] + n.x[i] * s;
+		const Scalar y = d.y[i] * eta[i] + n.y[i] * s;
+		const Scalar z = d.z[i] * eta[i] + n.z[i] * s;
+		const Scalar l = std::sqrt(x * x + y * y + z * z);
+		t.x[i] = x / l;
+		t.y[i] = y / l;
+		t.z[i] = z / l;
+		refracted[i] = k >= 0 ? 1 : 0;
+	}
+}
+
+} // namespace nix
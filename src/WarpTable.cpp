@@ -0,0 +1,93 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "WarpTable.h"
+
+#include <ContentHash.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace nix {
+
+constexpr int WarpTable::size;
+
+WarpTable::WarpTable(const Array2 & density)
+  : _marginal(size + 1), _conditional(size * (size + 1)), _pdf(size * size),
+	_mass(0)
+{
+	double total = 0;
+	for (int i=0; i<size; ++i) {
+		for (int j=0; j<size; ++j) {
+			const double d = static_cast<double>(density[i][j]);
+			_pdf[i * size + j] = std::isfinite(d) and d > 0 ? d : 0;
+			total += _pdf[i * size + j];
+		}
+	}
+	_mass = total;
+	if (!(total > 0)) {
+		std::fill(_pdf.begin(), _pdf.end(), 1);
+		total = size * size;
+	}
+
+	_marginal[0] = 0;
+	for (int i=0; i<size; ++i) {
+		double * cdf = &_conditional[i * (size + 1)];
+		cdf[0] = 0;
+		for (int j=0; j<size; ++j) {
+			cdf[j+1] = cdf[j] + _pdf[i * size + j];
+		}
+		const double row = cdf[size];
+		for (int j=1; j<=size; ++j) {
+			// An empty row is never chosen, but keep it uniform to be safe
+			cdf[j] = row > 0 ? cdf[j] / row : double(j) / size;
+		}
+		cdf[size] = 1;
+		_marginal[i+1] = _marginal[i] + row / total;
+	}
+	_marginal[size] = 1;
+
+	// Relative to the uniform density, i.e. the average is one
+	for (double & d : _pdf) {
+		d *= size * size / total;
+	}
+}
+
+Scalar WarpTable::invert(const double * cdf, Scalar u, int & cell) noexcept
+{
+	// The last cell whose cumulative value is not above u
+	const double v = static_cast<double>(u);
+	int i = std::upper_bound(cdf, cdf + size + 1, v) - cdf - 1;
+	i = std::min(std::max(i, 0), size - 1);
+	const double width = cdf[i+1] - cdf[i];
+	const Scalar t = width > 0 ? (v - cdf[i]) / width : 0;
+	cell = i;
+	return (i + std::min(std::max(t, Scalar(0)), Scalar(1))) / size;
+}
+
+void WarpTable::sample(Scalar u1, Scalar u2, Scalar & x, Scalar & y)
+	const noexcept
+{
+	int row, column;
+	x = invert(_marginal.data(), u1, row);
+	y = invert(&_conditional[row * (size + 1)], u2, column);
+}
+
+Scalar WarpTable::pdf(Scalar x, Scalar y) const noexcept
+{
+	if (!(x >= 0 and x <= 1 and y >= 0 and y <= 1)) {
+		return 0;
+	}
+	const int i = std::min(static_cast<int>(x * size), size - 1);
+	const int j = std::min(static_cast<int>(y * size), size - 1);
+	return _pdf[i * size + j];
+}
+
+void WarpTable::fingerprint(ContentHash & hash) const
+{
+	hash.addDoubles(_marginal).addDoubles(_conditional).addDoubles(_pdf);
+	hash.addDoubles({ _mass });
+}
+
+} // namespace nix
@@ -0,0 +1,83 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include <Array2.h>
+#include <Scalar.h>
+
+#include <vector>
+
+namespace nix {
+
+class ContentHash;
+
+/// An inverse cumulative distribution table for sampling a 2D density.
+///
+/// The density is an Array2 that is taken to be constant over each of its
+/// cells, which tile the unit square: row \f$i\f$ covers \f$x \in [i/101,
+/// (i+1)/101)\f$ and column \f$j\f$ covers \f$y \in [j/101, (j+1)/101)\f$.
+/// A sample is drawn from the marginal distribution of the rows, and then
+/// from the conditional distribution of the columns of the chosen row, each
+/// with a binary search of a cumulative table. The tables are built once and
+/// never change, so a WarpTable can be shared between threads and
+/// generators.
+class WarpTable
+{
+  public:
+	/// The number of rows and columns of the density.
+	static constexpr int size = 101;
+
+	/// Build the tables of a density. Negative and non-finite values are
+	/// taken to be zero, and a density that is zero everywhere is taken to
+	/// be uniform.
+	/// \param density The density, which needn't be normalized.
+	explicit WarpTable(const Array2 & density);
+
+	/// Map two uniform random numbers to a point distributed by the density.
+	/// \param u1 A uniform random number in \f$[0, 1)\f$, which chooses x.
+	/// \param u2 A uniform random number in \f$[0, 1)\f$, which chooses y.
+	/// \param[out] x The first coordinate, in \f$[0, 1]\f$.
+	/// \param[out] y The second coordinate, in \f$[0, 1]\f$.
+	void sample(Scalar u1, Scalar u2, Scalar & x, Scalar & y) const noexcept;
+
+	/// Get the density of the point that sample() maps two numbers to,
+	/// relative to the uniform density on the unit square.
+	/// \param x The first coordinate.
+	/// \param y The second coordinate.
+	/// \return Returns the normalized density, or 0 outside the square.
+	Scalar pdf(Scalar x, Scalar y) const noexcept;
+
+	/// Get the total of the density as it was given, e.g. to choose between
+	/// tables in proportion to their weights.
+	/// \return Returns the sum of the valid values, or 0 if there are none.
+	double mass() const noexcept { return _mass; }
+
+	/// Add the tables to a hash.
+	/// \param hash The hash to add to.
+	void fingerprint(ContentHash & hash) const;
+
+  private:
+	/// Invert a cumulative table by binary search.
+	/// \param cdf The size + 1 cumulative values, from 0 to 1.
+	/// \param u A uniform random number.
+	/// \param[out] cell The index of the cell that \p u falls in.
+	/// \return Returns the position in \f$[0, 1]\f$ that \p u maps to.
+	static Scalar invert(const double * cdf, Scalar u, int & cell) noexcept;
+
+	/// Cumulative distribution of the rows, with size + 1 entries.
+	std::vector<double> _marginal;
+
+	/// Cumulative distribution of the columns of each row, with size + 1
+	/// entries per row.
+	std::vector<double> _conditional;
+
+	/// The normalized density of each cell.
+	std::vector<double> _pdf;
+
+	/// The total of the density as given.
+	double _mass;
+};
+
+} // namespace nix
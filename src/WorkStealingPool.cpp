@@ -0,0 +1,147 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace nix {
+
+// Identify the pool and the worker index of the current thread, so that tasks
+// submitted from within a task can be queued locally.
+static thread_local const WorkStealingPool * tl_pool = nullptr;
+static thread_local unsigned tl_worker = 0;
+
+WorkStealingPool::WorkStealingPool(unsigned numThreads)
+ : _next(0), _queued(0), _pending(0), _stop(false)
+{
+	numThreads = std::max(numThreads, 1u);
+	for (unsigned i=0; i<numThreads; ++i) {
+		_queues.emplace_back(new Queue);
+	}
+	for (unsigned i=0; i<numThreads; ++i) {
+		_threads.emplace_back(&WorkStealingPool::work, this, i);
+	}
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for (auto & thread : _threads) {
+		thread.join();
+	}
+}
+
+void WorkStealingPool::submit(Task task)
+{
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		++_pending;
+	}
+
+	if (tl_pool == this) {
+		Queue & queue = *_queues[tl_worker];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		queue.tasks.push_front(std::move(task));
+	} else {
+		Queue & queue = *_queues[_next++ % _queues.size()];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		queue.tasks.push_back(std::move(task));
+	}
+
+	{
+		// Taking the lock prevents a wake-up from being lost between a worker
+		// testing _queued and going to sleep.
+		std::lock_guard<std::mutex> guard(_lock);
+		++_queued;
+	}
+	_wake.notify_one();
+}
+
+void WorkStealingPool::wait()
+{
+	std::unique_lock<std::mutex> guard(_lock);
+	_idle.wait(guard, [this] { return _pending == 0; });
+	if (_error) {
+		auto error = _error;
+		_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+bool WorkStealingPool::pop(unsigned worker, Task & task)
+{
+	Queue & queue = *_queues[worker];
+	std::lock_guard<std::mutex> guard(queue.lock);
+	if (queue.tasks.empty()) {
+		return false;
+	}
+	task = std::move(queue.tasks.front());
+	queue.tasks.pop_front();
+	--_queued;
+	return true;
+}
+
+bool WorkStealingPool::steal(unsigned thief, Task & task)
+{
+	const unsigned n = _queues.size();
+	for (unsigned i=1; i<n; ++i) {
+		Queue & victim = *_queues[(thief + i) % n];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			--_queued;
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkStealingPool::run(unsigned worker, Task & task)
+{
+	std::exception_ptr error;
+	try {
+		task(worker);
+	} catch (...) {
+		error = std::current_exception();
+	}
+	task = nullptr;
+
+	std::lock_guard<std::mutex> guard(_lock);
+	if (error and !_error) {
+		_error = error;
+	}
+	if (--_pending == 0) {
+		_idle.notify_all();
+	}
+}
+
+void WorkStealingPool::work(unsigned worker)
+{
+	tl_pool = this;
+	tl_worker = worker;
+
+	Task task;
+	while (true) {
+		if (pop(worker, task) or steal(worker, task)) {
+			run(worker, task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(_lock);
+		_wake.wait(guard, [this] { return _stop or _queued > 0; });
+		if (_stop and _queued <= 0) {
+			return;
+		}
+	}
+}
+
+} // namespace nix
@@ -0,0 +1,106 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nix {
+
+/// A fixed-size pool of worker threads that balance their load by stealing.
+///
+/// Every worker owns a double-ended queue of tasks. Tasks submitted from
+/// outside the pool are dealt round-robin across the queues. Tasks submitted
+/// by a running task are pushed onto the front of the queue of the worker that
+/// runs it, so follow-up work is done before older work is started. A worker
+/// takes tasks from the front of its own queue and, once that is empty, steals
+/// from the front of the other workers' queues. Tasks therefore complete in
+/// roughly the order they were submitted, while uneven task costs are soaked
+/// up by whichever workers happen to be free.
+class WorkStealingPool
+{
+  public:
+	/// A unit of work. The argument is the index of the worker that runs the
+	/// task, which is in the range [0, size()).
+	using Task = std::function<void(unsigned worker)>;
+
+	/// Start the worker threads.
+	/// \param numThreads The number of workers. Zero is treated as one.
+	explicit WorkStealingPool(unsigned numThreads);
+
+	/// Outstanding tasks are completed before the workers are joined.
+	~WorkStealingPool();
+
+	/// The pool is not copyable.
+	WorkStealingPool(const WorkStealingPool &) = delete;
+
+	/// The pool is not assignable.
+	/// \return Never returns.
+	WorkStealingPool & operator=(const WorkStealingPool &) = delete;
+
+	/// Get the number of worker threads.
+	/// \return Returns a number \f$ \ge 1 \f$.
+	unsigned size() const noexcept { return _queues.size(); }
+
+	/// Queue a task for execution. This may be called from any thread,
+	/// including from within a running task.
+	/// \param task The task to execute.
+	void submit(Task task);
+
+	/// Block until every submitted task, including those submitted by other
+	/// tasks, has completed. If any task threw an exception, the first such
+	/// exception is re-thrown here once the pool is idle.
+	void wait();
+
+  private:
+	/// A worker's task queue. Padded so that the locks of queues allocated
+	/// next to each other do not share a cache line.
+	struct Queue {
+		std::mutex lock;			///< Guards the tasks.
+		std::deque<Task> tasks;		///< Tasks waiting to be run.
+		char padding[64];			///< Keeps neighbours off this cache line.
+	};
+
+	/// Take a task from a worker's own queue.
+	/// \param worker The index of the calling worker.
+	/// \param[out] task The task that was taken, if any.
+	/// \return Returns true if a task was taken.
+	bool pop(unsigned worker, Task & task);
+
+	/// Take a task from the queue of some other worker.
+	/// \param thief The index of the calling worker.
+	/// \param[out] task The task that was taken, if any.
+	/// \return Returns true if a task was taken.
+	bool steal(unsigned thief, Task & task);
+
+	/// Main loop of a worker thread.
+	/// \param worker The index of the worker.
+	void work(unsigned worker);
+
+	/// Execute a task and account for its completion.
+	/// \param worker The index of the calling worker.
+	/// \param task The task to run.
+	void run(unsigned worker, Task & task);
+
+	std::vector<std::unique_ptr<Queue>> _queues;	///< One queue per worker.
+	std::vector<std::thread> _threads;				///< The workers.
+	std::atomic<unsigned> _next;	///< Round-robin target for submissions.
+	std::atomic<long> _queued;		///< Tasks sitting in the queues.
+	long _pending;					///< Tasks not yet complete.
+	bool _stop;						///< Set when the pool is shutting down.
+	std::exception_ptr _error;		///< First exception thrown by a task.
+	std::mutex _lock;				///< Guards _pending, _stop and _error.
+	std::condition_variable _wake;	///< Signalled when work is queued.
+	std::condition_variable _idle;	///< Signalled when _pending drops to 0.
+};
+
+} // namespace nix
@@ -0,0 +1,308 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Array2.h"
+#include "Benchmark.h"
+#include "EqualSolidAnglesCollectorSphere.h"
+#include "Intersection.h"
+#include "ParticleArena.h"
+#include "PiecewiseLinearSpectrum.h"
+#include "RandomScatterRecord.h"
+#include "RandomSpheroidParticleGenerator.h"
+#include "RandomStream.h"
+#include "RayResult.h"
+#include "SpectralSample.h"
+#include "Test1Material.h"
+#include "VacuumMedium.h"
+
+using namespace std;
+using namespace nix;
+
+namespace {
+
+/// The number of distinct inputs each kernel cycles through. It is a power of
+/// two so that the input of an operation is found with a mask.
+constexpr int numInputs = 1024;
+
+/// Seed of every random stream, so that the inputs are the same in every run.
+constexpr std::uint64_t seed = 0x6e6978;
+
+void usage(const string & exe)
+{
+	cout << endl
+		 << "  Usage:" << endl
+		 << "    " << exe << " [options]" << endl
+		 << endl
+		 << "  Time the hot kernels of nix." << endl
+		 << endl
+		 << "  Options:" << endl
+		 << "    -h                   Display this help." << endl
+		 << "    --filter <text>      Only run the benchmarks whose names contain <text>." << endl
+		 << "    --json <file>        Also write the results to <file> as JSON." << endl
+		 << "    --list               List the benchmarks without running them." << endl
+		 << "    --min-time <s>       Shortest time of one repetition, in seconds." << endl
+		 << "    --repetitions <n>    Number of timed repetitions." << endl
+		 << "    --warmup <n>         Number of untimed runs before the repetitions." << endl
+		 << endl;
+}
+
+/// A spectrum shaped like the refractive index of ice, with many segments.
+shared_ptr<PiecewiseLinearSpectrum> iceIndex()
+{
+	vector<Scalar> wavelengths, values;
+	for (int i=0; i<=215; ++i) {
+		const Scalar lambda = 350 + 10 * i;
+		wavelengths.push_back(lambda);
+		values.push_back(1.32 - 0.03 * (lambda - 350) / 2150 +
+						 0.005 * std::sin(lambda / 50));
+	}
+	return make_shared<PiecewiseLinearSpectrum>("ice_n", wavelengths, values);
+}
+
+/// A spectrum shaped like the extinction index of ice.
+shared_ptr<PiecewiseLinearSpectrum> iceExtinction()
+{
+	return make_shared<PiecewiseLinearSpectrum>("ice_k",
+		vector<Scalar>{ 350, 1000, 1500, 2000, 2500 },
+		vector<Scalar>{ 1e-9, 2e-6, 5e-4, 1e-3, 5e-4 });
+}
+
+/// Wavelengths spread over the range of the spectra, in a scrambled order.
+vector<Scalar> wavelengths()
+{
+	RandomStream random(seed, 0, 0, 0);
+	vector<Scalar> lambdas(numInputs);
+	for (Scalar & lambda : lambdas) {
+		lambda = 350 + 2150 * random.uniform();
+	}
+	return lambdas;
+}
+
+/// Unit directions distributed uniformly over the sphere.
+vector<Ray3> directions()
+{
+	RandomStream random(seed, 0, 0, 1);
+	vector<Ray3> rays(numInputs);
+	for (Ray3 & ray : rays) {
+		const Scalar z = 2 * random.uniform() - 1;
+		const Scalar phi = 2 * M_PI * random.uniform();
+		const Scalar r = std::sqrt(1 - z * z);
+		ray = Ray3(Point3::Origin, Vector3(r * std::cos(phi),
+										   r * std::sin(phi), z));
+	}
+	return rays;
+}
+
+/// A generator of snow grains, with flat warps.
+shared_ptr<RandomSpheroidParticleGenerator> snowGenerator()
+{
+	Array2 warp;
+	for (auto & row : warp) {
+		row.fill(0.5);
+	}
+	auto size = make_shared<PiecewiseLinearSpectrum>("size", 0, 1,
+		vector<Scalar>{ 200e-6, 600e-6 });
+	auto sphericity = make_shared<PiecewiseLinearSpectrum>("sphericity", 0, 1,
+		vector<Scalar>{ 0.8, 1.25 });
+	return make_shared<RandomSpheroidParticleGenerator>(warp, warp, size,
+		sphericity, 300e-6);
+}
+
+/// A layer of snow: ice grains in air, without a mirror interface.
+shared_ptr<Test1Material> snowMaterial()
+{
+	shared_ptr<const PiecewiseLinearSpectrum> airN =
+		make_shared<PiecewiseLinearSpectrum>("air_n", 350, 2500,
+			vector<Scalar>{ 1, 1 });
+	shared_ptr<const PiecewiseLinearSpectrum> airK =
+		make_shared<PiecewiseLinearSpectrum>("air_k", 350, 2500,
+			vector<Scalar>{ 0, 0 });
+
+	Test1Material::ParticleDef ice;
+	ice.name = "ice";
+	ice.n = iceIndex();
+	ice.k = iceExtinction();
+	ice.roundness_mean = 0.5;
+	ice.roundness_var = 0.1;
+	ice.concentration = 1;
+	ice.generator = snowGenerator();
+	ice.meanDistance = ice.generator->averageParticleDistance();
+
+	auto material = make_shared<Test1Material>();
+	material->setDepth(0.01);
+	material->setMediaTypes({ Test1Material::MediumDef("air", 1, airN, airK) });
+	material->setParticles({ ice });
+	material->setMirrorInterface(false);
+	return material;
+}
+
+/// Register the benchmarks, in the order they are run.
+vector<Benchmark> benchmarks()
+{
+	vector<Benchmark> all;
+
+	auto index = iceIndex();
+	auto lambdas = make_shared<vector<Scalar>>(wavelengths());
+	all.emplace_back("spectrum_evaluate", [=](long long ops) {
+		Scalar sum = 0;
+		for (long long i=0; i<ops; ++i) {
+			sum += index->evaluate((*lambdas)[i & (numInputs - 1)]);
+		}
+		Benchmark::keep(sum);
+	});
+
+	auto resampled = iceIndex();
+	resampled->resample(1);
+	all.emplace_back("spectrum_evaluate_resampled", [=](long long ops) {
+		Scalar sum = 0;
+		for (long long i=0; i<ops; ++i) {
+			sum += resampled->evaluate((*lambdas)[i & (numInputs - 1)]);
+		}
+		Benchmark::keep(sum);
+	});
+
+	auto extinction = iceExtinction();
+	all.emplace_back("complex_refractive_index", [=](long long ops) {
+		Scalar sum = 0;
+		for (long long i=0; i<ops; ++i) {
+			const std::complex<Scalar> n = getComplexRefractiveIndex(index,
+				extinction, (*lambdas)[i & (numInputs - 1)]);
+			sum += n.real() + n.imag();
+		}
+		Benchmark::keep(sum);
+	});
+
+	auto sphere = make_shared<EqualSolidAnglesCollectorSphere>(18, 36, true,
+															   true);
+	auto rays = make_shared<vector<Ray3>>(directions());
+	all.emplace_back("sensor_id", [=](long long ops) {
+		long long sum = 0;
+		for (long long i=0; i<ops; ++i) {
+			sum += sphere->getSensorId((*rays)[i & (numInputs - 1)]);
+		}
+		Benchmark::keep(sum);
+	});
+
+	all.emplace_back("collector_record", [=](long long ops) {
+		sphere->Clear();
+		for (long long i=0; i<ops; ++i) {
+			sphere->Record((*rays)[i & (numInputs - 1)]);
+		}
+		Benchmark::keep(sphere->hits(0));
+	});
+
+	auto generator = snowGenerator();
+	all.emplace_back("particle_generate", [=](long long ops) {
+		ParticleArena arena;
+		RandomStream random(seed, 0, 0, 2);
+		Scalar sum = 0;
+		for (long long i=0; i<ops; ++i) {
+			if ((i & (numInputs - 1)) == 0) {
+				arena.reset();
+			}
+			sum += generator->generate(random, arena)->diameter();
+		}
+		Benchmark::keep(sum);
+	});
+
+	// A packet of four wavelengths strikes the snow at 0.5 radians, as in
+	// CollimatedBeamPhotometer::Cast().
+	auto material = snowMaterial();
+	const vector<Scalar> packet = { 400, 900, 1400, 1900 };
+	material->prepare(packet);
+	auto ss = make_shared<SpectralSample>();
+	for (Scalar lambda : packet) {
+		ss->add(lambda, 1);
+	}
+	ss->setPreparedIndex(0);
+	const Vector3 toSource(std::sin(0.5), 0, std::cos(0.5));
+	const Intersection x(Ray3(Point3::Origin + toSource,
+		Vector3(-toSource.x, -toSource.y, -toSource.z)), 1);
+	all.emplace_back("scatter", [=](long long ops) {
+		static const VacuumMedium ambient;
+		RandomScatterRecord sr(RandomStream(seed, 0, 0, 0));
+		long long sum = 0;
+		for (long long i=0; i<ops; ++i) {
+			sr.reset(RandomStream(seed, 1, 0, std::uint32_t(i)), packet.size(),
+					 i % packet.size());
+			sum += static_cast<int>(material->Scatter(x, *ss, ambient, sr)
+										.interaction());
+		}
+		Benchmark::keep(sum);
+	});
+
+	return all;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	Benchmark::Options options;
+	string filter, json;
+	bool list = false;
+	try {
+		for (int i=1; i<argc; ++i) {
+			const string arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+			if (arg == "-h" or arg == "--help") {
+				usage(argv[0]);
+				return EXIT_SUCCESS;
+			} else if (arg == "--list") {
+				list = true;
+			} else if (arg == "--filter" and hasValue) {
+				filter = argv[++i];
+			} else if (arg == "--json" and hasValue) {
+				json = argv[++i];
+			} else if (arg == "--min-time" and hasValue) {
+				options.minSeconds = stod(argv[++i]);
+			} else if (arg == "--repetitions" and hasValue) {
+				options.repetitions = stoi(argv[++i]);
+			} else if (arg == "--warmup" and hasValue) {
+				options.warmup = stoi(argv[++i]);
+			} else {
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+		}
+
+		vector<Benchmark::Result> results;
+		for (const Benchmark & b : benchmarks()) {
+			if (b.name().find(filter) == string::npos) {
+				continue;
+			}
+			if (list) {
+				cout << b.name() << endl;
+				continue;
+			}
+			results.push_back(b.run(options));
+		}
+		if (list) {
+			return EXIT_SUCCESS;
+		}
+		Benchmark::writeTable(cout, results);
+
+		if (!json.empty()) {
+			ofstream os(json);
+			Benchmark::writeJson(os, options, results);
+			if (!os) {
+				throw runtime_error("Unable to write " + json + ".");
+			}
+		}
+	} catch (const exception & e) {
+		cerr << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
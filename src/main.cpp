@@ -5,8 +5,12 @@
 
 #include "main.h"
 
+#include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <regex>
+#include <sstream>
 #include <stdexcept>
 #include <vector>
 
@@ -17,7 +21,11 @@
 #	include <boost/filesystem/convenience.hpp>
 #endif
 
+#include "BsdfTable.h"
 #include "LuaRunner.h"
+#include "PhotometerJob.h"
+#include "ResultComparison.h"
+#include "ResultFile.h"
 
 using namespace std;
 
@@ -39,6 +47,24 @@ void usage(string exe)
 		 << "    -c <param_file>  The parameter file to be provided to the Lua script." << endl
 		 << "    -h               Display this help." << endl
 		 << "    -t <integer>     Specify the number of threads to use." << endl
+		 << "    --shard <k>/<S>  Run the k-th of S shards of each job, and save its" << endl
+		 << "                     results to <name>.shard-<k>-of-<S> in the folder of" << endl
+		 << "                     the script <name>.lua, e.g. a.shard-1-of-3 for the" << endl
+		 << "                     first of 3 shards of a.lua." << endl
+		 << endl
+		 << "  Merge the results files of the shards of a job into its output:" << endl
+		 << "    " << exeName << " --merge <results_file>..." << endl
+		 << endl
+		 << "  Compare an output against a reference output of the same jobs, e.g." << endl
+		 << "  of nix_demo_float against nix_demo:" << endl
+		 << "    " << exeName << " --compare <reference> <output>" << endl
+		 << endl
+		 << "  Write a binary BSDF table as text, in the format of the output of a job:" << endl
+		 << "    " << exeName << " --bsdf-text <table>" << endl
+		 << endl
+		 << "  Run benchmark scenes and compare the output of each, e.g. scene.lua, with" << endl
+		 << "  its reference, scene.ref. A missing reference is written instead:" << endl
+		 << "    " << exeName << " --bench [-t <integer>] <scene.lua>..." << endl
 		 << endl;
 }
 
@@ -65,24 +91,180 @@ bool parseArgs(int argc, char *argv[], vector<std::string> & args)
 		args[0] = argv[1];
 
 		// loop over rest of args
-		string paramFile, numThreads;
+		string paramFile, numThreads, shard;
 		for (int x=2; x<argc; x+=2) {
 			if (argv[x] == string{"-c"}) {
 				paramFile = argv[x+1];
 			} else if(argv[x] == string{"-t"}) {
 				numThreads = argv[x+1];
+			} else if(argv[x] == string{"--shard"}) {
+				shard = argv[x+1];
 			}
 		}
 		args[1] = paramFile;
 		args[2] = numThreads;
+		args[3] = shard;
 		return true;
 	}
 	return false;
 }
 
+/// Merge the results files of the shards of a job, and write its output.
+/// \param files The results files.
+/// \return Returns the exit status of the application.
+static int merge(const vector<string> & files)
+{
+	try {
+		nix::ResultFile::merge(files).writeText(cout);
+	} catch(std::runtime_error & e) {
+		cerr << "Merge error: " << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
+
+/// Compare an output against a reference, and write a report.
+/// \param reference The name of the reference output.
+/// \param output The name of the output to compare.
+/// \return Returns the exit status of the application.
+static int compare(const string & reference, const string & output)
+{
+	try {
+		ifstream r(reference), o(output);
+		if (!r or !o) {
+			throw std::runtime_error("Unable to open " +
+				(r ? output : reference) + ".");
+		}
+		nix::ResultComparison::compare(r, o).writeReport(cout);
+	} catch(std::runtime_error & e) {
+		cerr << "Compare error: " << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
+
+/// Write a BSDF table as text.
+/// \param table The name of the table.
+/// \return Returns the exit status of the application.
+static int bsdfText(const string & table)
+{
+	try {
+		nix::BsdfTable(table).writeText(cout);
+	} catch(std::runtime_error & e) {
+		cerr << "BSDF table error: " << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
+
+/// Run benchmark scenes. Each scene's output is compared with its reference
+/// output, which is written if it doesn't exist yet.
+/// \param args The scripts of the scenes, optionally preceded by -t and the
+///        number of threads.
+/// \return Returns the exit status of the application: non-zero if a scene
+///         fails or isn't statistically equivalent to its reference.
+static int bench(vector<string> args)
+{
+#ifdef LINUX
+	namespace fs = experimental::filesystem;
+#elif defined(OSX)
+	namespace fs = boost::filesystem;
+#endif
+	int threads = 0;
+	if (args.size() >= 2 and args[0] == "-t") {
+		threads = stoi(args[1]);
+		args.erase(args.begin(), args.begin() + 2);
+	}
+	if (args.empty()) {
+		cerr << "There are no benchmark scenes to run." << endl;
+		return 1;
+	}
+
+	// Each script is run from its own folder, so the paths must be absolute.
+	vector<fs::path> scenes;
+	for (const string & arg : args) {
+		scenes.push_back(fs::absolute(fs::path(arg)));
+	}
+
+	int status = 0;
+	cout << left << setw(24) << "scene" << right << setw(10) << "seconds"
+		 << setw(12) << "rays" << setw(12) << "rays/s" << setw(10) << "z^2"
+		 << setw(10) << "|z| > 3" << "  result" << endl;
+	for (const fs::path & scene : scenes) {
+		fs::path reference = scene;
+		reference.replace_extension(".ref");
+		const string name = scene.stem().string();
+		try {
+			nix::lua::LuaRunner runner(scene.string());
+			if (threads != 0 and scene == scenes[0]) {
+				runner.setThreads(threads);
+			}
+
+			// Capture the output of the jobs, which they write to cout.
+			ostringstream output;
+			const long long rays = nix::PhotometerJob::totalRaysCast();
+			const auto start = chrono::steady_clock::now();
+			streambuf * const console = cout.rdbuf(output.rdbuf());
+			bool ok = false;
+			try {
+				ok = runner.run();
+			} catch (...) {
+				cout.rdbuf(console);
+				throw;
+			}
+			cout.rdbuf(console);
+			const double seconds = chrono::duration<double>(
+				chrono::steady_clock::now() - start).count();
+			if (!ok) {
+				throw std::runtime_error("The script failed.");
+			}
+			const long long cast = nix::PhotometerJob::totalRaysCast() - rays;
+
+			ostringstream row;
+			row << left << setw(24) << name << right << fixed
+				<< setprecision(2) << setw(10) << seconds << setw(12) << cast
+				<< setprecision(0) << setw(12) << cast / seconds;
+			ifstream r(reference.string());
+			if (!r) {
+				ofstream(reference.string()) << output.str();
+				cout << row.str() << setw(10) << "-" << setw(10) << "-"
+					 << "  reference written" << endl;
+				continue;
+			}
+			istringstream o(output.str());
+			const nix::ResultComparison c = nix::ResultComparison::compare(r, o);
+			row << setprecision(3) << setw(10) << c.meanSquaredZ
+				<< setw(10) << c.outliers << "  "
+				<< (c.equivalent() ? "equivalent" : "DIFFERENT");
+			cout << row.str() << endl;
+			if (!c.equivalent()) {
+				status = 1;
+			}
+		} catch(std::exception & e) {
+			cout << left << setw(24) << name << right << "  failed" << endl;
+			cerr << "Bench error in " << name << ": " << e.what() << endl;
+			status = 1;
+		}
+	}
+	return status;
+}
+
 int main(int argc, char *argv[])
 {
-	vector<string> params(3);
+	if (argc >= 2 and argv[1] == string{"--merge"}) {
+		return merge(vector<string>(argv + 2, argv + argc));
+	}
+	if (argc == 4 and argv[1] == string{"--compare"}) {
+		return compare(argv[2], argv[3]);
+	}
+	if (argc == 3 and argv[1] == string{"--bsdf-text"}) {
+		return bsdfText(argv[2]);
+	}
+	if (argc >= 2 and argv[1] == string{"--bench"}) {
+		return bench(vector<string>(argv + 2, argv + argc));
+	}
+
+	vector<string> params(4);
 	bool ok = parseArgs(argc, argv, params);
 	if (!ok) {
 		usage(argv[0]);
@@ -99,6 +281,13 @@ int main(int argc, char *argv[])
 			threads = stoi(params[2]);
 			runner.setThreads(threads);
 		}
+		if (not params[3].empty()) {
+			smatch m;
+			if (!regex_match(params[3], m, regex(R"((\d+)/(\d+))"))) {
+				throw std::invalid_argument("The shard must be k/S.");
+			}
+			runner.setShard(stoi(m[1]), stoi(m[2]));
+		}
 		cout << "There are " << runner.getThreads()
 			 << " threads are available for execution." << endl;
 		if (!runner.run()) {
@@ -20,7 +20,8 @@ void usage(std::string exe);
 ///        \a -h was passed in as an argument. It will contain one value if a
 ///        \c .lua file was specified to run.  It will be contain two values if
 ///        both a file was specified to run, and the \a -c command line
-///        argument was specified with a parameter file.
+///        argument was specified with a parameter file. The third and fourth
+///        values are the \a -t and \a --shard arguments, which may be empty.
 /// \return Returns true if everything is OK, false if there is an issue with
 ///         the specified command line arguments.
 static bool parseArgs(int argc, char *argv[], std::vector<std::string> & args);
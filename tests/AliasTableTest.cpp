@@ -0,0 +1,95 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "Check.h"
+
+#include <AliasTable.h>
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+using namespace nix;
+
+namespace {
+
+/// Get the probability of each outcome of a table. A sample is a step
+/// function of its random number, so evaluating it at the midpoints of a
+/// fine grid integrates it to within the width of the grid per step.
+/// \param table The table.
+/// \param steps The number of points of the grid.
+/// \return Returns the fraction of the grid that maps to each outcome.
+std::vector<Scalar> probabilities(const AliasTable & table, int steps)
+{
+	std::vector<Scalar> p(table.size(), 0);
+	for (int k=0; k<steps; ++k) {
+		const int i = table.sample((k + Scalar(0.5)) / steps);
+		if (i >= 0 and i < table.size()) {
+			p[i] += Scalar(1) / steps;
+		}
+	}
+	return p;
+}
+
+/// Check that each outcome is sampled in proportion to its weight.
+void testProportions()
+{
+	const std::vector<std::vector<Scalar>> cases = {
+		{ 1 },
+		{ 1, 1, 1, 1 },
+		{ 0.5, 0.25, 0.125, 0.125 },
+		{ 3, 0, 1, 0, 6 },
+		{ 1e-6, 1, 2, 1000, 7 },
+		{ 0.3, 0.3, 0.4 },
+	};
+	const int steps = 1 << 20;
+	for (const std::vector<Scalar> & weights : cases) {
+		const AliasTable table(weights);
+		NIX_CHECK(table.size() == int(weights.size()));
+		Scalar total = 0;
+		for (Scalar w : weights) {
+			total += w;
+		}
+		const std::vector<Scalar> p = probabilities(table, steps);
+		for (std::size_t i=0; i<weights.size(); ++i) {
+			// Each of the columns can be off by two steps of the grid.
+			NIX_CHECK(std::abs(p[i] - weights[i] / total) <=
+					  Scalar(2 * weights.size()) / steps);
+			if (weights[i] == 0) {
+				NIX_CHECK(p[i] == 0);
+			}
+		}
+	}
+}
+
+/// Check the edges of the random numbers, and of the table.
+void testEdges()
+{
+	const AliasTable table({ 0, 1 });
+	NIX_CHECK(table.sample(0) == 1);
+	NIX_CHECK(table.sample(1 - std::numeric_limits<Scalar>::epsilon()) == 1);
+
+	const AliasTable empty;
+	NIX_CHECK(empty.empty());
+	NIX_CHECK(empty.sample(0.5) == -1);
+	NIX_CHECK(AliasTable(std::vector<Scalar>()).empty());
+
+	const std::vector<Scalar> negative = { 1, -1 };
+	const std::vector<Scalar> zero = { 0, 0 };
+	const std::vector<Scalar> infinite = {
+		1, std::numeric_limits<Scalar>::infinity() };
+	NIX_CHECK_THROWS(AliasTable bad(negative), std::runtime_error);
+	NIX_CHECK_THROWS(AliasTable bad(zero), std::runtime_error);
+	NIX_CHECK_THROWS(AliasTable bad(infinite), std::runtime_error);
+}
+
+} // namespace
+
+int main()
+{
+	testProportions();
+	testEdges();
+	return test::result();
+}
@@ -0,0 +1,186 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "Check.h"
+
+#include <BsdfTable.h>
+#include <EqualSolidAnglesCollectorSphere.h>
+#include <ResultFile.h>
+#include <SphericalCoordinates.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace nix;
+
+namespace {
+
+const std::string fname = "BsdfTableTest.bsdf";
+
+/// Make the results of a job of two incident angles and three wavelengths,
+/// with complete, incomplete and empty cells.
+ResultFile makeResults(const ICollectorSphere & sphere)
+{
+	ResultFile results;
+	results.seed = 1234;
+	results.n = 1000;
+	results.polar = { 0, 0.5 };
+	results.azimuth = { 0, 0.25 };
+	results.lambdas = { 400, 800, 1200 };
+	for (int id=0; id<sphere.numSensors(); ++id) {
+		results.projectedSolidAngles.push_back(
+			sphere.getProjectedSolidAngle(id));
+	}
+	results.cells.resize(6);
+	for (int c=0; c<6; ++c) {
+		ResultFile::Cell & cell = results.cells[c];
+		cell.complete = c != 4;
+		cell.rays = c == 5 ? 0 : 1000;
+		if (cell.rays > 0) {
+			for (int id=0; id<sphere.numSensors(); ++id) {
+				cell.hits.push_back((7 * c + id) % 13);
+			}
+		}
+	}
+	return results;
+}
+
+std::string readBytes(const std::string & name)
+{
+	std::ifstream is(name, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(is),
+					   std::istreambuf_iterator<char>());
+}
+
+void writeBytes(const std::string & name, const std::string & bytes)
+{
+	std::ofstream(name, std::ios::binary | std::ios::trunc) << bytes;
+}
+
+/// Overwrite a field of the header of a copy of a table.
+template<typename T>
+std::string patch(std::string bytes, std::size_t offset, T value)
+{
+	std::memcpy(&bytes[offset], &value, sizeof(T));
+	return bytes;
+}
+
+/// Check that the table holds the results and the sensors it was written
+/// from, with the estimates of the job's output.
+void testRoundTrip()
+{
+	const EqualSolidAnglesCollectorSphere sphere(3, 4, true, true);
+	const ResultFile results = makeResults(sphere);
+	BsdfTable::write(fname, results, sphere);
+	const BsdfTable table(fname);
+
+	NIX_CHECK(table.numIncident() == 2);
+	NIX_CHECK(table.numLambdas() == 3);
+	NIX_CHECK(table.numSensors() == sphere.numSensors());
+	NIX_CHECK(table.header().seed == results.seed);
+	NIX_CHECK(table.header().version == BsdfTable::version);
+	for (int i=0; i<2; ++i) {
+		NIX_CHECK(table.incident(i).polar == double(results.polar[i]));
+		NIX_CHECK(table.incident(i).azimuth == double(results.azimuth[i]));
+	}
+	for (int l=0; l<3; ++l) {
+		NIX_CHECK(table.lambda(l) == double(results.lambdas[l]));
+	}
+	for (int id=0; id<table.numSensors(); ++id) {
+		const BsdfTable::Sensor & s = table.sensor(id);
+		NIX_CHECK(s.polar == double(sphere.center(id).polar()));
+		NIX_CHECK(s.azimuth == double(sphere.center(id).azimuthal()));
+		NIX_CHECK(s.solidAngle == double(sphere.getSolidAngle(id)));
+		NIX_CHECK(s.projectedSolidAngle ==
+				  double(sphere.getProjectedSolidAngle(id)));
+	}
+
+	for (int i=0; i<2; ++i) {
+		for (int l=0; l<3; ++l) {
+			const ResultFile::Cell & cell = results.cells[i * 3 + l];
+			const bool measured = cell.complete and cell.rays > 0;
+			NIX_CHECK(table.rays(i, l) == (measured ? cell.rays : 0));
+			for (int id=0; id<table.numSensors(); ++id) {
+				const int hits = measured ? cell.hits[id] : 0;
+				const Scalar psa = results.projectedSolidAngles[id];
+				const double bsdf = measured and psa > 0 ?
+					double(Scalar(hits) / cell.rays / psa) : 0;
+				NIX_CHECK(table.hits(i, l)[id] == hits);
+				NIX_CHECK(table.bsdf(i, l)[id] == bsdf);
+			}
+		}
+	}
+
+	// A header line, and a line per sensor of every measured cell
+	std::ostringstream text;
+	table.writeText(text);
+	const std::string lines = text.str();
+	NIX_CHECK(std::count(lines.begin(), lines.end(), '\n') ==
+			  1 + 4 * table.numSensors());
+
+	NIX_CHECK(!std::ifstream(fname + ".tmp"));
+	NIX_CHECK_THROWS(BsdfTable::write("BsdfTableTest.missing/" + fname,
+									  results, sphere), std::runtime_error);
+
+	const EqualSolidAnglesCollectorSphere other(2, 4, true, true);
+	NIX_CHECK_THROWS(BsdfTable::write(fname, results, other),
+					 std::runtime_error);
+}
+
+/// Check that damaged tables are rejected rather than mapped.
+void testCorruptFiles()
+{
+	const EqualSolidAnglesCollectorSphere sphere(3, 4, true, true);
+	BsdfTable::write(fname, makeResults(sphere), sphere);
+	const std::string bytes = readBytes(fname);
+	typedef BsdfTable::Header Header;
+
+	NIX_CHECK_THROWS(BsdfTable missing("BsdfTableTest.missing"),
+					 std::runtime_error);
+
+	writeBytes(fname, bytes.substr(0, sizeof(Header) - 1));
+	NIX_CHECK_THROWS(BsdfTable table(fname), std::runtime_error);
+
+	writeBytes(fname, bytes.substr(0, bytes.size() - 8));
+	NIX_CHECK_THROWS(BsdfTable table(fname), std::runtime_error);
+
+	writeBytes(fname, patch(bytes, offsetof(Header, magic), 'X'));
+	NIX_CHECK_THROWS(BsdfTable table(fname), std::runtime_error);
+
+	writeBytes(fname, patch<std::uint32_t>(bytes, offsetof(Header, version),
+										   BsdfTable::version + 1));
+	NIX_CHECK_THROWS(BsdfTable table(fname), std::runtime_error);
+
+	// Sections that overlap, or that lie beyond the end of the file
+	writeBytes(fname, patch<std::uint64_t>(bytes,
+		offsetof(Header, hitsOffset), 8));
+	NIX_CHECK_THROWS(BsdfTable table(fname), std::runtime_error);
+
+	writeBytes(fname, patch<std::uint32_t>(bytes,
+		offsetof(Header, numSensors), 1 << 30));
+	NIX_CHECK_THROWS(BsdfTable table(fname), std::runtime_error);
+
+	// The intact table still maps
+	writeBytes(fname, bytes);
+	const BsdfTable table(fname);
+	NIX_CHECK(table.numSensors() == sphere.numSensors());
+}
+
+} // namespace
+
+int main()
+{
+	testRoundTrip();
+	testCorruptFiles();
+	std::remove(fname.c_str());
+	return test::result();
+}
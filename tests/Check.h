@@ -0,0 +1,65 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+namespace nix {
+namespace test {
+
+/// Get the number of checks that failed so far.
+/// \return Returns a reference to the count.
+inline int & failures()
+{
+	static int count = 0;
+	return count;
+}
+
+/// Record the outcome of a check, and report it if it failed.
+/// \param passed Whether the check passed.
+/// \param what The text of the check.
+/// \param file The source file of the check.
+/// \param line The line of the check.
+inline void check(bool passed, const char * what, const char * file,
+				  int line)
+{
+	if (not passed) {
+		std::cerr << file << ":" << line << ": check failed: " << what
+				  << std::endl;
+		++failures();
+	}
+}
+
+/// Get the exit status of a test, to return from main().
+/// \return Returns EXIT_SUCCESS if every check passed.
+inline int result()
+{
+	if (failures() != 0) {
+		std::cerr << failures() << " check(s) failed." << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+} // namespace test
+} // namespace nix
+
+/// Check that a condition holds.
+#define NIX_CHECK(condition) \
+	nix::test::check((condition), #condition, __FILE__, __LINE__)
+
+/// Check that a statement throws an exception of the given type.
+#define NIX_CHECK_THROWS(statement, exception) \
+	do { \
+		bool thrown = false; \
+		try { \
+			statement; \
+		} catch (const exception &) { \
+			thrown = true; \
+		} \
+		nix::test::check(thrown, #statement " throws " #exception, \
+						 __FILE__, __LINE__); \
+	} while (false)
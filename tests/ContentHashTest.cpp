@@ -0,0 +1,94 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "Check.h"
+
+#include <ContentHash.h>
+#include <PiecewiseLinearSpectrum.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace nix;
+
+namespace {
+
+/// Check that the keys of fixed content never change. Cached results are
+/// found by their keys, so a change to the hash silently orphans every
+/// cache; if it is deliberate, ResultCache::version must be bumped as well
+/// as these keys. Only Scalars that doubles hold exactly are hashed, so the
+/// keys are the same for every precision of Scalar.
+void testKnownKeys()
+{
+	NIX_CHECK(ContentHash().hex() == "e9e0033e3badaf36d384ffab7559412a");
+	NIX_CHECK(ContentHash().addInteger(0).hex() ==
+			  "076b69490bb3ee794603808c843d5106");
+	NIX_CHECK(ContentHash().addInteger(-1).addInteger(1).hex() ==
+			  "6fe9f24b9e4b4fdc133a87ed4952e4e5");
+	NIX_CHECK(ContentHash().addString("PhotometerJob").hex() ==
+			  "51ad225be0dcbe365dced8bebc9ebaa1");
+	NIX_CHECK(ContentHash().addScalar(0.5).addScalar(-1024).hex() ==
+			  "e2124d7237d6fd36c4de0854bebb2810");
+	NIX_CHECK(ContentHash().addScalars({ 400, 500, 600.25 })
+			  .addDoubles({ 1, 2 }).hex() ==
+			  "d164aaf5dd926e9e69e18396a54a2e9b");
+}
+
+/// Check that keys are well formed, and depend on the order and boundaries of
+/// what is added.
+void testStructure()
+{
+	const std::string key = ContentHash().addInteger(42).hex();
+	NIX_CHECK(key.size() == 32);
+	NIX_CHECK(key.find_first_not_of("0123456789abcdef") == std::string::npos);
+
+	NIX_CHECK(ContentHash().addInteger(1).addInteger(2).hex() !=
+			  ContentHash().addInteger(2).addInteger(1).hex());
+	NIX_CHECK(ContentHash().addString("ab").addString("c").hex() !=
+			  ContentHash().addString("a").addString("bc").hex());
+	NIX_CHECK(ContentHash().addScalars({}).hex() != ContentHash().hex());
+	NIX_CHECK(ContentHash().addScalars({ 1, 2 }).addScalars({ 3 }).hex() !=
+			  ContentHash().addScalars({ 1 }).addScalars({ 2, 3 }).hex());
+
+	// Adding after hex(), and to a copy, continues the same hash.
+	ContentHash a;
+	a.addInteger(7);
+	const ContentHash b = a;
+	a.hex();
+	a.addString("more");
+	NIX_CHECK(a.hex() == ContentHash(b).addString("more").hex());
+	NIX_CHECK(b.hex() == ContentHash().addInteger(7).hex());
+}
+
+/// Check that spectra are hashed by their values, not their names.
+void testSpectra()
+{
+	const std::vector<Scalar> lambdas = { 400, 800 };
+	const auto a = std::make_shared<const PiecewiseLinearSpectrum>("a",
+		lambdas, std::vector<Scalar>{ 1.5, 1.25 });
+	const auto b = std::make_shared<const PiecewiseLinearSpectrum>("b",
+		lambdas, std::vector<Scalar>{ 1.5, 1.25 });
+	const auto c = std::make_shared<const PiecewiseLinearSpectrum>("a",
+		lambdas, std::vector<Scalar>{ 1.5, 1.375 });
+	ContentHash ha, hb, hc, none;
+	fingerprint(ha, a);
+	fingerprint(hb, b);
+	fingerprint(hc, c);
+	fingerprint(none, nullptr);
+	NIX_CHECK(ha.hex() == hb.hex());
+	NIX_CHECK(ha.hex() != hc.hex());
+	NIX_CHECK(none.hex() != ContentHash().hex());
+	NIX_CHECK(none.hex() != ha.hex());
+}
+
+} // namespace
+
+int main()
+{
+	testKnownKeys();
+	testStructure();
+	testSpectra();
+	return test::result();
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "Check.h"
+
+#include <RandomStream.h>
+
+#include <cstdint>
+
+using namespace nix;
+
+namespace {
+
+/// A known answer of Philox-4x32-10, from the kat_vectors of Random123.
+struct KnownAnswer
+{
+	std::uint32_t counter[4];
+	std::uint32_t key[2];
+	std::uint32_t block[4];
+};
+
+const KnownAnswer knownAnswers[] = {
+	{ { 0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+	  { 0x00000000, 0x00000000 },
+	  { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+	{ { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+	  { 0xffffffff, 0xffffffff },
+	  { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+	{ { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 },
+	  { 0xa4093822, 0x299f31d0 },
+	  { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+};
+
+/// Check the bijection against the published answers.
+void testKnownAnswers()
+{
+	for (const KnownAnswer & answer : knownAnswers) {
+		std::uint32_t block[4];
+		RandomStream::philox(answer.counter, answer.key, block);
+		for (int i=0; i<4; ++i) {
+			NIX_CHECK(block[i] == answer.block[i]);
+		}
+	}
+}
+
+/// Check that a stream encrypts the counter of the ray's coordinates and
+/// block number, with the seed as the key.
+void testCounterLayout()
+{
+	const std::uint64_t seed = 0x299f31d0a4093822ull;
+	RandomStream stream(seed, 0x13198a2e, 0x85a308d3, 0x243f6a88);
+	NIX_CHECK(stream.blocksDrawn() == 0);
+	const std::uint32_t key[2] = { 0xa4093822, 0x299f31d0 };
+	for (std::uint32_t n=0; n<3; ++n) {
+		std::uint32_t counter[4] = { n, 0x243f6a88, 0x85a308d3, 0x13198a2e };
+		std::uint32_t block[4];
+		RandomStream::philox(counter, key, block);
+		for (int i=0; i<4; ++i) {
+			NIX_CHECK(stream.next() == block[i]);
+		}
+		NIX_CHECK(stream.blocksDrawn() == n + 1);
+	}
+
+	// The first block of the zero stream is the first known answer.
+	RandomStream zero(0, 0, 0, 0);
+	for (int i=0; i<4; ++i) {
+		NIX_CHECK(zero.next() == knownAnswers[0].block[i]);
+	}
+}
+
+/// Check that uniform numbers stay within [0, 1), and that each uses two
+/// 32 bit numbers.
+void testUniform()
+{
+	RandomStream stream(7, 1, 2, 3);
+	Scalar sum = 0;
+	const int count = 4096;
+	for (int i=0; i<count; ++i) {
+		const Scalar u = stream.uniform();
+		NIX_CHECK(u >= 0 and u < 1);
+		sum += u;
+	}
+	NIX_CHECK(stream.blocksDrawn() == count / 2);
+	// The mean has a standard deviation of 1/sqrt(12 count) = 0.0045.
+	NIX_CHECK(sum / count > 0.48 and sum / count < 0.52);
+}
+
+} // namespace
+
+int main()
+{
+	testKnownAnswers();
+	testCounterLayout();
+	testUniform();
+	return test::result();
+}
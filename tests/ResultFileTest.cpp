@@ -0,0 +1,186 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "Check.h"
+
+#include <ResultFile.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+using namespace nix;
+
+namespace {
+
+const std::string fname = "ResultFileTest.bin";
+
+/// Make the results of a job of two incident angles, three wavelengths and
+/// four sensors, whose Scalars need more than a double to be exact.
+ResultFile makeFile()
+{
+	ResultFile file;
+	file.seed = 0x0123456789abcdefull;
+	file.targetError = 0.01;
+	file.minRays = 1000;
+	file.maxRays = 100000;
+	file.packetSize = 2;
+	file.jobKey = "00112233445566778899aabbccddeeff";
+	file.polar = { Scalar(1) / 3, Scalar(0) };
+	file.azimuth = { Scalar(0), Scalar(2) / 7 };
+	file.lambdas = { 400, Scalar(1000) / 3, 600 };
+	file.projectedSolidAngles = { Scalar(1) / 11, Scalar(2) / 11,
+								  Scalar(3) / 11, 0 };
+	file.cells.resize(6);
+	for (int c=0; c<6; ++c) {
+		ResultFile::Cell & cell = file.cells[c];
+		cell.complete = c % 2 == 0;
+		cell.rays = c == 5 ? 0 : 100 * (c + 1);
+		if (cell.rays > 0) {
+			cell.hits = { c, 2 * c, 3 * c, 4 * c };
+		}
+	}
+	return file;
+}
+
+/// Check that two files hold the same job and cells.
+bool identical(const ResultFile & a, const ResultFile & b)
+{
+	if (!a.sameJob(b) or a.cells.size() != b.cells.size()) {
+		return false;
+	}
+	for (std::size_t c=0; c<a.cells.size(); ++c) {
+		if (a.cells[c].rays != b.cells[c].rays or
+			a.cells[c].complete != b.cells[c].complete or
+			a.cells[c].hits != b.cells[c].hits) {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string readBytes(const std::string & name)
+{
+	std::ifstream is(name, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(is),
+					   std::istreambuf_iterator<char>());
+}
+
+void writeBytes(const std::string & name, const std::string & bytes)
+{
+	std::ofstream(name, std::ios::binary | std::ios::trunc) << bytes;
+}
+
+/// Check that the file reads back exactly as it was written.
+void testRoundTrip()
+{
+	const ResultFile file = makeFile();
+	file.write(fname);
+	const ResultFile read = ResultFile::read(fname);
+	NIX_CHECK(identical(file, read));
+	NIX_CHECK(read.seed == file.seed);
+	NIX_CHECK(read.jobKey == file.jobKey);
+	NIX_CHECK(read.lambdas[1] == Scalar(1000) / 3);
+	NIX_CHECK(read.numSensors() == 4);
+
+	ResultFile other = makeFile();
+	other.jobKey[0] = '1';
+	NIX_CHECK(!other.sameJob(file));
+}
+
+/// Check that damaged files are rejected rather than read.
+void testCorruptFiles()
+{
+	makeFile().write(fname);
+	const std::string bytes = readBytes(fname);
+
+	NIX_CHECK_THROWS(ResultFile::read("ResultFileTest.missing"),
+					 std::runtime_error);
+
+	std::string damaged = bytes;
+	damaged[7] = '1';
+	writeBytes(fname, damaged);
+	NIX_CHECK_THROWS(ResultFile::read(fname), std::runtime_error);
+
+	writeBytes(fname, bytes.substr(0, bytes.size() - 1));
+	NIX_CHECK_THROWS(ResultFile::read(fname), std::runtime_error);
+
+	// The size of the job key follows the magic, the seed, n, the target
+	// error and the three other integers.
+	damaged = bytes;
+	const std::int32_t keySize = -1;
+	std::memcpy(&damaged[40], &keySize, sizeof(keySize));
+	writeBytes(fname, damaged);
+	NIX_CHECK_THROWS(ResultFile::read(fname), std::runtime_error);
+}
+
+/// Check that shards merge into the whole job, and that they must agree.
+void testMerge()
+{
+	const std::string names[2] = { "ResultFileTest.0", "ResultFileTest.1" };
+	const ResultFile whole = makeFile();
+	ResultFile shards[2] = { whole, whole };
+	for (std::size_t c=0; c<whole.cells.size(); ++c) {
+		shards[c % 2].cells[c] = ResultFile::Cell();
+		shards[(c + 1) % 2].cells[c].complete = true;
+	}
+	shards[0].write(names[0]);
+	shards[1].write(names[1]);
+	ResultFile merged = ResultFile::merge({ names[0], names[1] });
+	for (std::size_t c=0; c<whole.cells.size(); ++c) {
+		NIX_CHECK(merged.cells[c].complete);
+		NIX_CHECK(merged.cells[c].rays == whole.cells[c].rays);
+		NIX_CHECK(merged.cells[c].hits == whole.cells[c].hits);
+	}
+
+	// Cell 5 has no rays, so it isn't complete in either shard.
+	shards[0].cells[5] = ResultFile::Cell();
+	shards[0].write(names[0]);
+	shards[1].cells[5] = ResultFile::Cell();
+	shards[1].write(names[1]);
+	NIX_CHECK_THROWS(ResultFile::merge({ names[0], names[1] }),
+					 std::runtime_error);
+
+	shards[1].jobKey = "ffeeddccbbaa99887766554433221100";
+	shards[1].cells[5] = whole.cells[5];
+	shards[1].cells[5].complete = true;
+	shards[1].write(names[1]);
+	NIX_CHECK_THROWS(ResultFile::merge({ names[0], names[1] }),
+					 std::runtime_error);
+
+	std::remove(names[0].c_str());
+	std::remove(names[1].c_str());
+}
+
+/// Check that a file is replaced through a temporary file that is then
+/// gone, and that failures to write or replace it are reported.
+void testReplace()
+{
+	const ResultFile file = makeFile();
+	file.write("./" + fname);
+	NIX_CHECK(identical(ResultFile::read(fname), file));
+	NIX_CHECK(!std::ifstream(fname + ".tmp"));
+
+	NIX_CHECK_THROWS(file.write("ResultFileTest.missing/" + fname),
+					 std::runtime_error);
+	NIX_CHECK_THROWS(ResultFile::replace(fname + ".tmp", fname),
+					 std::runtime_error);
+	NIX_CHECK(identical(ResultFile::read(fname), file));
+}
+
+} // namespace
+
+int main()
+{
+	testRoundTrip();
+	testCorruptFiles();
+	testMerge();
+	testReplace();
+	std::remove(fname.c_str());
+	return test::result();
+}
@@ -0,0 +1,261 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "Check.h"
+
+#include <Array2.h>
+#include <Intersection.h>
+#include <PiecewiseLinearSpectrum.h>
+#include <RandomScatterRecord.h>
+#include <RandomSpheroidParticleGenerator.h>
+#include <RandomStream.h>
+#include <RayResult.h>
+#include <SpectralSample.h>
+#include <Test1Material.h>
+#include <VacuumMedium.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using namespace nix;
+
+namespace {
+
+typedef std::shared_ptr<const PiecewiseLinearSpectrum> Spectrum;
+
+/// The wavelengths of the packets, in nanometres.
+const std::vector<Scalar> lambdas = { 500, 1000 };
+
+/// The bins of the exit directions: reflected and transmitted rays, each by
+/// the cosine of their angle to the normal.
+constexpr int cosBins = 10;
+constexpr int numBins = 2 * cosBins;
+
+/// The mean and variance of the weight per ray that each wavelength leaves in
+/// each bin.
+struct Estimate
+{
+	std::vector<double> mean, variance;
+};
+
+Spectrum spectrum(const std::string & name, Scalar at500, Scalar at1000)
+{
+	return std::make_shared<const PiecewiseLinearSpectrum>(name, lambdas,
+		std::vector<Scalar>{ at500, at1000 });
+}
+
+/// A slab of a strongly dispersive medium behind a Fresnel interface. Only
+/// the interface scatters, so the reflected and transmitted rays of each
+/// wavelength leave in a single direction of their own.
+std::shared_ptr<Test1Material> interfaceMaterial()
+{
+	Spectrum n = spectrum("n", 1.2, 2.4);
+	Spectrum k = spectrum("k", 0, 0);
+	auto material = std::make_shared<Test1Material>();
+	material->setDepth(1);
+	material->setMediaTypes({ Test1Material::MediumDef("glass", 1, n, k) });
+	material->setMirrorInterface(true);
+	return material;
+}
+
+/// A layer of strongly dispersive grains in air.
+std::shared_ptr<Test1Material> grainMaterial()
+{
+	Spectrum airN = spectrum("air_n", 1, 1);
+	Spectrum airK = spectrum("air_k", 0, 0);
+	Array2 warp;
+	for (auto & row : warp) {
+		row.fill(0.5);
+	}
+	Test1Material::ParticleDef grain;
+	grain.name = "grain";
+	grain.n = spectrum("grain_n", 1.2, 2.4);
+	grain.k = spectrum("grain_k", 1e-7, 1e-7);
+	grain.concentration = 1;
+	grain.generator = std::make_shared<RandomSpheroidParticleGenerator>(
+		warp, warp,
+		std::make_shared<PiecewiseLinearSpectrum>("size", 0, 1,
+			std::vector<Scalar>{ 200e-6, 600e-6 }),
+		std::make_shared<PiecewiseLinearSpectrum>("sphericity", 0, 1,
+			std::vector<Scalar>{ 0.8, 1.25 }), 300e-6);
+	grain.meanDistance = grain.generator->averageParticleDistance();
+
+	auto material = std::make_shared<Test1Material>();
+	material->setDepth(2e-3);
+	material->setMediaTypes({
+		Test1Material::MediumDef("air", 1, airN, airK) });
+	material->setParticles({ grain });
+	material->setMirrorInterface(false);
+	return material;
+}
+
+/// Get the bin of an exit direction.
+int bin(Interaction result, const Vector3 & d)
+{
+	const Scalar c = std::min(std::abs(d.z), Scalar(1));
+	const int b = std::min(static_cast<int>(c * cosBins), cosBins - 1);
+	return result == Interaction::reflected ? b : cosBins + b;
+}
+
+/// Add the weights a ray left to the sums of their bin.
+void add(Interaction result, const RandomScatterRecord & sr,
+		 std::vector<std::vector<double>> & sums,
+		 std::vector<std::vector<double>> & squares,
+		 const std::vector<std::size_t> & wavelengths)
+{
+	if (result == Interaction::absorbed) {
+		return;
+	}
+	const int b = bin(result, sr.exit.d);
+	for (std::size_t j=0; j<wavelengths.size(); ++j) {
+		const double w = sr.weights[j];
+		sums[wavelengths[j]][b] += w;
+		squares[wavelengths[j]][b] += w * w;
+	}
+}
+
+/// Turn sums of weights into estimates per ray.
+std::vector<Estimate> estimates(
+	const std::vector<std::vector<double>> & sums,
+	const std::vector<std::vector<double>> & squares, int numRays)
+{
+	std::vector<Estimate> result(sums.size());
+	for (std::size_t j=0; j<sums.size(); ++j) {
+		for (int b=0; b<numBins; ++b) {
+			const double mean = sums[j][b] / numRays;
+			result[j].mean.push_back(mean);
+			result[j].variance.push_back(
+				(squares[j][b] / numRays - mean * mean) / numRays);
+		}
+	}
+	return result;
+}
+
+/// Trace packets of every wavelength, in waves, with the hero rotating
+/// through the packet from ray to ray as CollimatedBeamPhotometer does.
+std::vector<Estimate> traceHero(const Test1Material & material,
+								const Intersection & x, int numRays)
+{
+	static const VacuumMedium ambient;
+	SpectralSample ss;
+	std::vector<std::size_t> wavelengths;
+	for (std::size_t j=0; j<lambdas.size(); ++j) {
+		ss.add(lambdas[j], 1);
+		wavelengths.push_back(j);
+	}
+	std::vector<std::vector<double>> sums(lambdas.size(),
+		std::vector<double>(numBins, 0));
+	std::vector<std::vector<double>> squares = sums;
+
+	const int waveSize = 256;
+	std::vector<RandomScatterRecord> records(waveSize,
+		RandomScatterRecord(RandomStream(1, 0, 0, 0)));
+	std::vector<Interaction> results(waveSize);
+	for (int first=0; first<numRays; first+=waveSize) {
+		for (int i=0; i<waveSize; ++i) {
+			const int ray = first + i;
+			records[i].reset(RandomStream(1, 0, 0, ray), lambdas.size(),
+							 ray % lambdas.size());
+		}
+		material.ScatterBatch(x, ss, ambient, records.data(), results.data(),
+							  waveSize);
+		for (int i=0; i<waveSize; ++i) {
+			add(results[i], records[i], sums, squares, wavelengths);
+		}
+	}
+	return estimates(sums, squares, numRays);
+}
+
+/// Trace each wavelength on its own.
+std::vector<Estimate> traceEach(const Test1Material & material,
+								const Intersection & x, int numRays)
+{
+	static const VacuumMedium ambient;
+	std::vector<std::vector<double>> sums(lambdas.size(),
+		std::vector<double>(numBins, 0));
+	std::vector<std::vector<double>> squares = sums;
+	for (std::size_t j=0; j<lambdas.size(); ++j) {
+		const SpectralSample ss(lambdas[j], 1);
+		RandomScatterRecord sr(RandomStream(2, 0, j, 0));
+		for (int ray=0; ray<numRays; ++ray) {
+			sr.reset(RandomStream(2, 0, j, ray), 1, 0);
+			const Interaction result =
+				material.Scatter(x, ss, ambient, sr).interaction();
+			add(result, sr, sums, squares, { j });
+		}
+	}
+	return estimates(sums, squares, numRays);
+}
+
+/// Check that hero packets and single wavelengths agree within their noise,
+/// bin by bin, for every wavelength.
+void compare(const Test1Material & material, int numRays)
+{
+	const Vector3 toSource(std::sin(Scalar(0.7)), 0, std::cos(Scalar(0.7)));
+	const Intersection x(Ray3(Point3::Origin + toSource,
+		Vector3(-toSource.x, -toSource.y, -toSource.z)), 1);
+	const std::vector<Estimate> hero = traceHero(material, x, numRays);
+	const std::vector<Estimate> each = traceEach(material, x, numRays);
+	for (std::size_t j=0; j<lambdas.size(); ++j) {
+		double total = 0;
+		for (int b=0; b<numBins; ++b) {
+			const double difference = hero[j].mean[b] - each[j].mean[b];
+			const double variance = hero[j].variance[b] +
+				each[j].variance[b];
+			NIX_CHECK(difference * difference <= 25 * variance);
+			total += each[j].mean[b];
+		}
+		NIX_CHECK(total > 0.5);
+	}
+}
+
+/// Check that the Fresnel choices and the refracted directions of every
+/// wavelength of a packet are its own, at a dispersive interface.
+void testInterface()
+{
+	compare(*interfaceMaterial(), 100000);
+}
+
+/// Check the same through dispersive grains, with internal reflections.
+void testGrains()
+{
+	compare(*grainMaterial(), 20000);
+}
+
+/// Check that an index which does not disperse keeps every wavelength on
+/// the path.
+void testNonDispersive()
+{
+	static const VacuumMedium ambient;
+	Spectrum n = spectrum("n", 1.5, 1.5);
+	Spectrum k = spectrum("k", 1e-7, 2e-7);
+	Test1Material material;
+	material.setDepth(1);
+	material.setMediaTypes({ Test1Material::MediumDef("glass", 1, n, k) });
+	SpectralSample ss;
+	for (Scalar lambda : lambdas) {
+		ss.add(lambda, 1);
+	}
+	const Intersection x(Ray3(Point3(0, 0, 1), Vector3(0, 0, -1)), 1);
+	RandomScatterRecord sr(RandomStream(3, 0, 0, 0));
+	for (int ray=0; ray<1000; ++ray) {
+		sr.reset(RandomStream(3, 0, 0, ray), lambdas.size(), ray % 2);
+		if (material.Scatter(x, ss, ambient, sr).interaction() ==
+			Interaction::transmitted) {
+			NIX_CHECK(not sr.dispersed);
+			NIX_CHECK(sr.weights[0] > 0 and sr.weights[1] > 0);
+		}
+	}
+}
+
+} // namespace
+
+int main()
+{
+	testInterface();
+	testGrains();
+	testNonDispersive();
+	return test::result();
+}
@@ -0,0 +1,179 @@
+/***************************************************************************
+ *   Copyright (C) Natrual Phenomena Simulation Group                      *
+ *   University of Waterloo, Waterloo, Canada                              *
+ ***************************************************************************/
+#include "Check.h"
+
+#include <Array2.h>
+#include <RandomStream.h>
+#include <WarpTable.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace nix;
+
+namespace {
+
+constexpr int size = WarpTable::size;
+
+/// Make a density with empty rows, empty cells and invalid values, which
+/// varies by a factor of hundreds over the square.
+std::unique_ptr<Array2> makeDensity()
+{
+	std::unique_ptr<Array2> density(new Array2());
+	for (int i=0; i<size; ++i) {
+		for (int j=0; j<size; ++j) {
+			Scalar d = (1 + i) * (j < size / 2 ? 1 : 3) + (i == j ? 50 : 0);
+			if (i % 7 == 3 or (i + j) % 11 == 0) {
+				d = 0;
+			}
+			(*density)[i][j] = d;
+		}
+	}
+	(*density)[20][30] = -5;
+	(*density)[21][31] = std::numeric_limits<Scalar>::quiet_NaN();
+	return density;
+}
+
+/// The density of a cell, relative to the uniform density.
+Scalar cellPdf(const WarpTable & table, int i, int j)
+{
+	return table.pdf((i + Scalar(0.5)) / size, (j + Scalar(0.5)) / size);
+}
+
+/// Check that pdf() is the given density, normalized, and that invalid
+/// values are taken to be zero.
+void testPdf()
+{
+	const std::unique_ptr<Array2> density = makeDensity();
+	const WarpTable table(*density);
+	double total = 0;
+	for (int i=0; i<size; ++i) {
+		for (int j=0; j<size; ++j) {
+			const Scalar d = (*density)[i][j];
+			total += d > 0 ? double(d) : 0;
+		}
+	}
+	NIX_CHECK(std::abs(table.mass() - total) <= 1e-9 * total);
+
+	Scalar integral = 0;
+	for (int i=0; i<size; ++i) {
+		for (int j=0; j<size; ++j) {
+			const Scalar d = (*density)[i][j];
+			const Scalar expected = d > 0 ? d * size * size / total : 0;
+			NIX_CHECK(std::abs(cellPdf(table, i, j) - expected) <= 1e-9);
+			integral += cellPdf(table, i, j) / (size * size);
+		}
+	}
+	NIX_CHECK(std::abs(integral - 1) <= 1e-9);
+	NIX_CHECK(table.pdf(-0.1, 0.5) == 0);
+	NIX_CHECK(table.pdf(0.5, 1.1) == 0);
+}
+
+/// Check that sample() inverts the distribution of pdf(): the point it maps
+/// two numbers to has the first as its marginal cumulative probability, and
+/// the second as its cumulative probability within its row.
+void testInversion()
+{
+	const std::unique_ptr<Array2> density = makeDensity();
+	const WarpTable table(*density);
+	std::vector<Scalar> rows(size + 1, 0);
+	for (int i=0; i<size; ++i) {
+		Scalar row = 0;
+		for (int j=0; j<size; ++j) {
+			row += cellPdf(table, i, j) / size;
+		}
+		rows[i+1] = rows[i] + row / size;
+	}
+
+	RandomStream random(1, 2, 3, 4);
+	for (int k=0; k<10000; ++k) {
+		const Scalar u1 = random.uniform();
+		const Scalar u2 = random.uniform();
+		Scalar x, y;
+		table.sample(u1, u2, x, y);
+		NIX_CHECK(x >= 0 and x <= 1 and y >= 0 and y <= 1);
+		NIX_CHECK(table.pdf(x, y) > 0);
+
+		const int i = std::min(static_cast<int>(x * size), size - 1);
+		const int j = std::min(static_cast<int>(y * size), size - 1);
+		const Scalar inRow = rows[i+1] - rows[i];
+		const Scalar cdfX = rows[i] + inRow * (x * size - i);
+		NIX_CHECK(std::abs(cdfX - u1) <= 1e-9);
+
+		Scalar before = 0, row = 0;
+		for (int c=0; c<size; ++c) {
+			row += cellPdf(table, i, c);
+			before += c < j ? cellPdf(table, i, c) : 0;
+		}
+		const Scalar cdfY = (before + cellPdf(table, i, j) * (y * size - j))
+			/ row;
+		NIX_CHECK(std::abs(cdfY - u2) <= 1e-9);
+	}
+}
+
+/// Check a histogram of the samples of cells against pdf(), with a
+/// chi-squared test.
+void testHistogram()
+{
+	const std::unique_ptr<Array2> density = makeDensity();
+	const WarpTable table(*density);
+	const int count = 1 << 21;
+	std::vector<int> histogram(size * size, 0);
+	RandomStream random(42, 0, 0, 0);
+	for (int k=0; k<count; ++k) {
+		const Scalar u1 = random.uniform();
+		const Scalar u2 = random.uniform();
+		Scalar x, y;
+		table.sample(u1, u2, x, y);
+		const int i = std::min(static_cast<int>(x * size), size - 1);
+		const int j = std::min(static_cast<int>(y * size), size - 1);
+		++histogram[i * size + j];
+	}
+
+	double chi2 = 0;
+	int bins = 0;
+	for (int i=0; i<size; ++i) {
+		for (int j=0; j<size; ++j) {
+			const double expected = double(cellPdf(table, i, j)) * count /
+				(size * size);
+			const int found = histogram[i * size + j];
+			if (expected == 0) {
+				NIX_CHECK(found == 0);
+				continue;
+			}
+			chi2 += (found - expected) * (found - expected) / expected;
+			++bins;
+		}
+	}
+	// Chi-squared has a mean of bins - 1 and a standard deviation of about
+	// sqrt(2 bins), so this fails by chance with a probability below 1e-6.
+	NIX_CHECK(chi2 < bins + 5 * std::sqrt(2.0 * bins));
+}
+
+/// Check that a density without any valid values is taken to be uniform.
+void testUniform()
+{
+	std::unique_ptr<Array2> density(new Array2());
+	const WarpTable table(*density);
+	NIX_CHECK(table.mass() == 0);
+	NIX_CHECK(std::abs(table.pdf(0.3, 0.7) - 1) <= 1e-12);
+	Scalar x, y;
+	table.sample(0.25, 0.75, x, y);
+	NIX_CHECK(std::abs(x - 0.25) <= 1e-12 and std::abs(y - 0.75) <= 1e-12);
+}
+
+} // namespace
+
+int main()
+{
+	testPdf();
+	testInversion();
+	testHistogram();
+	testUniform();
+	return test::result();
+}